@@ -31,7 +31,9 @@ class TOFResoALICE3 : public Parametrization
  public:
   TOFResoALICE3() : Parametrization("TOFResoALICE3", 1){};
   ~TOFResoALICE3() override = default;
-  float operator()(const float* x) const override
+  float operator()(const float* x) const override { return Evaluate(x, mParameters); }
+  void Evaluate(gsl::span<const float> x, gsl::span<float> y) const override { EvaluateBatch<TOFResoALICE3>(x, y, mParameters); }
+  static float Evaluate(const float* x, const Parameters& parameters)
   {
     const float p = abs(x[0]);
     if (p <= 0) {
@@ -51,7 +53,7 @@ class TOFResoALICE3 : public Parametrization
 
     const float mass2 = mass * mass;
     const float etexp = Lc * mass2 / p2 / sqrt(mass2 + p2) * ep;
-    return sqrt(etexp * etexp + mParameters[0] * mParameters[0] + evtimereso * evtimereso);
+    return sqrt(etexp * etexp + parameters[0] * parameters[0] + evtimereso * evtimereso);
   }
   ClassDef(TOFResoALICE3, 1);
 };
@@ -36,3 +36,19 @@ void TriggerAliases::AddClassIdToAlias(uint32_t aliasId, int classId)
     mAliasToTriggerMaskNext50[aliasId] |= 1ull << (classId - 50);
   }
 }
+
+void TriggerAliases::GetAliasTriggerMasks(std::array<uint64_t, kNaliases>& masks, std::array<uint64_t, kNaliases>& masksNext50) const
+{
+  auto fill = [](const std::map<uint32_t, ULong64_t>& map, std::array<uint64_t, kNaliases>& masks) {
+    masks.fill(0);
+    for (auto& al : map) {
+      if (al.first >= kNaliases) {
+        LOGF(error, "Unknown trigger alias %d", al.first);
+        continue;
+      }
+      masks[al.first] |= al.second;
+    }
+  };
+  fill(mAliasToTriggerMask, masks);
+  fill(mAliasToTriggerMaskNext50, masksNext50);
+}
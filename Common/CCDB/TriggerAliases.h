@@ -12,6 +12,7 @@
 #ifndef TriggerAliases_H
 #define TriggerAliases_H
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -46,6 +47,8 @@ class TriggerAliases
   const std::map<uint32_t, std::string>& GetAliasToClassNamesMap() const { return mAliasToClassNames; }
   const std::map<uint32_t, ULong64_t>& GetAliasToTriggerMaskMap() const { return mAliasToTriggerMask; }
   const std::map<uint32_t, ULong64_t>& GetAliasToTriggerMaskNext50Map() const { return mAliasToTriggerMaskNext50; }
+  /// Flattens the alias to trigger mask maps into one mask per alias, e.g. for a loop over the BCs
+  void GetAliasTriggerMasks(std::array<uint64_t, kNaliases>& masks, std::array<uint64_t, kNaliases>& masksNext50) const;
   void Print();
 
  private:
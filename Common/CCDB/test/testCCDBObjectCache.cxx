@@ -0,0 +1,130 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testCCDBObjectCache.cxx
+/// \brief  Checks the cache of the trigger aliases of the BC selection task against a local ROOT file standing in for the CCDB
+///         (url local://<file name>). The file holds TriggerAliases objects with random trigger classes in consecutive validity
+///         intervals. For the BCs of all the intervals, the fired aliases computed with the cached object and its flattened trigger
+///         masks are compared with the ones from the alias to trigger mask maps of the object valid at the BC timestamp, as computed
+///         by the task before. Checks that each object is retrieved once and compares the time per BC.
+///         Returns a non-zero exit code if a check fails.
+///
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Common/CCDB/TriggerAliases.h"
+#include "Common/Core/CCDBObjectCache.h"
+// ROOT includes
+#include "TFile.h"
+
+namespace
+{
+using AliasArray = std::array<int32_t, kNaliases>;
+
+struct BC {
+  long timestamp;
+  uint64_t triggerMask, triggerMaskNext50;
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int nIntervals = 20;
+  const int nBCsPerInterval = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const long intervalLength = 1000000; // ms
+  const std::string fileName = "testCCDBObjectCache.root";
+  const std::string path = "EventSelection/TriggerAliases";
+  std::mt19937_64 generator(5);
+
+  // Objects with random trigger classes for the aliases, in consecutive validity intervals
+  std::vector<std::unique_ptr<TriggerAliases>> objects;
+  {
+    TFile file(fileName.c_str(), "RECREATE");
+    TDirectory* dir = file.mkdir(path.c_str());
+    for (int interval = 0; interval < nIntervals; interval++) {
+      auto aliases = std::make_unique<TriggerAliases>();
+      for (uint32_t alias = 0; alias < kALL; alias++) {
+        const int nClasses = generator() % 4;
+        for (int i = 0; i < nClasses; i++) {
+          aliases->AddClassIdToAlias(alias, generator() % 100);
+        }
+      }
+      const std::string name = std::to_string(interval * intervalLength) + "_" + std::to_string((interval + 1) * intervalLength);
+      dir->WriteObject(aliases.get(), name.c_str());
+      objects.push_back(std::move(aliases));
+    }
+    file.Close();
+  }
+
+  // BCs ordered in time, with random trigger masks
+  std::vector<BC> bcs;
+  for (int interval = 0; interval < nIntervals; interval++) {
+    for (int i = 0; i < nBCsPerInterval; i++) {
+      bcs.push_back(BC{interval * intervalLength + i * (intervalLength / nBCsPerInterval), generator() & generator(), generator() & generator()});
+    }
+  }
+
+  // Previous implementation: object valid at the BC timestamp (here without the lookup in the CCDB manager) and loop over its maps
+  std::vector<AliasArray> aliasesReference(bcs.size());
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < bcs.size(); i++) {
+    const TriggerAliases* aliases = objects[bcs[i].timestamp / intervalLength].get();
+    AliasArray& alias = aliasesReference[i];
+    alias.fill(0);
+    for (auto& al : aliases->GetAliasToTriggerMaskMap()) {
+      alias[al.first] |= (bcs[i].triggerMask & al.second) > 0;
+    }
+    for (auto& al : aliases->GetAliasToTriggerMaskNext50Map()) {
+      alias[al.first] |= (bcs[i].triggerMaskNext50 & al.second) > 0;
+    }
+    alias[kALL] = 1;
+  }
+  double timeReference = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  // As in BcSelectionTask, with the objects from the local file
+  o2::ccdb::CcdbApi api; // not used for a local file
+  o2::analysis::CCDBObjectCache<TriggerAliases> aliasesCache;
+  std::array<uint64_t, kNaliases> aliasTriggerMask{}, aliasTriggerMaskNext50{};
+  aliasesCache.init(o2::analysis::getFetcher<TriggerAliases>(api, o2::analysis::LocalFileUrlPrefix + fileName, 0), path,
+                    [&](TriggerAliases* object) { object->GetAliasTriggerMasks(aliasTriggerMask, aliasTriggerMaskNext50); });
+  std::vector<AliasArray> aliasesCached(bcs.size());
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < bcs.size(); i++) {
+    aliasesCache.update(bcs[i].timestamp);
+    AliasArray& alias = aliasesCached[i];
+    for (int k = 0; k < kNaliases; k++) {
+      alias[k] = (bcs[i].triggerMask & aliasTriggerMask[k]) > 0 || (bcs[i].triggerMaskNext50 & aliasTriggerMaskNext50[k]) > 0;
+    }
+    alias[kALL] = 1;
+  }
+  double timeCached = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::remove(fileName.c_str());
+
+  long nDifferent = 0;
+  for (std::size_t i = 0; i < bcs.size(); i++) {
+    if (aliasesCached[i] != aliasesReference[i] && nDifferent++ < 10) {
+      printf("FAILED: BC %zu with timestamp %ld: different fired aliases\n", i, bcs[i].timestamp);
+    }
+  }
+  const bool isOK = nDifferent == 0 && aliasesCache.getNFetches() == nIntervals;
+  printf("%zu BCs in %d validity intervals: %ld with different fired aliases, %d objects retrieved; per BC: maps %.1f ns, cached masks %.1f ns (including the retrievals)\n",
+         bcs.size(), nIntervals, nDifferent, aliasesCache.getNFetches(), timeReference / bcs.size(), timeCached / bcs.size());
+  printf("%s\n", isOK ? "OK" : "FAILED");
+  return isOK ? 0 : 1;
+}
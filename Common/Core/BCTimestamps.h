@@ -0,0 +1,87 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   BCTimestamps.h
+/// \brief  Computation of the timestamps of the BCs from the SOR timestamp and the initial orbit of their run,
+///         BC by BC and for a whole BC table, as done by the timestamp task.
+///
+
+#ifndef O2_ANALYSIS_BCTIMESTAMPS_H_
+#define O2_ANALYSIS_BCTIMESTAMPS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// O2 includes
+#include "CommonConstants/LHCConstants.h"
+#include "CommonDataFormat/InteractionRecord.h"
+
+namespace o2::analysis::timestamp
+{
+
+/// SOR timestamp and initial interaction record of a run
+struct RunStart {
+  long sorTimeStamp = 0;         /// Timestamp of the SOR in ms
+  o2::InteractionRecord firstIR; /// Interaction record of the SOR
+};
+
+/// Timestamp in ms of an interaction record, for the run with SOR timestamp sorTimeStamp and initial interaction record firstIR
+inline uint64_t getTimestamp(const long sorTimeStamp, const o2::InteractionRecord& firstIR, const o2::InteractionRecord& currentIR)
+{
+  return sorTimeStamp + (currentIR - firstIR).bc2ns() * 1e-6;
+}
+
+/// Timestamp in ms of a BC
+/// \param globalBC Global BC of the BC
+/// \param isRun2MC If true, the BC is assumed to be the first one of the run (Run 2 MC has no global BC)
+inline uint64_t getTimestamp(const RunStart& run, const uint64_t globalBC, const bool isRun2MC)
+{
+  if (isRun2MC) {
+    return getTimestamp(run.sorTimeStamp, run.firstIR, run.firstIR);
+  }
+  const o2::InteractionRecord currentIR(static_cast<uint16_t>(globalBC % o2::constants::lhc::LHCMaxBunches), static_cast<uint32_t>(globalBC / o2::constants::lhc::LHCMaxBunches));
+  return getTimestamp(run.sorTimeStamp, run.firstIR, currentIR);
+}
+
+/// Timestamps of all the BCs of a table, with the same values as getTimestamp for each BC.
+/// The start of the run is looked up once for each contiguous block of BCs of the same run.
+/// \param globalBCs Global BCs of the BCs
+/// \param runNumbers Run numbers of the BCs
+/// \param getRunStart Function returning the RunStart of a run number
+/// \param timestamps Timestamps of the BCs, resized to the number of BCs
+template <typename F>
+void fillTimestamps(const std::vector<uint64_t>& globalBCs, const std::vector<int>& runNumbers, const bool isRun2MC, F&& getRunStart, std::vector<uint64_t>& timestamps)
+{
+  const std::size_t nBCs = globalBCs.size();
+  timestamps.resize(nBCs);
+  for (std::size_t begin = 0; begin < nBCs;) {
+    std::size_t end = begin + 1;
+    while (end < nBCs && runNumbers[end] == runNumbers[begin]) {
+      end++;
+    }
+    // Local copy so that the loop does not reload it after each store
+    const RunStart run = getRunStart(runNumbers[begin]);
+    if (isRun2MC) {
+      std::fill(timestamps.begin() + begin, timestamps.begin() + end, getTimestamp(run, 0, true));
+    } else {
+      for (std::size_t j = begin; j < end; j++) {
+        timestamps[j] = getTimestamp(run, globalBCs[j], false);
+      }
+    }
+    begin = end;
+  }
+}
+
+} // namespace o2::analysis::timestamp
+
+#endif // O2_ANALYSIS_BCTIMESTAMPS_H_
@@ -0,0 +1,208 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   CCDBObjectCache.h
+/// \brief  Cache of a CCDB object (e.g. the parametrization of a PID response or the event selection parameters),
+///         keyed on its validity interval. The object is retrieved and its user configured again only when the
+///         requested timestamp leaves the validity interval of the current object.
+///
+
+#ifndef O2_ANALYSIS_CCDBOBJECTCACHE_H_
+#define O2_ANALYSIS_CCDBOBJECTCACHE_H_
+
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Framework/Logger.h"
+#include "Common/Core/CCDBSnapshot.h"
+// ROOT includes
+#include "TFile.h"
+#include "TKey.h"
+
+// O2 includes
+#include <CCDB/CcdbApi.h>
+
+namespace o2::analysis
+{
+
+/// Validity interval [from, until) of an object, in ms
+struct ValidityInterval {
+  long from = 0;
+  long until = -1;
+  bool contains(long timestamp) const { return timestamp >= from && timestamp < until; }
+};
+
+/// Retrieves the object valid at a timestamp and its validity interval, the caller takes the ownership of the object
+template <typename T>
+using ObjectFetcher = std::function<T*(const std::string& path, long timestamp, ValidityInterval& validity)>;
+
+/// Prefix of the CCDB url to use a local ROOT file instead of the CCDB
+static constexpr const char* LocalFileUrlPrefix = "local://";
+
+/// Prefix of the CCDB url to use a snapshot file written by the ccdb-snapshot tool instead of the CCDB
+static constexpr const char* SnapshotUrlPrefix = CCDBSnapshot::UrlPrefix;
+
+/// Checks if the url points to a CCDB snapshot file
+inline bool isSnapshotUrl(const std::string& url)
+{
+  return url.rfind(SnapshotUrlPrefix, 0) == 0;
+}
+
+/// Checks if the url points to a local file (ROOT file or CCDB snapshot) standing in for the CCDB
+inline bool isLocalFileUrl(const std::string& url)
+{
+  return url.rfind(LocalFileUrlPrefix, 0) == 0 || isSnapshotUrl(url);
+}
+
+/// Fetcher from the CCDB, the validity interval is taken from the headers of the object
+/// \param api CCDB api, already initialized with the url (e.g. the accessor of the CCDB manager)
+/// \param createdNotAfter Only objects created before this timestamp are considered
+template <typename T>
+ObjectFetcher<T> getCCDBFetcher(o2::ccdb::CcdbApi& api, long createdNotAfter)
+{
+  return [&api, createdNotAfter](const std::string& path, long timestamp, ValidityInterval& validity) -> T* {
+    std::map<std::string, std::string> metadata, headers;
+    CCDBSnapshot::record(path, timestamp);
+    T* object = api.retrieveFromTFileAny<T>(path, metadata, timestamp, &headers, "", std::to_string(createdNotAfter));
+    const auto from = headers.find("Valid-From");
+    const auto until = headers.find("Valid-Until");
+    if (from != headers.end() && until != headers.end()) {
+      validity.from = std::stol(from->second);
+      validity.until = std::stol(until->second);
+    } else { // Unknown validity, only valid for this timestamp
+      validity.from = timestamp;
+      validity.until = timestamp + 1;
+    }
+    return object;
+  };
+}
+
+/// Fetcher from a local ROOT file standing in for the CCDB, e.g. for offline tests.
+/// The objects of a CCDB path are stored in the directory with the same name, each one
+/// with the name "<from>_<until>" giving its validity interval in ms.
+/// A negative timestamp gets the object with the latest start of validity.
+template <typename T>
+ObjectFetcher<T> getLocalFileFetcher(const std::string& fileName)
+{
+  return [fileName](const std::string& path, long timestamp, ValidityInterval& validity) -> T* {
+    std::unique_ptr<TFile> f(TFile::Open(fileName.c_str(), "READ"));
+    if (!f || f->IsZombie()) {
+      LOGF(error, "Cannot open the local CCDB file %s", fileName.c_str());
+      return nullptr;
+    }
+    TDirectory* dir = f->GetDirectory(path.c_str());
+    if (!dir) {
+      LOGF(error, "Path %s not found in the local CCDB file %s", path.c_str(), fileName.c_str());
+      return nullptr;
+    }
+    const char* found = nullptr;
+    for (auto key : *dir->GetListOfKeys()) {
+      ValidityInterval interval;
+      if (sscanf(key->GetName(), "%ld_%ld", &interval.from, &interval.until) != 2) {
+        continue;
+      }
+      if (timestamp < 0 ? (!found || interval.from > validity.from) : interval.contains(timestamp)) {
+        found = key->GetName();
+        validity = interval;
+      }
+    }
+    if (!found) {
+      return nullptr;
+    }
+    return dir->Get<T>(found);
+  };
+}
+
+/// Fetcher from a CCDB snapshot file, see CCDBSnapshot
+template <typename T>
+ObjectFetcher<T> getSnapshotFetcher(const std::string& fileName)
+{
+  CCDBSnapshot& snapshot = CCDBSnapshot::open(fileName);
+  return [&snapshot](const std::string& path, long timestamp, ValidityInterval& validity) -> T* {
+    return snapshot.retrieveObject<T>(path, timestamp, validity.from, validity.until);
+  };
+}
+
+/// Fetcher from the CCDB, from the local ROOT file if the url is of the form "local://<file name>"
+/// or from the CCDB snapshot if the url is of the form "snapshot://<file name>"
+template <typename T>
+ObjectFetcher<T> getFetcher(o2::ccdb::CcdbApi& api, const std::string& url, long createdNotAfter)
+{
+  if (isSnapshotUrl(url)) {
+    return getSnapshotFetcher<T>(url.substr(std::string(SnapshotUrlPrefix).size()));
+  }
+  if (isLocalFileUrl(url)) {
+    return getLocalFileFetcher<T>(url.substr(std::string(LocalFileUrlPrefix).size()));
+  }
+  return getCCDBFetcher<T>(api, createdNotAfter);
+}
+
+/// Keeps a CCDB object and its validity interval.
+/// The object is retrieved and its user configured again only when the timestamp leaves the validity interval.
+template <typename T>
+class CCDBObjectCache
+{
+ public:
+  /// Configures the user (e.g. a response) from the object. The object is owned by the cache and stays valid until the next update.
+  using Setup = std::function<void(T* object)>;
+
+  CCDBObjectCache() = default;
+
+  /// \param fetcher Source of the objects
+  /// \param path Path of the object
+  /// \param setup Configuration of the user from the object
+  void init(ObjectFetcher<T> fetcher, const std::string& path, Setup setup)
+  {
+    mFetcher = std::move(fetcher);
+    mPath = path;
+    mSetup = std::move(setup);
+    mValidity = ValidityInterval{};
+  }
+
+  /// Makes sure that the user is configured with the object valid at the timestamp
+  /// \return true if the object had to be retrieved
+  bool update(long timestamp)
+  {
+    if (mObject && mValidity.contains(timestamp)) {
+      return false;
+    }
+    ValidityInterval validity;
+    std::unique_ptr<T> object(mFetcher(mPath, timestamp, validity));
+    if (!object) {
+      LOGF(fatal, "Could not retrieve %s for timestamp %ld", mPath.c_str(), timestamp);
+    }
+    mSetup(object.get());
+    mObject = std::move(object);
+    mValidity = validity;
+    mNFetches++;
+    LOGF(info, "Configured from %s valid in [%ld, %ld) for timestamp %ld", mPath.c_str(), mValidity.from, mValidity.until, timestamp);
+    return true;
+  }
+
+  const ValidityInterval& getValidity() const { return mValidity; }
+  int getNFetches() const { return mNFetches; }
+
+ private:
+  ObjectFetcher<T> mFetcher{};
+  std::string mPath{};
+  Setup mSetup{};
+  std::unique_ptr<T> mObject{};
+  ValidityInterval mValidity{};
+  int mNFetches = 0;
+};
+
+} // namespace o2::analysis
+
+#endif // O2_ANALYSIS_CCDBOBJECTCACHE_H_
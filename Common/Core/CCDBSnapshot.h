@@ -0,0 +1,373 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   CCDBSnapshot.h
+/// \brief  Local snapshot of CCDB objects (path, validity, headers and blob) in a single indexed file.
+///         The snapshot is written by the ccdb-snapshot tool and read through a memory-mapped view,
+///         so that workflows can run without network access and with deterministic timing.
+///         Only the tasks taking their objects through CCDBSnapshot::getObject or the fetchers of
+///         Common/Core/CCDBObjectCache.h read the snapshot (timestamp, event selection, PID, centrality,
+///         track propagation, lambdakzerobuilder), the other users of the BasicCCDBManager still need the CCDB.
+///         The objects these tasks request from the CCDB are listed in the file given by the environment
+///         variable O2_CCDB_SNAPSHOT_RECORD, ready to be passed to the ccdb-snapshot tool.
+///
+
+#ifndef CCDBSnapshot_H
+#define CCDBSnapshot_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Framework/Logger.h"
+// ROOT includes
+#include "TMemFile.h"
+
+// O2 includes
+#include <CCDB/CcdbApi.h>
+
+/// File layout (native byte order):
+///  - Header
+///  - Header::nEntries entries
+///  - data: paths, headers (as "key\0value\0" pairs) and blobs, referenced by the entries
+namespace ccdbsnapshot
+{
+static constexpr char Magic[8] = {'O', '2', 'C', 'C', 'D', 'B', 'S', '1'};
+
+struct Header {
+  char magic[8];
+  uint64_t nEntries;
+};
+
+struct Entry {
+  uint64_t pathOffset;
+  uint64_t pathSize;
+  uint64_t headersOffset;
+  uint64_t headersSize;
+  uint64_t blobOffset;
+  uint64_t blobSize;
+  int64_t from;  // start of validity in ms
+  int64_t until; // end of validity in ms, excluded
+};
+} // namespace ccdbsnapshot
+
+/// Collects CCDB objects and writes them into a snapshot file
+class CCDBSnapshotWriter
+{
+ public:
+  /// Adds an object, objects of the same path with the same validity interval are only stored once
+  /// \return false if the object was already there
+  bool add(const std::string& path, long from, long until, const std::map<std::string, std::string>& headers, std::vector<char> blob)
+  {
+    for (const auto& object : mObjects) {
+      if (object.path == path && object.from == from && object.until == until) {
+        return false;
+      }
+    }
+    mObjects.push_back(Object{path, from, until, headers, std::move(blob)});
+    return true;
+  }
+
+  std::size_t size() const { return mObjects.size(); }
+
+  /// Writes the snapshot file
+  /// \return true on success
+  bool write(const std::string& fileName) const
+  {
+    ccdbsnapshot::Header header;
+    std::memcpy(header.magic, ccdbsnapshot::Magic, sizeof(header.magic));
+    header.nEntries = mObjects.size();
+    std::vector<ccdbsnapshot::Entry> entries;
+    std::string data;
+    uint64_t offset = sizeof(header) + mObjects.size() * sizeof(ccdbsnapshot::Entry);
+    auto append = [&data, &offset](const char* bytes, std::size_t size, uint64_t& entryOffset, uint64_t& entrySize) {
+      entryOffset = offset + data.size();
+      entrySize = size;
+      data.append(bytes, size);
+    };
+    for (const auto& object : mObjects) {
+      ccdbsnapshot::Entry entry;
+      append(object.path.data(), object.path.size(), entry.pathOffset, entry.pathSize);
+      std::string headers;
+      for (const auto& [key, value] : object.headers) {
+        headers.append(key).push_back('\0');
+        headers.append(value).push_back('\0');
+      }
+      append(headers.data(), headers.size(), entry.headersOffset, entry.headersSize);
+      append(object.blob.data(), object.blob.size(), entry.blobOffset, entry.blobSize);
+      entry.from = object.from;
+      entry.until = object.until;
+      entries.push_back(entry);
+    }
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ccdbsnapshot::Entry));
+    out.write(data.data(), data.size());
+    out.close();
+    if (!out) {
+      LOGF(error, "Cannot write the CCDB snapshot %s", fileName.c_str());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  struct Object {
+    std::string path;
+    long from;
+    long until;
+    std::map<std::string, std::string> headers;
+    std::vector<char> blob;
+  };
+  std::vector<Object> mObjects{};
+};
+
+/// Read-only memory-mapped view of a snapshot file, serving objects and headers with the interface of the CCDB.
+/// A negative timestamp selects the object of the path with the latest start of validity.
+class CCDBSnapshot
+{
+ public:
+  explicit CCDBSnapshot(const std::string& fileName) : mFileName(fileName)
+  {
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || ::fstat(fd, &status) != 0) {
+      LOGF(fatal, "Cannot open the CCDB snapshot %s", fileName.c_str());
+    }
+    mSize = status.st_size;
+    if (mSize >= sizeof(ccdbsnapshot::Header)) {
+      void* data = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      mData = data == MAP_FAILED ? nullptr : static_cast<const char*>(data);
+    }
+    ::close(fd);
+    if (!mData) {
+      LOGF(fatal, "Cannot map the CCDB snapshot %s", fileName.c_str());
+    }
+    const auto* header = reinterpret_cast<const ccdbsnapshot::Header*>(mData);
+    if (std::memcmp(header->magic, ccdbsnapshot::Magic, sizeof(header->magic)) != 0 ||
+        header->nEntries > (mSize - sizeof(ccdbsnapshot::Header)) / sizeof(ccdbsnapshot::Entry)) {
+      LOGF(fatal, "%s is not a CCDB snapshot", fileName.c_str());
+    }
+    const auto* entries = reinterpret_cast<const ccdbsnapshot::Entry*>(mData + sizeof(ccdbsnapshot::Header));
+    for (uint64_t i = 0; i < header->nEntries; i++) {
+      const auto& entry = entries[i];
+      if (!inFile(entry.pathOffset, entry.pathSize) || !inFile(entry.headersOffset, entry.headersSize) || !inFile(entry.blobOffset, entry.blobSize)) {
+        LOGF(fatal, "Corrupted entry %lu in the CCDB snapshot %s", i, fileName.c_str());
+      }
+      mIndex[std::string(mData + entry.pathOffset, entry.pathSize)].push_back(&entry);
+    }
+    for (auto& [path, pathEntries] : mIndex) {
+      std::stable_sort(pathEntries.begin(), pathEntries.end(), [](const ccdbsnapshot::Entry* a, const ccdbsnapshot::Entry* b) { return a->from < b->from; });
+    }
+    LOGF(info, "Opened the CCDB snapshot %s with %lu objects in %zu paths", fileName.c_str(), header->nEntries, mIndex.size());
+  }
+
+  ~CCDBSnapshot()
+  {
+    mObjects.clear(); // the objects are deleted before the data they may point to is unmapped
+    if (mData) {
+      ::munmap(const_cast<char*>(mData), mSize);
+    }
+  }
+
+  CCDBSnapshot(const CCDBSnapshot&) = delete;
+  CCDBSnapshot& operator=(const CCDBSnapshot&) = delete;
+
+  /// Gets the snapshot of a file, which is opened only once per process
+  static CCDBSnapshot& open(const std::string& fileName)
+  {
+    static std::map<std::string, std::unique_ptr<CCDBSnapshot>> snapshots;
+    auto& snapshot = snapshots[fileName];
+    if (!snapshot) {
+      snapshot = std::make_unique<CCDBSnapshot>(fileName);
+    }
+    return *snapshot;
+  }
+
+  /// Prefix of the CCDB url to read the objects from a snapshot file instead of the CCDB
+  static constexpr const char* UrlPrefix = "snapshot://";
+
+  /// Gets the snapshot if the url is of the form "snapshot://<file name>", nullptr for any other url
+  static CCDBSnapshot* fromUrl(const std::string& url)
+  {
+    if (url.rfind(UrlPrefix, 0) != 0) {
+      return nullptr;
+    }
+    return &open(url.substr(std::strlen(UrlPrefix)));
+  }
+
+  /// Environment variable with the file where the objects requested from the CCDB are recorded
+  static constexpr const char* RecordFileVariable = "O2_CCDB_SNAPSHOT_RECORD";
+
+  /// Records a request to the CCDB in the format of the object list of the ccdb-snapshot tool,
+  /// if the environment variable O2_CCDB_SNAPSHOT_RECORD gives the file to append it to.
+  /// Each request is recorded once per process.
+  static void record(const std::string& path, long timestamp)
+  {
+    static const char* fileName = std::getenv(RecordFileVariable);
+    if (!fileName || !*fileName) {
+      return;
+    }
+    static std::mutex mutex;
+    static std::set<std::pair<std::string, long>> recorded;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!recorded.emplace(path, timestamp).second) {
+      return;
+    }
+    std::ofstream out(fileName, std::ios::app);
+    out << path << " " << timestamp << "\n";
+    if (!out) {
+      LOGF(error, "Cannot record the CCDB request %s %ld in %s", path.c_str(), timestamp, fileName);
+    }
+  }
+
+  /// Gets the object valid at the timestamp (the latest one for a negative timestamp) from the snapshot if there is one,
+  /// otherwise from the CCDB through the manager (e.g. the Service<o2::ccdb::BasicCCDBManager> of a task), recording the request
+  template <typename T, typename Manager>
+  static T* getObject(CCDBSnapshot* snapshot, Manager& ccdb, const std::string& path, long timestamp = -1)
+  {
+    if (snapshot) {
+      return snapshot->getForTimeStamp<T>(path, timestamp);
+    }
+    record(path, timestamp);
+    return timestamp < 0 ? ccdb->template get<T>(path) : ccdb->template getForTimeStamp<T>(path, timestamp);
+  }
+
+  const std::string& getFileName() const { return mFileName; }
+
+  /// \return the entry of the object valid at the timestamp, nullptr if there is none
+  const ccdbsnapshot::Entry* find(const std::string& path, long timestamp) const
+  {
+    const auto pathEntries = mIndex.find(path);
+    if (pathEntries == mIndex.end() || pathEntries->second.empty()) {
+      return nullptr;
+    }
+    const auto& entries = pathEntries->second;
+    if (timestamp < 0) {
+      return entries.back();
+    }
+    // Latest start of validity not after the timestamp, going back in case of overlapping intervals
+    auto it = std::upper_bound(entries.begin(), entries.end(), timestamp, [](long ts, const ccdbsnapshot::Entry* entry) { return ts < entry->from; });
+    while (it != entries.begin()) {
+      --it;
+      if (timestamp < (*it)->until) {
+        return *it;
+      }
+    }
+    return nullptr;
+  }
+
+  /// Headers of the object valid at the timestamp, including its validity interval as in the CCDB.
+  /// Empty if there is no such object.
+  std::map<std::string, std::string> retrieveHeaders(const std::string& path, const std::map<std::string, std::string>& /*metadata*/, long timestamp) const
+  {
+    std::map<std::string, std::string> headers;
+    const auto* entry = find(path, timestamp);
+    if (!entry) {
+      logMissing(path, timestamp);
+      return headers;
+    }
+    const char* pos = mData + entry->headersOffset;
+    const char* end = pos + entry->headersSize;
+    while (pos < end) {
+      const char* key = pos;
+      pos += std::strlen(key) + 1;
+      if (pos >= end) {
+        break;
+      }
+      headers[key] = pos;
+      pos += std::strlen(pos) + 1;
+    }
+    headers["Valid-From"] = std::to_string(entry->from);
+    headers["Valid-Until"] = std::to_string(entry->until);
+    return headers;
+  }
+
+  /// Gets the object valid at the timestamp, as BasicCCDBManager::getForTimeStamp.
+  /// The object is deserialized once and owned by the snapshot.
+  template <typename T>
+  T* getForTimeStamp(const std::string& path, long timestamp)
+  {
+    const auto* entry = find(path, timestamp);
+    if (!entry) {
+      logMissing(path, timestamp);
+      return nullptr;
+    }
+    auto& object = mObjects[entry];
+    if (!object) {
+      object = std::shared_ptr<void>(extract<T>(*entry), [](void* p) { delete static_cast<T*>(p); });
+    }
+    return static_cast<T*>(object.get());
+  }
+
+  /// Gets the latest object of the path, as BasicCCDBManager::get
+  template <typename T>
+  T* get(const std::string& path)
+  {
+    return getForTimeStamp<T>(path, -1);
+  }
+
+  /// Gets a new copy of the object valid at the timestamp and its validity interval, the caller takes the ownership
+  template <typename T>
+  T* retrieveObject(const std::string& path, long timestamp, long& from, long& until) const
+  {
+    const auto* entry = find(path, timestamp);
+    if (!entry) {
+      logMissing(path, timestamp);
+      return nullptr;
+    }
+    from = entry->from;
+    until = entry->until;
+    return extract<T>(*entry);
+  }
+
+ private:
+  bool inFile(uint64_t offset, uint64_t size) const { return offset <= mSize && size <= mSize - offset; }
+
+  /// Prints the request in the format of the object list of the ccdb-snapshot tool
+  void logMissing(const std::string& path, long timestamp) const
+  {
+    LOGF(error, "Object not found in the CCDB snapshot %s, to add it: %s %ld", mFileName.c_str(), path.c_str(), timestamp);
+  }
+
+  template <typename T>
+  T* extract(const ccdbsnapshot::Entry& entry) const
+  {
+    TMemFile file(std::string(mData + entry.pathOffset, entry.pathSize).c_str(), TMemFile::ZeroCopyView_t(mData + entry.blobOffset, entry.blobSize));
+    T* object = o2::ccdb::CcdbApi::extractFromTFile<T>(file);
+    if (!object) {
+      LOGF(error, "Cannot read %s valid in [%ld, %ld) from the CCDB snapshot %s", std::string(mData + entry.pathOffset, entry.pathSize).c_str(), entry.from, entry.until, mFileName.c_str());
+    }
+    return object;
+  }
+
+  std::string mFileName{};
+  const char* mData = nullptr;
+  std::size_t mSize = 0;
+  std::map<std::string, std::vector<const ccdbsnapshot::Entry*>> mIndex{};
+  std::map<const ccdbsnapshot::Entry*, std::shared_ptr<void>> mObjects{};
+};
+
+#endif
@@ -12,8 +12,202 @@
 #ifndef ANALYSIS_CORE_EVENTMIXING_H_
 #define ANALYSIS_CORE_EVENTMIXING_H_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
 namespace eventmixing
 {
+/// Finds the bin of a value in a list of increasing bin edges.
+/// Bins are [edge_i, edge_i+1), values below the first edge, not below the last edge or NaN are outside.
+/// \param edges Bin edges
+/// \param value Value
+/// \return Bin index starting from 0, -1 if the value is outside the edges
+template <typename T1, typename T2>
+static int findBin(const T1& edges, const T2& value)
+{
+  if (std::size(edges) < 2 || !(value >= *std::begin(edges) && value < *std::prev(std::end(edges)))) {
+    return -1;
+  }
+  return std::upper_bound(std::begin(edges), std::end(edges), value) - std::begin(edges) - 1;
+}
+
+/// Binning of one mixing variable with precomputed edges.
+/// Uniform binnings are looked up arithmetically, the others with a binary search.
+/// The result is the same as for findBin in both cases.
+class BinningAxis
+{
+ public:
+  BinningAxis() = default;
+
+  /// \param edges Increasing bin edges
+  /// \param nEdges Number of bin edges
+  template <typename T>
+  BinningAxis(const T* edges, std::size_t nEdges) : mEdges(edges, edges + nEdges)
+  {
+    init();
+  }
+
+  /// \param edges Container of increasing bin edges
+  template <typename T>
+  explicit BinningAxis(const T& edges) : mEdges(std::begin(edges), std::end(edges))
+  {
+    init();
+  }
+
+  int getNBins() const { return mNBins; }
+  bool isUniform() const { return mUniform; }
+  const std::vector<double>& getEdges() const { return mEdges; }
+
+  /// \param value Value
+  /// \return Bin index starting from 0, -1 if the value is outside the edges
+  int findBin(double value) const
+  {
+    if (!(value >= mMin && value < mMax)) {
+      return -1;
+    }
+    if (!mUniform) {
+      return std::upper_bound(mEdges.begin(), mEdges.end(), value) - mEdges.begin() - 1;
+    }
+    int bin = std::min(static_cast<int>((value - mMin) * mInvWidth), mNBins - 1);
+    // correct the rounding of the arithmetic estimate against the actual edges
+    while (value < mEdges[bin]) {
+      --bin;
+    }
+    while (value >= mEdges[bin + 1]) {
+      ++bin;
+    }
+    return bin;
+  }
+
+ private:
+  void init()
+  {
+    if (mEdges.size() < 2) {
+      return;
+    }
+    mNBins = mEdges.size() - 1;
+    mMin = mEdges.front();
+    mMax = mEdges.back();
+    double width = (mMax - mMin) / mNBins;
+    mUniform = width > 0.;
+    for (int i = 0; mUniform && i < mNBins; i++) {
+      mUniform = mEdges[i + 1] > mEdges[i] && std::abs(mEdges[i + 1] - mEdges[i] - width) <= 1.e-5 * width;
+    }
+    if (mUniform) {
+      mInvWidth = 1. / width;
+    }
+  }
+
+  std::vector<double> mEdges{};
+  int mNBins = 0;
+  double mMin = 0.;
+  double mMax = 0.;
+  double mInvWidth = 0.;
+  bool mUniform = false;
+};
+
+/// N-dimensional binning of the mixing variables.
+/// The bin number is offset + sum_i(bin_i * stride_i), -1 if any of the variables is outside its axis.
+/// By default, the offset is 0 and the strides follow the order of the axes with the last one running fastest.
+class MixingBinning
+{
+ public:
+  MixingBinning() = default;
+
+  /// Adds the binning of the next mixing variable
+  void addAxis(BinningAxis axis)
+  {
+    for (auto& stride : mStrides) {
+      stride *= axis.getNBins();
+    }
+    mAxes.push_back(std::move(axis));
+    mStrides.push_back(1);
+  }
+
+  /// Overrides the default numbering of the bins
+  /// \param strides Stride of each axis
+  /// \param offset Number of the bin with all the variables in their first bin
+  void setLayout(std::vector<int> strides, int offset)
+  {
+    mStrides = std::move(strides);
+    mOffset = offset;
+  }
+
+  std::size_t getNAxes() const { return mAxes.size(); }
+  const BinningAxis& getAxis(std::size_t i) const { return mAxes[i]; }
+
+  /// Total number of bins of the default numbering
+  int getNBins() const
+  {
+    int nBins = mAxes.empty() ? 0 : 1;
+    for (const auto& axis : mAxes) {
+      nBins *= axis.getNBins();
+    }
+    return nBins;
+  }
+
+  /// \param values Values of the mixing variables, in the order of the axes
+  /// \return Bin number, -1 if outside the binning
+  int getBin(std::initializer_list<double> values) const
+  {
+    if (values.size() != mAxes.size()) {
+      return -1;
+    }
+    int bin = mOffset;
+    auto value = values.begin();
+    for (std::size_t i = 0; i < mAxes.size(); i++, value++) {
+      int binAxis = mAxes[i].findBin(*value);
+      if (binAxis < 0) {
+        return -1;
+      }
+      bin += binAxis * mStrides[i];
+    }
+    return bin;
+  }
+
+  /// \param values Array of values, indexed by variable
+  /// \param variables Variable (index in values) of each axis
+  /// \return Bin number, -1 if outside the binning
+  template <typename T>
+  int getBin(const T* values, const int* variables) const
+  {
+    int bin = mOffset;
+    for (std::size_t i = 0; i < mAxes.size(); i++) {
+      int binAxis = mAxes[i].findBin(values[variables[i]]);
+      if (binAxis < 0) {
+        return -1;
+      }
+      bin += binAxis * mStrides[i];
+    }
+    return bin;
+  }
+
+ private:
+  std::vector<BinningAxis> mAxes{};
+  std::vector<int> mStrides{};
+  int mOffset = 0;
+};
+
+/// Builds the z-vertex and multiplicity binning with the same bin numbering as getMixingBin
+/// \tparam T Data type of the configurable of the z-vertex and multiplicity bins
+/// \param vtxBins Binning in z-vertex
+/// \param multBins Binning in multiplicity
+template <typename T>
+static MixingBinning getMixingBinning(const T& vtxBins, const T& multBins)
+{
+  MixingBinning binning;
+  binning.addAxis(BinningAxis(vtxBins));
+  binning.addAxis(BinningAxis(multBins));
+  int nVtx = std::size(vtxBins);
+  binning.setLayout({1, nVtx + 1}, 1 + (nVtx + 1));
+  return binning;
+}
+
 /// Calculate hash for an element based on 2 properties and their bins.
 /// \tparam T1 Data type of the configurable of the z-vertex and multiplicity bins
 /// \tparam T2 Data type of the value of the z-vertex and multiplicity
@@ -22,28 +216,17 @@ namespace eventmixing
 /// \param vtx Value of the z-vertex of the collision
 /// \param mult Multiplicity of the collision
 /// \return Hash of the event
+/// \note Use getMixingBinning when the same bins are used for many events.
 template <typename T1, typename T2>
 static int getMixingBin(const T1& vtxBins, const T1& multBins, const T2& vtx, const T2& mult)
 {
-  // underflow
-  if (vtx < vtxBins.at(0)) {
-    return -1;
-  }
-  if (mult < multBins.at(0)) {
+  int binVtx = findBin(vtxBins, vtx);
+  int binMult = findBin(multBins, mult);
+  // underflow or overflow
+  if (binVtx < 0 || binMult < 0) {
     return -1;
   }
-
-  for (unsigned int i = 1; i < vtxBins.size(); i++) {
-    if (vtx < vtxBins.at(i)) {
-      for (unsigned int j = 1; j < multBins.size(); j++) {
-        if (mult < multBins.at(j)) {
-          return i + j * (vtxBins.size() + 1);
-        }
-      }
-    }
-  }
-  // overflow
-  return -1;
+  return (binVtx + 1) + (binMult + 1) * (std::size(vtxBins) + 1);
 }
 }; // namespace eventmixing
 
@@ -0,0 +1,133 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   BetheBlochTable.h
+/// \brief  Lookup table of the ALEPH Bethe-Bloch parametrization in log(βγ) with cubic interpolation.
+///         The table is built once per parameter set and its accuracy is validated against the analytic formula.
+///
+
+#ifndef O2_PID_TPC_BETHEBLOCHTABLE_H_
+#define O2_PID_TPC_BETHEBLOCHTABLE_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include "Framework/Logger.h"
+// O2 includes
+#include "DataFormatsTPC/BetheBlochAleph.h"
+
+namespace o2::pid::tpc
+{
+
+/// \brief Tabulated BetheBlochAleph
+///
+/// The values are tabulated on a uniform grid in log(βγ) and interpolated with Catmull-Rom splines.
+/// The number of nodes is doubled until the relative difference to the analytic formula, checked at
+/// 7 points inside each interval, is below half of the requested maximum, as margin for the points in between.
+/// Outside of the tabulated βγ range the analytic formula is used.
+class BetheBlochTable
+{
+ public:
+  BetheBlochTable() = default;
+  ~BetheBlochTable() = default;
+
+  static constexpr int MinIntervals = 256;
+  static constexpr int MaxIntervals = 1 << 16;
+  static constexpr int NCheckPoints = 8; // the accuracy is checked at k / NCheckPoints of each interval, k = 1 .. NCheckPoints - 1
+
+  /// Builds the table for a set of parameters
+  /// \param params Parameters of BetheBlochAleph
+  /// \param maxRelError Maximum relative difference to the analytic formula
+  /// \param bgMin Lower edge of the tabulated βγ range, the default is above the zero crossing of the formula for the default parameters
+  /// \param bgMax Upper edge of the tabulated βγ range
+  /// \return true if the requested accuracy is reached, otherwise the analytic formula is used everywhere
+  bool Init(const std::array<float, 5>& params, const float maxRelError, const float bgMin = 0.05f, const float bgMax = 1.e5f)
+  {
+    mParams = params;
+    mBgMin = bgMin;
+    mBgMax = bgMax;
+    mXMin = std::log(bgMin);
+    mValid = false;
+    const double xMin = std::log(static_cast<double>(bgMin));
+    const double xMax = std::log(static_cast<double>(bgMax));
+    for (int nIntervals = MinIntervals; nIntervals <= MaxIntervals; nIntervals *= 2) {
+      const double step = (xMax - xMin) / nIntervals;
+      mNIntervals = nIntervals;
+      mInvStep = 1. / step;
+      // one node more on each side for the interpolation of the first and last intervals
+      mValues.resize(nIntervals + 3);
+      for (int i = 0; i < nIntervals + 3; i++) {
+        mValues[i] = Analytic(static_cast<float>(std::exp(xMin + (i - 1) * step)));
+      }
+      mMaxRelError = 0.f;
+      for (int i = 0; i < nIntervals; i++) {
+        for (int k = 1; k < NCheckPoints; k++) {
+          const float bg = std::exp(xMin + (i + static_cast<double>(k) / NCheckPoints) * step);
+          const float exact = Analytic(bg);
+          mMaxRelError = std::max(mMaxRelError, std::abs(Interpolate(bg) - exact) / std::abs(exact));
+        }
+      }
+      if (mMaxRelError <= 0.5f * maxRelError) {
+        mValid = true;
+        LOGF(info, "Bethe-Bloch table with %d intervals in βγ [%g, %g], maximum relative error %g", mNIntervals, mBgMin, mBgMax, mMaxRelError);
+        return true;
+      }
+    }
+    LOGF(warning, "Bethe-Bloch table cannot reach the relative error %g (%g with %d intervals), using the analytic formula", maxRelError, mMaxRelError, mNIntervals);
+    mValues.clear();
+    return false;
+  }
+
+  /// \return true if the table is used
+  bool IsValid() const { return mValid; }
+  /// \return maximum relative difference to the analytic formula found at construction
+  float GetMaxRelError() const { return mMaxRelError; }
+  /// \return number of intervals of the table
+  int GetNIntervals() const { return mNIntervals; }
+
+  /// Gets the value of BetheBlochAleph
+  /// \param bg βγ of the particle
+  float operator()(const float bg) const
+  {
+    if (!mValid || !(bg >= mBgMin && bg < mBgMax)) {
+      return Analytic(bg);
+    }
+    return Interpolate(bg);
+  }
+
+ private:
+  float Analytic(const float bg) const { return o2::tpc::BetheBlochAleph(bg, mParams[0], mParams[1], mParams[2], mParams[3], mParams[4]); }
+
+  float Interpolate(const float bg) const
+  {
+    const float x = (std::log(bg) - mXMin) * mInvStep;
+    const int i = std::min(std::max(static_cast<int>(x), 0), mNIntervals - 1);
+    const float t = x - i;
+    const float* v = mValues.data() + i; // v[1] and v[2] are the edges of the interval
+    return v[1] + 0.5f * t * (v[2] - v[0] + t * (2.f * v[0] - 5.f * v[1] + 4.f * v[2] - v[3] + t * (3.f * (v[1] - v[2]) + v[3] - v[0])));
+  }
+
+  std::array<float, 5> mParams{};
+  std::vector<float> mValues{};
+  float mBgMin = 0.f;
+  float mBgMax = 0.f;
+  float mXMin = 0.f;
+  float mInvStep = 0.f;
+  float mMaxRelError = 0.f;
+  int mNIntervals = 0;
+  bool mValid = false;
+};
+
+} // namespace o2::pid::tpc
+
+#endif // O2_PID_TPC_BETHEBLOCHTABLE_H_
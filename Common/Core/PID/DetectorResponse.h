@@ -72,6 +72,12 @@ class DetectorResponse
   /// \param x array with parameters
   pidvar_t operator()(const Param_t ptype, const pidvar_t* x) const { return mParam[ptype]->operator()(x); }
 
+  /// Getter for the values of the parametrization for a batch of inputs, dispatched once to the parametrization
+  /// \param ptype parametrization type
+  /// \param x array with the parameters of all the inputs, y.size() consecutive blocks of the same size
+  /// \param y array of the values
+  void operator()(const Param_t ptype, gsl::span<const pidvar_t> x, gsl::span<pidvar_t> y) const { mParam[ptype]->Evaluate(x, y); }
+
  private:
   /// Parametrizations for the expected signal and sigma
   std::array<Parametrization*, kNParams> mParam;
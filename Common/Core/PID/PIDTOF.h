@@ -19,6 +19,9 @@
 #ifndef O2_FRAMEWORK_PIDTOF_H_
 #define O2_FRAMEWORK_PIDTOF_H_
 
+#include <array>
+#include <cstdint>
+
 // ROOT includes
 #include "Rtypes.h"
 #include "TMath.h"
@@ -147,12 +150,29 @@ class ExpTimes
     if (!track.hasTOF()) {
       return defaultReturnValue;
     }
-    // const float x[7] = {track.p(), tofSignal, collisionTimeRes, o2::track::PID::getMass2Z(id), track.length(), track.sigma1Pt(), track.pt()};
-    const float x[4] = {track.p(), tofSignal, collisionTimeRes, o2::track::PID::getMass2Z(id)};
+    float x[nSigmaVariables];
+    GetExpectedSigmaVariables(track, tofSignal, collisionTimeRes, x);
     const float reso = response(response.kSigma, x);
     return reso >= 0.f ? reso : 0.f;
   }
 
+  /// Number of variables of the parametrization of the expected resolution
+  static constexpr int nSigmaVariables = 4;
+
+  /// Fills the variables of the parametrization of the expected resolution
+  /// \param track Track of interest
+  /// \param tofSignal TOF signal of the track of interest
+  /// \param collisionTimeRes Collision time resolution of the track of interest
+  /// \param x Array of nSigmaVariables variables to fill
+  static void GetExpectedSigmaVariables(const TrackType& track, const float& tofSignal, const float& collisionTimeRes, float* x)
+  {
+    // const float x[7] = {track.p(), tofSignal, collisionTimeRes, o2::track::PID::getMass2Z(id), track.length(), track.sigma1Pt(), track.pt()};
+    x[0] = track.p();
+    x[1] = tofSignal;
+    x[2] = collisionTimeRes;
+    x[3] = o2::track::PID::getMass2Z(id);
+  }
+
   /// Gets the expected resolution of the t-texp-t0
   /// \param response Detector response with parameters
   /// \param track Track of interest
@@ -204,6 +224,72 @@ class ExpTimes
   static float GetSeparationFromTrackTime(const DetectorResponse& response, const TrackType& track) { return track.has_collision() ? GetSeparationFromTrackTime(response, track, track.collision().collisionTime() * 1000.f, track.collision().collisionTimeRes() * 1000.f) : defaultReturnValue; }
 };
 
+/// \brief Class to handle the the TOF detector response of a track for all the mass hypotheses at once
+template <typename TrackType>
+class ExpTimesAllSpecies
+{
+ public:
+  ExpTimesAllSpecies() = default;
+  ~ExpTimesAllSpecies() = default;
+
+  /// Number of particle species handled by GetResponse
+  static constexpr int NSpecies = o2::track::PID::NIDs;
+  using SpeciesArray = std::array<float, NSpecies>;
+
+  /// Gets the expected resolution and the number of sigmas of the track for all the particle species at once.
+  /// The terms depending only on the track are computed once and the parametrization is evaluated for all the species in one batch,
+  /// the results are the same as for ExpTimes::GetExpectedSigma(response, track, track.tofSignal(), collisionTimeRes) and
+  /// ExpTimes::GetSeparation(response, track, collisionTime, collisionTimeRes).
+  /// \param response Detector response with parameters
+  /// \param track Track of interest
+  /// \param collisionTime Collision time
+  /// \param collisionTimeRes Collision time resolution of the track of interest
+  /// \param speciesMask bit i set if species i has to be computed, the entries of the other species are not modified
+  static void GetResponse(const DetectorResponse& response, const TrackType& track, const float& collisionTime, const float& collisionTimeRes,
+                          SpeciesArray& expSigma, SpeciesArray& nSigma, const uint32_t speciesMask = ~0u)
+  {
+    using ExpTimesEl = ExpTimes<TrackType, o2::track::PID::Electron>; // the expected time does not depend on the template species
+    constexpr int nVariables = ExpTimesEl::nSigmaVariables;
+    if (!track.hasTOF()) {
+      for (int id = 0; id < NSpecies; id++) {
+        if (speciesMask & (1u << id)) {
+          expSigma[id] = defaultReturnValue;
+          nSigma[id] = defaultReturnValue;
+        }
+      }
+      return;
+    }
+    // Terms depending only on the track
+    const float tofSignal = track.tofSignal();
+    const float p = track.p();
+    const float length = track.length();
+    const float tofExpMom = track.trackType() == o2::aod::track::Run2Track ? track.tofExpMom() / kCSPEED : track.tofExpMom();
+
+    std::array<float, NSpecies * nVariables> x;
+    std::array<float, NSpecies> delta, reso;
+    std::array<o2::track::PID::ID, NSpecies> ids;
+    int n = 0;
+    for (o2::track::PID::ID id = 0; id < NSpecies; id++) {
+      if (!(speciesMask & (1u << id))) {
+        continue;
+      }
+      const float massZ = o2::track::PID::getMass2Z(id);
+      // same variables as in ExpTimes::GetExpectedSigmaVariables
+      x[n * nVariables + 0] = p;
+      x[n * nVariables + 1] = tofSignal;
+      x[n * nVariables + 2] = collisionTimeRes;
+      x[n * nVariables + 3] = massZ;
+      delta[n] = tofSignal - collisionTime - ExpTimesEl::ComputeExpectedTime(tofExpMom, length, massZ);
+      ids[n++] = id;
+    }
+    response(response.kSigma, gsl::span<const float>(x.data(), n * nVariables), gsl::span<float>(reso.data(), n));
+    for (int i = 0; i < n; i++) {
+      expSigma[ids[i]] = reso[i] >= 0.f ? reso[i] : 0.f;
+      nSigma[ids[i]] = delta[i] / expSigma[ids[i]];
+    }
+  }
+};
+
 /// \brief Class to convert the trackTime to the tofSignal used for PID
 template <typename TrackType>
 class TOFSignal
@@ -60,6 +60,17 @@ pidvar_t Parametrization::operator()(const pidvar_t* x) const
   return -999.999f;
 }
 
+void Parametrization::Evaluate(gsl::span<const pidvar_t> x, gsl::span<pidvar_t> y) const
+{
+  if (y.empty()) {
+    return;
+  }
+  const std::size_t nVariables = x.size() / y.size();
+  for (std::size_t i = 0; i < y.size(); i++) {
+    y[i] = operator()(x.data() + i * nVariables);
+  }
+}
+
 void Parametrization::Print(Option_t* options) const
 {
   LOG(info) << "Parametrization '" << fName << "'";
@@ -20,6 +20,8 @@
 #ifndef O2_FRAMEWORK_PARAMBASE_H_
 #define O2_FRAMEWORK_PARAMBASE_H_
 
+#include <gsl/span>
+
 // ROOT includes
 #include "TNamed.h"
 
@@ -123,6 +125,12 @@ class Parametrization : public TNamed
   /// \param x array of variables to use in order to compute the return value
   virtual pidvar_t operator()(const pidvar_t* x) const;
 
+  /// Getter for the parametrization values of a batch of inputs, to be reimplemented with EvaluateBatch in the custom parametrization of the user.
+  /// The default implementation calls operator() for each input.
+  /// \param x array of variables of all the inputs, y.size() consecutive blocks of x.size() / y.size() variables
+  /// \param y array of the return values
+  virtual void Evaluate(gsl::span<const pidvar_t> x, gsl::span<pidvar_t> y) const;
+
   /// Printer for the parametrization
   void Print(Option_t* option = "") const override;
 
@@ -151,6 +159,23 @@ class Parametrization : public TNamed
   void GetParameters(Parameters*& parameters) { parameters = &mParameters; }
 
  protected:
+  /// Batch evaluation with the static function `pidvar_t ParamType::Evaluate(const pidvar_t* x, const Parameters& parameters)`
+  /// of the custom parametrization, which is inlined in the loop instead of being called through operator()
+  /// \param x array of variables of all the inputs, y.size() consecutive blocks of x.size() / y.size() variables
+  /// \param y array of the return values
+  /// \param parameters parameters of the parametrization
+  template <typename ParamType>
+  static void EvaluateBatch(gsl::span<const pidvar_t> x, gsl::span<pidvar_t> y, const Parameters& parameters)
+  {
+    if (y.empty()) {
+      return;
+    }
+    const std::size_t nVariables = x.size() / y.size();
+    for (std::size_t i = 0; i < y.size(); i++) {
+      y[i] = ParamType::Evaluate(x.data() + i * nVariables, parameters);
+    }
+  }
+
   /// Parameters of the parametrization
   Parameters mParameters;
 
@@ -31,13 +31,20 @@ class TOFReso : public Parametrization
  public:
   TOFReso() : Parametrization("TOFReso", 5){};
   ~TOFReso() override = default;
-  /// Operator to compute the expected value of the TOF Resolution
+  /// Operator to compute the expected value of the TOF Resolution, see Evaluate
+  float operator()(const float* x) const override { return Evaluate(x, mParameters); }
+
+  /// Computes the expected value of the TOF Resolution for a batch of inputs, see Parametrization::EvaluateBatch
+  void Evaluate(gsl::span<const float> x, gsl::span<float> y) const override { EvaluateBatch<TOFReso>(x, y, mParameters); }
+
+  /// Computes the expected value of the TOF Resolution
   /// \param x Array with the input used to compute the response:
   /// x[0] -> track momentum
   /// x[1] -> TOF signal
   /// x[2] -> event time resolution
   /// x[3] -> particle mass
-  float operator()(const float* x) const override
+  /// \param parameters Parameters of the parametrization
+  static float Evaluate(const float* x, const Parameters& parameters)
   {
     const float mom = abs(x[0]);
     if (mom <= 0) {
@@ -46,9 +53,9 @@ class TOFReso : public Parametrization
     const float time = x[1];
     const float evtimereso = x[2];
     const float mass = x[3];
-    const float dpp = mParameters[0] + mParameters[1] * mom + mParameters[2] * mass / mom; // mean relative pt resolution;
+    const float dpp = parameters[0] + parameters[1] * mom + parameters[2] * mass / mom; // mean relative pt resolution;
     const float sigma = dpp * time / (1. + mom * mom / (mass * mass));
-    return sqrt(sigma * sigma + mParameters[3] * mParameters[3] / mom / mom + mParameters[4] * mParameters[4] + evtimereso * evtimereso);
+    return sqrt(sigma * sigma + parameters[3] * parameters[3] / mom / mom + parameters[4] * parameters[4] + evtimereso * evtimereso);
   }
   ClassDef(TOFReso, 1);
 };
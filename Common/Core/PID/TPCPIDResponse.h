@@ -24,6 +24,7 @@
 // O2 includes
 #include "ReconstructionDataFormats/PID.h"
 #include "DataFormatsTPC/BetheBlochAleph.h"
+#include "Common/Core/PID/BetheBlochTable.h"
 
 namespace o2::pid::tpc
 {
@@ -38,7 +39,11 @@ class Response
   ~Response() = default;
 
   /// Setter and Getter for the private parameters
-  void SetBetheBlochParams(const std::array<float, 5>& betheBlochParams) { mBetheBlochParams = betheBlochParams; }
+  void SetBetheBlochParams(const std::array<float, 5>& betheBlochParams)
+  {
+    mBetheBlochParams = betheBlochParams;
+    UpdateBetheBlochTable();
+  }
   void SetResolutionParamsDefault(const std::array<float, 2>& resolutionParamsDefault) { mResolutionParamsDefault = resolutionParamsDefault; }
   void SetResolutionParams(const std::vector<double>& resolutionParams) { mResolutionParams = resolutionParams; }
   void SetMIP(const float mip) { mMIP = mip; }
@@ -54,6 +59,14 @@ class Response
     mChargeFactor = response->GetChargeFactor();
     mMultNormalization = response->GetMultiplicityNormalization();
     mUseDefaultResolutionParam = response->GetUseDefaultResolutionParam();
+    UpdateBetheBlochTable();
+  }
+  /// Uses a lookup table instead of the analytic Bethe-Bloch formula, the table is rebuilt when the parameters change
+  /// \param maxRelError Maximum relative difference of the table to the analytic formula, <= 0 to use the analytic formula
+  void SetBetheBlochTable(const float maxRelError)
+  {
+    mBetheBlochTableMaxRelError = maxRelError;
+    UpdateBetheBlochTable();
   }
 
   const std::array<float, 5> GetBetheBlochParams() const { return mBetheBlochParams; }
@@ -63,6 +76,7 @@ class Response
   const float GetChargeFactor() const { return mChargeFactor; }
   const float GetMultiplicityNormalization() const { return mMultNormalization; }
   const bool GetUseDefaultResolutionParam() const { return mUseDefaultResolutionParam; }
+  const bool GetUseBetheBlochTable() const { return mBetheBlochTableMaxRelError > 0.f && mBetheBlochTable.IsValid(); }
 
   /// Gets the expected signal of the track
   template <typename TrackType>
@@ -79,6 +93,17 @@ class Response
   /// Gets relative dEdx resolution contribution due to relative pt resolution
   float GetRelativeResolutiondEdx(const float p, const float mass, const float charge, const float resol) const;
 
+  /// Number of particle species handled by GetResponseAllSpecies
+  static constexpr int NSpecies = o2::track::PID::NIDs;
+  using SpeciesArray = std::array<float, NSpecies>;
+  /// Gets expected signal, expected resolution and number of sigmas of the track for all the particle species at once.
+  /// The terms depending only on the track are computed once, the results are the same as for the single species getters.
+  /// \param speciesMask bit i set if species i has to be computed, the entries of the other species are not modified
+  template <typename CollisionType, typename TrackType>
+  void GetResponseAllSpecies(const CollisionType& collision, const TrackType& track,
+                             SpeciesArray& expSignal, SpeciesArray& expSigma, SpeciesArray& nSigma,
+                             const uint32_t speciesMask = ~0u) const;
+
   void PrintAll() const;
 
  private:
@@ -89,6 +114,17 @@ class Response
   float mChargeFactor = 2.299999952316284f;
   float mMultNormalization = 11000.;
   bool mUseDefaultResolutionParam = true;
+  float mBetheBlochTableMaxRelError = 0.f; //! Maximum relative error of the Bethe-Bloch table, <= 0 if not used
+  BetheBlochTable mBetheBlochTable;        //! Bethe-Bloch table built from mBetheBlochParams
+
+  /// Gets the value of the Bethe-Bloch parametrization, from the table if enabled
+  float BetheBloch(const float bg) const { return mBetheBlochTableMaxRelError > 0.f ? mBetheBlochTable(bg) : o2::tpc::BetheBlochAleph(bg, mBetheBlochParams[0], mBetheBlochParams[1], mBetheBlochParams[2], mBetheBlochParams[3], mBetheBlochParams[4]); }
+  void UpdateBetheBlochTable()
+  {
+    if (mBetheBlochTableMaxRelError > 0.f) {
+      mBetheBlochTable.Init(mBetheBlochParams, mBetheBlochTableMaxRelError);
+    }
+  }
 
   ClassDefNV(Response, 2);
 
@@ -98,7 +134,7 @@ class Response
 template <typename TrackType>
 inline float Response::GetExpectedSignal(const TrackType& track, const o2::track::PID::ID id) const
 {
-  const float bethe = mMIP * o2::tpc::BetheBlochAleph(track.tpcInnerParam() / o2::track::pid_constants::sMasses[id], mBetheBlochParams[0], mBetheBlochParams[1], mBetheBlochParams[2], mBetheBlochParams[3], mBetheBlochParams[4]) * std::pow((float)o2::track::pid_constants::sCharges[id], mChargeFactor);
+  const float bethe = mMIP * BetheBloch(track.tpcInnerParam() / o2::track::pid_constants::sMasses[id]) * std::pow((float)o2::track::pid_constants::sCharges[id], mChargeFactor);
   return bethe >= 0.f ? bethe : 0.f;
 }
 
@@ -116,7 +152,7 @@ inline float Response::GetExpectedSigma(const CollisionType& collision, const Tr
     const double p = track.tpcInnerParam();
     const double mass = o2::track::pid_constants::sMasses[id];
     const double bg = p / mass;
-    const double dEdx = o2::tpc::BetheBlochAleph((float)bg, mBetheBlochParams[0], mBetheBlochParams[1], mBetheBlochParams[2], mBetheBlochParams[3], mBetheBlochParams[4]) * std::pow((float)o2::track::pid_constants::sCharges[id], mChargeFactor);
+    const double dEdx = BetheBloch((float)bg) * std::pow((float)o2::track::pid_constants::sCharges[id], mChargeFactor);
     const double relReso = GetRelativeResolutiondEdx(p, mass, o2::track::pid_constants::sCharges[id], mResolutionParams[3]);
 
     const std::vector<double> values{1.f / dEdx, track.tgl(), std::sqrt(ncl), relReso, track.signed1Pt(), collision.multTPC() / mMultNormalization};
@@ -145,20 +181,85 @@ inline float Response::GetSignalDelta(const TrackType& trk, const o2::track::PID
 inline float Response::GetRelativeResolutiondEdx(const float p, const float mass, const float charge, const float resol) const
 {
   const float bg = p / mass;
-  const float dEdx = o2::tpc::BetheBlochAleph(bg, mBetheBlochParams[0], mBetheBlochParams[1], mBetheBlochParams[2], mBetheBlochParams[3], mBetheBlochParams[4]) * std::pow(charge, mChargeFactor);
+  const float dEdx = BetheBloch(bg) * std::pow(charge, mChargeFactor);
   const float deltaP = resol * std::sqrt(dEdx);
   const float bgDelta = p * (1 + deltaP) / mass;
-  const float dEdx2 = o2::tpc::BetheBlochAleph(bgDelta, mBetheBlochParams[0], mBetheBlochParams[1], mBetheBlochParams[2], mBetheBlochParams[3], mBetheBlochParams[4]) * std::pow(charge, mChargeFactor);
+  const float dEdx2 = BetheBloch(bgDelta) * std::pow(charge, mChargeFactor);
   const float deltaRel = std::abs(dEdx2 - dEdx) / dEdx;
   return deltaRel;
 }
 
+/// Gets expected signal, expected resolution and number of sigmas for all the particle species
+template <typename CollisionType, typename TrackType>
+inline void Response::GetResponseAllSpecies(const CollisionType& collision, const TrackType& track,
+                                            SpeciesArray& expSignal, SpeciesArray& expSigma, SpeciesArray& nSigma,
+                                            const uint32_t speciesMask) const
+{
+  const float tpcSignal = track.tpcSignal();
+  const float p = track.tpcInnerParam();
+
+  // Terms depending only on the track
+  float resolutionDefault = 0.f;
+  double ncl = 0., sqrtNcl = 0., sqrtTgl = 0., ptTerm = 0., multTerm = 0., multNorm = 0.;
+  if (mUseDefaultResolutionParam) {
+    const float reso = tpcSignal * mResolutionParamsDefault[0] * ((float)track.tpcNClsFound() > 0 ? std::sqrt(1. + mResolutionParamsDefault[1] / (float)track.tpcNClsFound()) : 1.f);
+    resolutionDefault = reso >= 0.f ? reso : 0.f;
+  } else {
+    ncl = 159. / track.tpcNClsFound();
+    sqrtNcl = std::sqrt(ncl);
+    const double tgl = track.tgl();
+    sqrtTgl = sqrt(1 + tgl * tgl);
+    const double signed1Pt = track.signed1Pt();
+    ptTerm = (mResolutionParams[4] * signed1Pt) * (mResolutionParams[4] * signed1Pt);
+    multNorm = collision.multTPC() / mMultNormalization;
+    multTerm = (multNorm * mResolutionParams[6]) * (multNorm * mResolutionParams[6]);
+  }
+
+  float chargeFactor = 1.f;
+  float lastCharge = 1.f;
+  for (int id = 0; id < NSpecies; id++) {
+    if (!(speciesMask & (1u << id))) {
+      continue;
+    }
+    const float charge = o2::track::pid_constants::sCharges[id];
+    if (charge != lastCharge) {
+      lastCharge = charge;
+      chargeFactor = std::pow(charge, mChargeFactor);
+    }
+    const float mass = o2::track::pid_constants::sMasses[id];
+    // Same as GetExpectedSignal
+    const float bb = BetheBloch(p / mass);
+    const float bethe = mMIP * bb * chargeFactor;
+    expSignal[id] = bethe >= 0.f ? bethe : 0.f;
+
+    // Same as GetExpectedSigma
+    if (mUseDefaultResolutionParam) {
+      expSigma[id] = resolutionDefault;
+    } else {
+      const float dEdx = bb * chargeFactor;
+      // Same as GetRelativeResolutiondEdx, reusing dEdx
+      const float deltaP = static_cast<float>(mResolutionParams[3]) * std::sqrt(dEdx);
+      const float bgDelta = p * (1 + deltaP) / mass;
+      const float dEdx2 = BetheBloch(bgDelta) * chargeFactor;
+      const double relReso = std::abs(dEdx2 - dEdx) / dEdx;
+
+      const double invdEdx = 1.f / (double)dEdx;
+      const double invdEdxTgl = invdEdx / sqrtTgl;
+      const float reso = sqrt(mResolutionParams[0] * mResolutionParams[0] * invdEdx + mResolutionParams[1] * mResolutionParams[1] * (sqrtNcl * mResolutionParams[5]) * pow(invdEdxTgl, mResolutionParams[2]) + sqrtNcl * (relReso * relReso) + ptTerm + multTerm + (multNorm * invdEdxTgl * mResolutionParams[7]) * (multNorm * invdEdxTgl * mResolutionParams[7])) * dEdx * mMIP;
+      expSigma[id] = reso >= 0.f ? reso : 0.f;
+    }
+
+    nSigma[id] = (tpcSignal - expSignal[id]) / expSigma[id];
+  }
+}
+
 inline void Response::PrintAll() const
 {
   LOGP(info, "==== TPC PID response parameters: ====");
   for (int i = 0; i < int(mBetheBlochParams.size()); i++) {
     LOGP(info, "BB param [{}] = {}", i, mBetheBlochParams[i]);
   }
+  LOGP(info, "use Bethe-Bloch table = {}", GetUseBetheBlochTable());
   LOGP(info, "use default resolution parametrization = {}", mUseDefaultResolutionParam);
   if (mUseDefaultResolutionParam) {
     LOGP(info, "Default Resolution parametrization: ");
@@ -18,9 +18,16 @@
 #define O2_ANALYSIS_RECODECAY_H_
 
 #include <tuple>
+#include <utility>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <mutex>
+
+#include <gsl/span>
 
 #include <TDatabasePDG.h>
 #include <TPDGCode.h>
@@ -516,48 +523,232 @@ class RecoDecay
     return maxNormDeltaIP;
   }
 
+  // Batch calculations
+  // The inputs are given as structure of arrays: one span per prong and per component, with one element per candidate.
+  // The loops are plain arithmetic on the components, without branches other than the clamping and the sign selection,
+  // and have no dependencies between candidates so that the compiler can vectorise them.
+  // The operations are done in the same order and precision as in the scalar function of the same name,
+  // so that the results agree with it (bitwise, unless the compiler contracts multiplications and additions).
+  // All input spans must have the size of the output span.
+
+  /// Calculates invariant masses squared of N-prong candidates.
+  /// \param px,py,pz  arrays of N spans of prong momentum components
+  /// \param arrMass  array of N masses (in the same order as the prongs)
+  /// \param m2  span to be filled with the invariant masses squared, of the size of the momentum spans
+  template <std::size_t N, typename T, typename U>
+  static void M2Batch(const array<gsl::span<const T>, N>& px, const array<gsl::span<const T>, N>& py, const array<gsl::span<const T>, N>& pz,
+                      const array<U, N>& arrMass, gsl::span<double> m2)
+  {
+    const auto nCandidates = m2.size();
+    checkBatchSizes("M2Batch", nCandidates, px, py, pz);
+    auto out = m2.data();
+    array<const T*, N> x, y, z;
+    array<double, N> mass2;
+    for (std::size_t iProng = 0; iProng < N; ++iProng) {
+      x[iProng] = px[iProng].data();
+      y[iProng] = py[iProng].data();
+      z[iProng] = pz[iProng].data();
+      mass2[iProng] = (double)arrMass[iProng] * (double)arrMass[iProng];
+    }
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      double pxTot{0.}, pyTot{0.}, pzTot{0.}, energyTot{0.};
+      for (std::size_t iProng = 0; iProng < N; ++iProng) {
+        double pxProng = x[iProng][i], pyProng = y[iProng][i], pzProng = z[iProng][i];
+        pxTot += pxProng;
+        pyTot += pyProng;
+        pzTot += pzProng;
+        energyTot += std::sqrt(pxProng * pxProng + (pyProng * pyProng + (pzProng * pzProng + mass2[iProng])));
+      }
+      out[i] = energyTot * energyTot - (pxTot * pxTot + (pyTot * pyTot + pzTot * pzTot));
+    }
+  }
+
+  /// Calculates invariant masses of N-prong candidates.
+  /// \param px,py,pz  arrays of N spans of prong momentum components
+  /// \param arrMass  array of N masses (in the same order as the prongs)
+  /// \param m  span to be filled with the invariant masses, of the size of the momentum spans
+  template <std::size_t N, typename T, typename U>
+  static void MBatch(const array<gsl::span<const T>, N>& px, const array<gsl::span<const T>, N>& py, const array<gsl::span<const T>, N>& pz,
+                     const array<U, N>& arrMass, gsl::span<double> m)
+  {
+    M2Batch(px, py, pz, arrMass, m);
+    const auto nCandidates = m.size();
+    auto out = m.data();
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      out[i] = std::sqrt(out[i]);
+    }
+  }
+
+  /// Calculates cosines of pointing angle.
+  /// \param xPV,yPV,zPV  position of the primary vertex of each candidate
+  /// \param xSV,ySV,zSV  position of the secondary vertex of each candidate
+  /// \param px,py,pz  momentum of each candidate
+  /// \param cpa  span to be filled with the cosines of pointing angle
+  template <typename T, typename U, typename V>
+  static void CPABatch(gsl::span<const T> xPV, gsl::span<const T> yPV, gsl::span<const T> zPV,
+                       gsl::span<const U> xSV, gsl::span<const U> ySV, gsl::span<const U> zSV,
+                       gsl::span<const V> px, gsl::span<const V> py, gsl::span<const V> pz, gsl::span<double> cpa)
+  {
+    const auto nCandidates = cpa.size();
+    checkBatchSizes("CPABatch", nCandidates, xPV, yPV, zPV, xSV, ySV, zSV, px, py, pz);
+    auto out = cpa.data();
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      // differences in the precision of the inputs, as in the scalar version
+      double dx = xSV.data()[i] - xPV.data()[i], dy = ySV.data()[i] - yPV.data()[i], dz = zSV.data()[i] - zPV.data()[i];
+      double pxCand = px.data()[i], pyCand = py.data()[i], pzCand = pz.data()[i];
+      double dot = dx * pxCand + dy * pyCand + dz * pzCand;
+      double cos = dot / std::sqrt((dx * dx + dy * dy + dz * dz) * (pxCand * pxCand + pyCand * pyCand + pzCand * pzCand));
+      out[i] = cos < -1. ? -1. : (cos > 1. ? 1. : cos);
+    }
+  }
+
+  /// Calculates cosines of pointing angle in the {x, y} plane.
+  /// \param xPV,yPV  {x, y} position of the primary vertex of each candidate
+  /// \param xSV,ySV  {x, y} position of the secondary vertex of each candidate
+  /// \param px,py  {x, y} momentum of each candidate
+  /// \param cpaXY  span to be filled with the cosines of pointing angle in {x, y}
+  template <typename T, typename U, typename V>
+  static void CPAXYBatch(gsl::span<const T> xPV, gsl::span<const T> yPV, gsl::span<const U> xSV, gsl::span<const U> ySV,
+                         gsl::span<const V> px, gsl::span<const V> py, gsl::span<double> cpaXY)
+  {
+    const auto nCandidates = cpaXY.size();
+    checkBatchSizes("CPAXYBatch", nCandidates, xPV, yPV, xSV, ySV, px, py);
+    auto out = cpaXY.data();
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      double dx = xSV.data()[i] - xPV.data()[i], dy = ySV.data()[i] - yPV.data()[i];
+      double pxCand = px.data()[i], pyCand = py.data()[i];
+      double cos = (dx * pxCand + dy * pyCand) / std::sqrt((dx * dx + dy * dy) * (pxCand * pxCand + pyCand * pyCand));
+      out[i] = cos < -1. ? -1. : (cos > 1. ? 1. : cos);
+    }
+  }
+
+  /// Calculates proper lifetimes times c.
+  /// \param px,py,pz  momentum of each candidate
+  /// \param length  decay length of each candidate
+  /// \param mass  mass
+  /// \param ct  span to be filled with the proper lifetimes times c
+  template <typename T, typename U, typename V>
+  static void CtBatch(gsl::span<const T> px, gsl::span<const T> py, gsl::span<const T> pz, gsl::span<const U> length, V mass, gsl::span<double> ct)
+  {
+    const auto nCandidates = ct.size();
+    checkBatchSizes("CtBatch", nCandidates, px, py, pz, length);
+    auto out = ct.data();
+    const double massD = mass;
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      double pxCand = px.data()[i], pyCand = py.data()[i], pzCand = pz.data()[i];
+      out[i] = (double)length.data()[i] * massD / std::sqrt(pxCand * pxCand + (pyCand * pyCand + pzCand * pzCand));
+    }
+  }
+
+  /// Calculates impact parameters in the bending plane w.r.t. a point.
+  /// \param xPoint,yPoint,zPoint  position of the point for each candidate
+  /// \param xSV,ySV,zSV  position of the secondary vertex of each candidate
+  /// \param px,py,pz  momentum of each candidate
+  /// \param impParXY  span to be filled with the impact parameters in {x, y}
+  template <typename T, typename U, typename V>
+  static void ImpParXYBatch(gsl::span<const T> xPoint, gsl::span<const T> yPoint, gsl::span<const T> zPoint,
+                            gsl::span<const U> xSV, gsl::span<const U> ySV, gsl::span<const U> zSV,
+                            gsl::span<const V> px, gsl::span<const V> py, gsl::span<const V> pz, gsl::span<double> impParXY)
+  {
+    const auto nCandidates = impParXY.size();
+    checkBatchSizes("ImpParXYBatch", nCandidates, xPoint, yPoint, zPoint, xSV, ySV, zSV, px, py, pz);
+    auto out = impParXY.data();
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      double dx = xSV.data()[i] - xPoint.data()[i], dy = ySV.data()[i] - yPoint.data()[i];
+      double pxCand = px.data()[i], pyCand = py.data()[i];
+      double k = (dx * pxCand + dy * pyCand) / (pxCand * pxCand + pyCand * pyCand);
+      double dxImpPar = dx - k * pxCand;
+      double dyImpPar = dy - k * pyCand;
+      double absImpPar = std::sqrt(dxImpPar * dxImpPar + dyImpPar * dyImpPar);
+      // z component of the cross product of the momentum and the flight line
+      out[i] = (pxCand * dy - pyCand * dx) > 0. ? absImpPar : -1. * absImpPar;
+    }
+  }
+
+  /// Calculates maximum normalized differences between measured and expected impact parameter of candidate prongs.
+  /// \param xPV,yPV  {x, y} position of the primary vertex of each candidate
+  /// \param xSV,ySV  {x, y} position of the secondary vertex of each candidate
+  /// \param errDecLenXY  error on decay length in {x, y} plane of each candidate
+  /// \param pxMother,pyMother  {x, y} momentum of each candidate
+  /// \param arrImpPar  array of N spans of prong impact parameters
+  /// \param arrErrImpPar  array of N spans of errors on prong impact parameters
+  /// \param pxProng,pyProng  arrays of N spans of {x, y} prong momentum components
+  /// \param maxNormDeltaIP  span to be filled with the maximum normalized differences
+  template <std::size_t N, typename T, typename U, typename V, typename W, typename X, typename Y, typename Z>
+  static void maxNormalisedDeltaIPBatch(gsl::span<const T> xPV, gsl::span<const T> yPV, gsl::span<const U> xSV, gsl::span<const U> ySV,
+                                        gsl::span<const V> errDecLenXY, gsl::span<const W> pxMother, gsl::span<const W> pyMother,
+                                        const array<gsl::span<const X>, N>& arrImpPar, const array<gsl::span<const Y>, N>& arrErrImpPar,
+                                        const array<gsl::span<const Z>, N>& pxProng, const array<gsl::span<const Z>, N>& pyProng,
+                                        gsl::span<double> maxNormDeltaIP)
+  {
+    const auto nCandidates = maxNormDeltaIP.size();
+    checkBatchSizes("maxNormalisedDeltaIPBatch", nCandidates, xPV, yPV, xSV, ySV, errDecLenXY, pxMother, pyMother, arrImpPar, arrErrImpPar, pxProng, pyProng);
+    auto out = maxNormDeltaIP.data();
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      double dx = xPV.data()[i] - xSV.data()[i], dy = yPV.data()[i] - ySV.data()[i];
+      double decLenXY = std::sqrt(dx * dx + dy * dy);
+      double errDecLen = errDecLenXY.data()[i];
+      double pxCand = pxMother.data()[i], pyCand = pyMother.data()[i];
+      double ptCand = std::sqrt(pxCand * pxCand + pyCand * pyCand);
+      double maxNorm{0.};
+      for (std::size_t iProng = 0; iProng < N; ++iProng) {
+        double pxDau = pxProng[iProng].data()[i], pyDau = pyProng[iProng].data()[i];
+        double sinThetaP = (pxDau * pyCand - pyDau * pxCand) / (std::sqrt(pxDau * pxDau + pyDau * pyDau) * ptCand);
+        double diff = arrImpPar[iProng].data()[i] - decLenXY * sinThetaP;
+        double errImpPar = arrErrImpPar[iProng].data()[i];
+        double errImpParExp = errDecLen * sinThetaP;
+        double errDiff = std::sqrt(errImpPar * errImpPar + errImpParExp * errImpParExp);
+        double norm = errDiff > 0. ? diff / errDiff : 0.;
+        maxNorm = std::abs(norm) > std::abs(maxNorm) ? norm : maxNorm;
+      }
+      out[i] = maxNorm;
+    }
+  }
+
   /// Adds particle mass in the list.
+  /// \note A mass given for a particle of the table of frequently used particles (mMassTable) takes precedence over the table.
   /// \param pdg  PDG code
   /// \param mass  particle mass
   static void addMassPDG(int pdg, double mass)
   {
-    mListMass.push_back(std::make_tuple(pdg, mass));
+    std::lock_guard<std::mutex> lock(getMassListMutex());
+    if (getMassTableIndex(std::abs(pdg)) >= 0) {
+      LOGF(warning, "RecoDecay: mass %g of PDG code %d overrides the value %g of the mass table", mass, pdg, mMassTable[getMassTableIndex(std::abs(pdg))].second);
+      getIsMassTableOverridden() = true;
+    }
+    getMassList().push_back(std::make_tuple(pdg, mass));
   }
 
   /// Returns particle mass based on PDG code.
+  /// \note Frequently used particles are looked up in a constexpr table, unless their mass was given with addMassPDG.
+  ///       The other ones are taken from ROOT and cached.
   /// \param pdg  PDG code
   /// \return particle mass
   static double getMassPDG(int pdg)
   {
+    // Fast path: table of frequently used particles
+    auto index = getMassTableIndex(std::abs(pdg));
+    if (index >= 0 && !getIsMassTableOverridden().load(std::memory_order_relaxed)) {
+      checkMassTable();
+      return mMassTable[index].second;
+    }
+    std::lock_guard<std::mutex> lock(getMassListMutex());
     // Try to get the particle mass from the list first.
-    for (const auto& particle : mListMass) {
+    for (const auto& particle : getMassList()) {
       if (std::get<0>(particle) == pdg) {
         return std::get<1>(particle);
       }
     }
+    if (index >= 0) {
+      return mMassTable[index].second;
+    }
     // Get the mass of the new particle and add it in the list.
-    double mass = 0.;
-    switch (pdg) {
-      // Particles that cannot be taken from ROOT ($ROOTSYS/etc/pdg_table.txt)
-      case 4422: {      // Ξcc (wrong mass in ROOT)
-        mass = 3.62155; // https://pdg.lbl.gov/ (2021)
-        break;
-      }
-      case 9920443: {   // χc1 aka X(3872)
-        mass = 3.87165; // https://pdg.lbl.gov/ (2021)
-        break;
-      }
-      // Take the rest from ROOT.
-      default: {
-        const TParticlePDG* particle = TDatabasePDG::Instance()->GetParticle(pdg);
-        if (!particle) { // Check that it's there.
-          LOGF(fatal, "Cannot find particle mass for PDG code %i", pdg);
-          return 999.;
-        }
-        mass = particle->Mass();
-      }
+    double mass = getMassPDGDatabase(pdg);
+    if (mass < 0.) { // Check that it's there.
+      LOGF(fatal, "Cannot find particle mass for PDG code %i", pdg);
+      return 999.;
     }
-    addMassPDG(pdg, mass);
+    getMassList().push_back(std::make_tuple(pdg, mass));
     return mass;
   }
 
@@ -701,6 +892,23 @@ class RecoDecay
                              bool acceptAntiParticles = false,
                              int8_t* sign = nullptr,
                              int depthMax = 1)
+  {
+    return getMatchedMCRecImpl(
+      particlesMC, arrDaughters, arrPDGDaughters, sign,
+      [&](const auto& particle, int8_t* sgn) { return getMother(particlesMC, particle, PDGMother, acceptAntiParticles, sgn, depthMax); },
+      [&](const auto& particleMother, std::vector<int>* list) { getDaughters(particlesMC, particleMother, list, arrPDGDaughters, depthMax); });
+  }
+
+  /// Implementation of getMatchedMCRec with the searches in the decay tree provided by the caller
+  /// \param findMother  callable (MC particle, int8_t* sign) returning the index of the expected mother, see getMother
+  /// \param findDaughters  callable (MC particle, std::vector<int>* list) filling the list of final daughters, see getDaughters
+  template <std::size_t N, typename T, typename U, typename FindMother, typename FindDaughters>
+  static int getMatchedMCRecImpl(const T& particlesMC,
+                                 const array<U, N>& arrDaughters,
+                                 array<int, N> arrPDGDaughters,
+                                 int8_t* sign,
+                                 FindMother&& findMother,
+                                 FindDaughters&& findDaughters)
   {
     //Printf("MC Rec: Expected mother PDG: %d", PDGMother);
     int8_t sgn = 0;                        // 1 if the expected mother is particle, -1 if antiparticle (w.r.t. PDGMother)
@@ -721,7 +929,7 @@ class RecoDecay
       if (iProng == 0) {
         // Get the mother index and its sign.
         // PDG code of the first daughter's mother determines whether the expected mother is a particle or antiparticle.
-        indexMother = getMother(particlesMC, particleI, PDGMother, acceptAntiParticles, &sgn, depthMax);
+        indexMother = findMother(particleI, &sgn);
         // Check whether mother was found.
         if (indexMother <= -1) {
           //Printf("MC Rec: Rejected: bad mother index or PDG");
@@ -740,7 +948,7 @@ class RecoDecay
           return -1;
         }
         // Get the list of actual final daughters.
-        getDaughters(particlesMC, particleMother, &arrAllDaughtersIndex, arrPDGDaughters, depthMax);
+        findDaughters(particleMother, &arrAllDaughtersIndex);
         //printf("MC Rec: Mother %d has %d final daughters:", indexMother, arrAllDaughtersIndex.size());
         //for (auto i : arrAllDaughtersIndex) {
         //  printf(" %d", i);
@@ -826,6 +1034,23 @@ class RecoDecay
                              int8_t* sign = nullptr,
                              int depthMax = 1,
                              std::vector<int>* listIndexDaughters = nullptr)
+  {
+    return isMatchedMCGenImpl(
+      particlesMC, candidate, PDGParticle, arrPDGDaughters, acceptAntiParticles, sign, listIndexDaughters,
+      [&](const auto& particle, std::vector<int>* list) { getDaughters(particlesMC, particle, list, arrPDGDaughters, depthMax); });
+  }
+
+  /// Implementation of isMatchedMCGen with the search of the final daughters provided by the caller
+  /// \param findDaughters  callable (MC particle, std::vector<int>* list) filling the list of final daughters, see getDaughters
+  template <std::size_t N, typename T, typename U, typename FindDaughters>
+  static bool isMatchedMCGenImpl(const T& particlesMC,
+                                 const U& candidate,
+                                 int PDGParticle,
+                                 array<int, N> arrPDGDaughters,
+                                 bool acceptAntiParticles,
+                                 int8_t* sign,
+                                 std::vector<int>* listIndexDaughters,
+                                 FindDaughters&& findDaughters)
   {
     //Printf("MC Gen: Expected particle PDG: %d", PDGParticle);
     int8_t sgn = 0; // 1 if the expected mother is particle, -1 if antiparticle (w.r.t. PDGParticle)
@@ -858,7 +1083,7 @@ class RecoDecay
         return false;
       }
       // Get the list of actual final daughters.
-      getDaughters(particlesMC, candidate, &arrAllDaughtersIndex, arrPDGDaughters, depthMax);
+      findDaughters(candidate, &arrAllDaughtersIndex);
       //printf("MC Gen: Mother %ld has %ld final daughters:", candidate.globalIndex(), arrAllDaughtersIndex.size());
       //for (auto i : arrAllDaughtersIndex) {
       //  printf(" %d", i);
@@ -899,9 +1124,170 @@ class RecoDecay
   }
 
  private:
-  static std::vector<std::tuple<int, double>> mListMass; ///< list of particle masses in form (PDG code, mass)
-};
+  /// \return true if the span has the given size
+  template <typename T>
+  static bool hasBatchSize(const gsl::span<T>& values, std::size_t size)
+  {
+    return values.size() == size;
+  }
+
+  /// \return true if all spans of the array have the given size
+  template <typename T, std::size_t N>
+  static bool hasBatchSize(const array<gsl::span<T>, N>& arrValues, std::size_t size)
+  {
+    for (const auto& values : arrValues) {
+      if (values.size() != size) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Checks that all input spans (or arrays of spans) of a batch calculation have the size of the output span.
+  template <typename... Spans>
+  static void checkBatchSizes(const char* function, std::size_t nCandidates, const Spans&... inputs)
+  {
+    if (!(hasBatchSize(inputs, nCandidates) && ...)) {
+      LOGF(fatal, "%s: all input spans must have the size of the output span (%zu)", function, nCandidates);
+    }
+  }
+
+  /// PDG codes (absolute values) and masses (GeV/c²) of the frequently used particles, sorted by code
+  /// \note The masses are the ones of getMassPDGDatabase (ROOT, $ROOTSYS/etc/pdg_table.txt, with its exceptions).
+  ///       They are checked against it once in debug builds, see checkMassTable.
+  static constexpr array<std::pair<int, double>, 40> mMassTable{{
+    {11, 0.000510999},          // e
+    {13, 0.105658},             // μ
+    {22, 0.},                   // γ
+    {111, 0.134977},            // π0
+    {130, 0.497614},            // K0L
+    {211, 0.13957},             // π
+    {310, 0.497614},            // K0S
+    {311, 0.497614},            // K0
+    {321, 0.493677},            // K
+    {333, 1.01946},             // φ
+    {411, 1.86962},             // D+
+    {413, 2.01027},             // D*+
+    {421, 1.86484},             // D0
+    {431, 1.96849},             // Ds+
+    {443, 3.0969},              // J/ψ
+    {511, 5.27958},             // B0
+    {521, 5.27925},             // B+
+    {531, 5.36677},             // Bs0
+    {2112, 0.939565},           // n
+    {2212, 0.938272},           // p
+    {3112, 1.19745},            // Σ-
+    {3122, 1.11568},            // Λ
+    {3212, 1.19264},            // Σ0
+    {3222, 1.18937},            // Σ+
+    {3312, 1.32171},            // Ξ-
+    {3322, 1.31486},            // Ξ0
+    {3334, 1.67245},            // Ω-
+    {4122, 2.28646},            // Λc+
+    {4132, 2.47087},            // Ξc0
+    {4232, 2.46787},            // Ξc+
+    {4332, 2.6952},             // Ωc0
+    {4422, 3.62155},            // Ξcc++ (not from ROOT, see getMassPDGDatabase)
+    {5122, 5.6194},             // Λb0
+    {5132, 5.7918},             // Ξb-
+    {5232, 5.7929},             // Ξb0
+    {20443, 3.51066},           // χc1
+    {100443, 3.68609},          // ψ(2S)
+    {9920443, 3.87165},         // χc1 aka X(3872) (not from ROOT, see getMassPDGDatabase)
+    {1000010020, 1.87561},      // deuteron
+    {1000020030, 2.80923}}};    // helium-3
+  static_assert([]() {
+    for (std::size_t i = 1; i < mMassTable.size(); ++i) {
+      if (mMassTable[i - 1].first >= mMassTable[i].first) {
+        return false;
+      }
+    }
+    return true;
+  }(),
+                "mMassTable must be sorted in strictly ascending order of PDG codes for the binary search");
+
+  /// Finds the position of a PDG code in the mass table.
+  /// \param pdg  absolute value of the PDG code
+  /// \return index in mMassTable, -1 if not found
+  static constexpr int getMassTableIndex(int pdg)
+  {
+    // binary search, resolved at compile time for constant codes
+    int low = 0;
+    int high = mMassTable.size() - 1;
+    while (low <= high) {
+      int middle = (low + high) / 2;
+      if (mMassTable[middle].first == pdg) {
+        return middle;
+      }
+      if (mMassTable[middle].first < pdg) {
+        low = middle + 1;
+      } else {
+        high = middle - 1;
+      }
+    }
+    return -1;
+  }
+
+  /// Checks the masses of the table against getMassPDGDatabase (once, in debug builds only).
+  /// \note The relative tolerance covers the differences between the ROOT versions.
+  static void checkMassTable()
+  {
+#ifndef NDEBUG
+    static const bool isChecked = []() {
+      for (const auto& [pdg, mass] : mMassTable) {
+        [[maybe_unused]] double massDatabase = getMassPDGDatabase(pdg);
+        assert(massDatabase >= 0. && std::abs(mass - massDatabase) <= 1.e-3 * massDatabase && "RecoDecay::mMassTable disagrees with TDatabasePDG");
+      }
+      return true;
+    }();
+    (void)isChecked;
+#endif
+  }
+
+  /// Flag telling whether a mass of a particle in the mass table was overridden with addMassPDG
+  static std::atomic<bool>& getIsMassTableOverridden()
+  {
+    static std::atomic<bool> isOverridden{false};
+    return isOverridden;
+  }
+
+  /// Gets the particle mass from ROOT, with the exception of particles with missing or wrong mass in ROOT.
+  /// \param pdg  PDG code
+  /// \return particle mass, -1 if not found
+  static double getMassPDGDatabase(int pdg)
+  {
+    switch (std::abs(pdg)) {
+      // Particles that cannot be taken from ROOT ($ROOTSYS/etc/pdg_table.txt)
+      case 4422: {    // Ξcc (wrong mass in ROOT)
+        return 3.62155; // https://pdg.lbl.gov/ (2021)
+      }
+      case 9920443: { // χc1 aka X(3872)
+        return 3.87165; // https://pdg.lbl.gov/ (2021)
+      }
+      // Take the rest from ROOT.
+      default: {
+        const TParticlePDG* particle = TDatabasePDG::Instance()->GetParticle(pdg);
+        if (!particle) {
+          return -1.;
+        }
+        return particle->Mass();
+      }
+    }
+  }
+
+  /// List of particle masses in form (PDG code, mass) for particles not in the mass table and for masses given with addMassPDG
+  static std::vector<std::tuple<int, double>>& getMassList()
+  {
+    static std::vector<std::tuple<int, double>> list;
+    return list;
+  }
 
-std::vector<std::tuple<int, double>> RecoDecay::mListMass;
+  /// Mutex protecting the list of particle masses
+  static std::mutex& getMassListMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+};
 
 #endif // O2_ANALYSIS_RECODECAY_H_
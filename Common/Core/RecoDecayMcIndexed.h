@@ -0,0 +1,192 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file RecoDecayMcIndexed.h
+/// \brief MC matching of RecoDecay using the decay tree index produced by the mc-decay-index workflow
+///
+/// Kept apart from RecoDecay.h so that RecoDecay does not depend on the data model.
+/// The functions take the MC particles joined with aod::McDecayIndices and the aod::McFinalDaughters table
+/// and give the same results as their RecoDecay counterparts.
+
+#ifndef O2_ANALYSIS_RECODECAYMCINDEXED_H_
+#define O2_ANALYSIS_RECODECAYMCINDEXED_H_
+
+#include <array>
+#include <cstdlib>
+#include <vector>
+
+#include "Common/Core/RecoDecay.h"
+#include "Common/DataModel/McDecayIndex.h"
+
+class RecoDecayMcIndexed
+{
+ public:
+  /// Finds the mother of an MC particle by following the chain of indexed ancestors.
+  /// Falls back to RecoDecay::getMother if the PDG code of the mother is not indexed.
+  /// Arguments and result are the same as for RecoDecay::getMother.
+  template <typename T>
+  static int getMother(const T& particlesMC,
+                       const typename T::iterator& particle,
+                       int PDGMother,
+                       bool acceptAntiParticles = false,
+                       int8_t* sign = nullptr,
+                       int8_t depthMax = -1)
+  {
+    if (!o2::aod::mcdecayindex::isIndexedAncestor(PDGMother)) {
+      return RecoDecay::getMother(particlesMC, particle, PDGMother, acceptAntiParticles, sign, depthMax);
+    }
+    if (sign) {
+      *sign = 0;
+    }
+    // Only indexed ancestors can have the PDG code of the mother.
+    auto depthParticle = particle.depth();
+    auto indexAncestor = particle.ancestorId();
+    while (indexAncestor > -1) {
+      auto particleAncestor = particlesMC.rawIteratorAt(indexAncestor);
+      if (depthMax > -1 && depthParticle - particleAncestor.depth() > depthMax) { // Maximum depth has been exceeded.
+        return -1;
+      }
+      auto PDGAncestor = particleAncestor.pdgCode();
+      if (PDGAncestor == PDGMother || (acceptAntiParticles && PDGAncestor == -PDGMother)) {
+        if (sign) {
+          *sign = (PDGAncestor == PDGMother ? 1 : -1);
+        }
+        return indexAncestor;
+      }
+      indexAncestor = particleAncestor.ancestorId();
+    }
+    return -1;
+  }
+
+  /// Gets the list of indices of final-state daughters of an MC particle from its flattened list in aod::McFinalDaughters.
+  /// The flattened list holds the particles without daughters. It is used when RecoDecay::getDaughters would stop at the
+  /// same particles, i.e. when it reaches all of them and no intermediate particle is at depthMax or has a PDG code from arrPDGFinal.
+  /// Otherwise, and for particles without a flattened list, RecoDecay::getDaughters is used.
+  /// Arguments are the same as for RecoDecay::getDaughters.
+  template <std::size_t N, typename T, typename F>
+  static void getDaughters(const T& particlesMC,
+                           const F& finalDaughters,
+                           const typename T::iterator& particle,
+                           std::vector<int>* list,
+                           const array<int, N>& arrPDGFinal,
+                           int8_t depthMax = -1)
+  {
+    if (!list) {
+      return;
+    }
+    if (particle.nFinalDaughters() == 0) {
+      RecoDecay::getDaughters(particlesMC, particle, list, arrPDGFinal, depthMax);
+      return;
+    }
+    const auto sizeBefore = list->size();
+    auto fallBack = [&]() {
+      list->resize(sizeBefore);
+      RecoDecay::getDaughters(particlesMC, particle, list, arrPDGFinal, depthMax);
+    };
+    const auto indexParticle = particle.globalIndex();
+    const auto depthParticle = particle.depth();
+    for (auto row = particle.finalDaughtersBegin(); row < particle.finalDaughtersEnd(); ++row) {
+      auto indexDaughter = finalDaughters.rawIteratorAt(row).mcParticleId();
+      auto daughter = particlesMC.rawIteratorAt(indexDaughter);
+      auto stage = daughter.depth() - depthParticle;
+      if (stage < 1 || (depthMax > -1 && stage > depthMax)) { // The search would stop above this daughter.
+        fallBack();
+        return;
+      }
+      // Walk up to the particle and check that the search of RecoDecay::getDaughters reaches the daughter
+      // through the same intermediate particles and does not stop at any of them.
+      auto child = daughter;
+      for (; stage > 0; --stage) {
+        auto indexParent = child.mothersIds().front();
+        if (stage == 1 && indexParent != indexParticle) { // The daughter does not descend from the particle along the first mothers.
+          fallBack();
+          return;
+        }
+        auto parent = particlesMC.rawIteratorAt(indexParent);
+        if (child.globalIndex() != parent.daughtersIds().front() && child.globalIndex() != parent.daughtersIds().back()) { // Not followed by the search.
+          fallBack();
+          return;
+        }
+        if (stage > 1 && isPDGFinal(parent.pdgCode(), arrPDGFinal)) { // The search would stop at this intermediate particle.
+          fallBack();
+          return;
+        }
+        child = parent;
+      }
+      list->push_back(indexDaughter);
+    }
+  }
+
+  /// Checks whether the reconstructed decay candidate is the expected decay, see RecoDecay::getMatchedMCRec.
+  /// \param particlesMC  table with MC particles joined with aod::McDecayIndices
+  /// \param finalDaughters  table aod::McFinalDaughters
+  template <std::size_t N, typename T, typename F, typename U>
+  static int getMatchedMCRec(const T& particlesMC,
+                             const F& finalDaughters,
+                             const array<U, N>& arrDaughters,
+                             int PDGMother,
+                             array<int, N> arrPDGDaughters,
+                             bool acceptAntiParticles = false,
+                             int8_t* sign = nullptr,
+                             int depthMax = 1)
+  {
+    return RecoDecay::getMatchedMCRecImpl(
+      particlesMC, arrDaughters, arrPDGDaughters, sign,
+      [&](const auto& particle, int8_t* sgn) { return getMother(particlesMC, particlesMC.rawIteratorAt(particle.globalIndex()), PDGMother, acceptAntiParticles, sgn, depthMax); },
+      [&](const auto& particleMother, std::vector<int>* list) {
+        // The number of final daughters can only decrease when the search stops earlier.
+        if (particleMother.nFinalDaughters() > 0 && particleMother.nFinalDaughters() < static_cast<int>(N)) {
+          return;
+        }
+        getDaughters(particlesMC, finalDaughters, particleMother, list, arrPDGDaughters, depthMax);
+      });
+  }
+
+  /// Checks whether the MC particle is the expected one and whether it decayed via the expected decay channel, see RecoDecay::isMatchedMCGen.
+  /// \param particlesMC  table with MC particles joined with aod::McDecayIndices
+  /// \param finalDaughters  table aod::McFinalDaughters
+  template <std::size_t N, typename T, typename F, typename U>
+  static bool isMatchedMCGen(const T& particlesMC,
+                             const F& finalDaughters,
+                             const U& candidate,
+                             int PDGParticle,
+                             array<int, N> arrPDGDaughters,
+                             bool acceptAntiParticles = false,
+                             int8_t* sign = nullptr,
+                             int depthMax = 1,
+                             std::vector<int>* listIndexDaughters = nullptr)
+  {
+    return RecoDecay::isMatchedMCGenImpl(
+      particlesMC, candidate, PDGParticle, arrPDGDaughters, acceptAntiParticles, sign, listIndexDaughters,
+      [&](const auto& particle, std::vector<int>* list) {
+        auto particleIndexed = particlesMC.rawIteratorAt(particle.globalIndex());
+        if (particleIndexed.nFinalDaughters() > 0 && particleIndexed.nFinalDaughters() < static_cast<int>(N)) {
+          return;
+        }
+        getDaughters(particlesMC, finalDaughters, particleIndexed, list, arrPDGDaughters, depthMax);
+      });
+  }
+
+ private:
+  /// \return true if the PDG code (or its antiparticle) is in arrPDGFinal
+  template <std::size_t N>
+  static bool isPDGFinal(int pdg, const array<int, N>& arrPDGFinal)
+  {
+    for (auto PDGi : arrPDGFinal) {
+      if (std::abs(pdg) == std::abs(PDGi)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+#endif // O2_ANALYSIS_RECODECAYMCINDEXED_H_
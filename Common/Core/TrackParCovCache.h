@@ -0,0 +1,123 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TrackParCovCache.h
+/// \brief Track parameters and covariances converted once per table and reused by the secondary vertexers
+///
+/// The vertexers combine each track with many others and used to convert it with getTrackParCov for every combination.
+/// The cache converts each track of a table (e.g. the tracks of a collision) once and hands out the ready-made
+/// o2::track::TrackParCov by global index. It is filled either from the track and covariance columns or from the
+/// TracksParCovCache table produced by the track-parcov-cache task.
+
+#ifndef O2_ANALYSIS_TRACKPARCOVCACHE_H_
+#define O2_ANALYSIS_TRACKPARCOVCACHE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "ReconstructionDataFormats/Track.h"
+#include "Common/Core/trackUtilities.h"
+
+/// Extracts track parameters and covariance matrix from a track joined with aod::TracksParCovCache
+template <typename T>
+o2::track::TrackParCov getTrackParCovFromCache(const T& track)
+{
+  const auto par = track.par();
+  const auto cov = track.cov();
+  std::array<float, 5> arraypar;
+  std::array<float, 15> covpar;
+  for (int i = 0; i < 5; i++) {
+    arraypar[i] = par[i];
+  }
+  for (int i = 0; i < 15; i++) {
+    covpar[i] = cov[i];
+  }
+  return o2::track::TrackParCov(track.refX(), track.refAlpha(), std::move(arraypar), std::move(covpar));
+}
+
+/// Fills the Par and Cov columns of aod::TracksParCovCache with the track parameters and covariance matrix,
+/// in the layout read back by getTrackParCovFromCache
+inline void fillTrackParCovCacheColumns(const o2::track::TrackParCov& trackParCov, float (&par)[5], float (&cov)[15])
+{
+  for (int i = 0; i < 5; i++) {
+    par[i] = trackParCov.getParam(i);
+  }
+  const auto& covpar = trackParCov.getCov();
+  std::copy(covpar.begin(), covpar.end(), cov);
+}
+
+class TrackParCovCache
+{
+ public:
+  /// Converts the tracks of a table with the track and covariance columns, e.g. aod::TracksCov
+  template <typename TTracks>
+  void fill(const TTracks& tracks)
+  {
+    fillImpl(tracks, [](const auto& track) { return getTrackParCov(track); });
+  }
+
+  /// Takes the tracks of a table joined with aod::TracksParCovCache, together with the magnetic field they were cached with
+  template <typename TTracks>
+  void fillFromCache(const TTracks& tracks)
+  {
+    fillImpl(tracks, [](const auto& track) { return getTrackParCovFromCache(track); });
+    if (tracks.size() != 0) {
+      mBz = tracks.begin().bz();
+    }
+  }
+
+  /// \return the track parameters and covariance of the track with the global index, which must be in the filled table
+  const o2::track::TrackParCov& get(const int64_t globalIndex) const { return mTracks[globalIndex - mFirstIndex]; }
+
+  /// \return true if the track with the global index is in the filled table
+  bool has(const int64_t globalIndex) const
+  {
+    return globalIndex >= mFirstIndex && globalIndex - mFirstIndex < static_cast<int64_t>(mTracks.size()) && mFilled[globalIndex - mFirstIndex];
+  }
+
+  std::size_t size() const { return mTracks.size(); }
+
+  /// \return magnetic field in kG of the cached parameters, only known when filled from aod::TracksParCovCache
+  float getBz() const { return mBz; }
+
+ private:
+  template <typename TTracks, typename Convert>
+  void fillImpl(const TTracks& tracks, Convert&& convert)
+  {
+    mTracks.clear();
+    mFilled.clear();
+    mFirstIndex = 0;
+    if (tracks.size() == 0) {
+      return;
+    }
+    // The tracks of a filtered or sliced table are a subset of a range of global indices
+    int64_t lastIndex = mFirstIndex = tracks.begin().globalIndex();
+    for (const auto& track : tracks) {
+      mFirstIndex = std::min<int64_t>(mFirstIndex, track.globalIndex());
+      lastIndex = std::max<int64_t>(lastIndex, track.globalIndex());
+    }
+    mTracks.resize(lastIndex - mFirstIndex + 1);
+    mFilled.resize(mTracks.size(), false);
+    for (const auto& track : tracks) {
+      mTracks[track.globalIndex() - mFirstIndex] = convert(track);
+      mFilled[track.globalIndex() - mFirstIndex] = true;
+    }
+  }
+
+  std::vector<o2::track::TrackParCov> mTracks{};
+  std::vector<bool> mFilled{};
+  int64_t mFirstIndex = 0;
+  float mBz = 0.f;
+};
+
+#endif // O2_ANALYSIS_TRACKPARCOVCACHE_H_
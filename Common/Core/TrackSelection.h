@@ -184,6 +184,14 @@ class TrackSelection
   void SetMaxDcaXYPtDep(std::function<float(float)> ptDepCut)
   {
     mMaxDcaXYPtDep = ptDepCut;
+    mMaxDcaXYPtDepDecreasing = false;
+  }
+  /// Sets the max dca in xy plane to p0 + p1 / pT^exponent
+  /// With p1 and exponent not negative, the cut is known not to increase with pT, which TrackSelectionBatch uses to tabulate it.
+  void SetMaxDcaXYPtDep(float p0, float p1, float exponent)
+  {
+    mMaxDcaXYPtDep = [p0, p1, exponent](float pt) { return p0 + p1 / pow(pt, exponent); };
+    mMaxDcaXYPtDepDecreasing = p1 >= 0.f && exponent >= 0.f;
   }
   void SetRequireHitsInITSLayers(int8_t minNRequiredHits, std::set<uint8_t> requiredLayers)
   {
@@ -216,6 +224,7 @@ class TrackSelection
   float mMaxDcaXY{1e10f};                       // max dca in xy plane
   float mMaxDcaZ{1e10f};                        // max dca in z direction
   std::function<float(float)> mMaxDcaXYPtDep{}; // max dca in xy plane as function of pT
+  bool mMaxDcaXYPtDepDecreasing{false};         // mMaxDcaXYPtDep does not increase with pT
 
   bool mRequireITSRefit{false};   // require refit in ITS
   bool mRequireTPCRefit{false};   // require refit in TPC
@@ -224,7 +233,9 @@ class TrackSelection
   // vector of ITS requirements (minNRequiredHits in specific requiredLayers)
   std::vector<std::pair<int8_t, std::set<uint8_t>>> mRequiredITSHits{};
 
-  ClassDefNV(TrackSelection, 1);
+  friend class TrackSelectionBatch;
+
+  ClassDefNV(TrackSelection, 2);
 };
 
 #endif
@@ -0,0 +1,218 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+//
+// Evaluation of several track selections in one pass over the tracks,
+// producing a bitmask with one bit per selection and per individual cut
+//
+
+#ifndef TrackSelectionBatch_H
+#define TrackSelectionBatch_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Framework/Logger.h"
+#include "Framework/DataTypes.h"
+#include "Common/Core/TrackSelection.h"
+#include "Common/DataModel/TrackSelectionTables.h"
+
+class TrackSelectionBatch
+{
+ public:
+  static constexpr int NBitsPerSelection = o2::aod::track::trackcutflags::NBitsPerSelection;
+  static constexpr int SelectedBit = o2::aod::track::trackcutflags::SelectedBit;
+  static constexpr int MaxSelections = 64 / NBitsPerSelection;
+  static_assert(static_cast<int>(TrackSelection::TrackCuts::kNCuts) <= SelectedBit, "Too many track cuts for the bitmask layout");
+
+  TrackSelectionBatch() = default;
+
+  /// Adds a track selection, evaluated with the same criteria as TrackSelection::IsSelected
+  /// \return index of the selection in the bitmask
+  int Add(TrackSelection selection)
+  {
+    if (static_cast<int>(mSelections.size()) >= MaxSelections) {
+      LOGF(fatal, "TrackSelectionBatch supports at most %d selections", MaxSelections);
+    }
+    Selection compiled;
+    compiled.trackType = selection.mTrackType;
+    compiled.minPt = selection.mMinPt;
+    compiled.maxPt = selection.mMaxPt;
+    compiled.minEta = selection.mMinEta;
+    compiled.maxEta = selection.mMaxEta;
+    compiled.minNClustersTPC = selection.mMinNClustersTPC;
+    compiled.minNCrossedRowsTPC = selection.mMinNCrossedRowsTPC;
+    compiled.minNClustersITS = selection.mMinNClustersITS;
+    compiled.maxChi2PerClusterTPC = selection.mMaxChi2PerClusterTPC;
+    compiled.maxChi2PerClusterITS = selection.mMaxChi2PerClusterITS;
+    compiled.minNCrossedRowsOverFindableClustersTPC = selection.mMinNCrossedRowsOverFindableClustersTPC;
+    compiled.maxDcaZ = selection.mMaxDcaZ;
+    compiled.requireITSRefit = selection.mRequireITSRefit;
+    compiled.requireTPCRefit = selection.mRequireTPCRefit;
+    compiled.requireGoldenChi2 = selection.mRequireGoldenChi2;
+    // the ITS hit requirements only depend on the 8-bit cluster map
+    for (int clusterMap = 0; clusterMap < 256; clusterMap++) {
+      compiled.itsHits[clusterMap] = selection.FulfillsITSHitRequirements(clusterMap);
+    }
+    compiled.maxDcaXY.init(selection.mMaxDcaXY, selection.mMaxDcaXYPtDep, selection.mMaxDcaXYPtDepDecreasing);
+    mSelections.push_back(std::move(compiled));
+    return mSelections.size() - 1;
+  }
+
+  int GetNSelections() const { return mSelections.size(); }
+
+  /// Evaluates all the selections for a track
+  /// \return bitmask with NBitsPerSelection bits per selection: bit TrackCuts for each cut and SelectedBit if all cuts are passed
+  template <typename T>
+  uint64_t GetFlags(T const& track) const
+  {
+    // each column is read once for all the selections
+    const auto trackType = track.trackType();
+    const bool isRun2 = trackType == o2::aod::track::Run2Track || trackType == o2::aod::track::Run2Tracklet;
+    const auto pt = track.pt();
+    const auto eta = track.eta();
+    const auto tpcNClsFound = track.tpcNClsFound();
+    const auto tpcNClsCrossedRows = track.tpcNClsCrossedRows();
+    const auto tpcCrossedRowsOverFindableCls = track.tpcCrossedRowsOverFindableCls();
+    const auto tpcChi2NCl = track.tpcChi2NCl();
+    const auto itsNCls = track.itsNCls();
+    const auto itsChi2NCl = track.itsChi2NCl();
+    const auto itsClusterMap = track.itsClusterMap();
+    const auto flags = track.flags();
+    const bool hasITS = track.hasITS();
+    const bool hasTPC = track.hasTPC();
+    const float absDcaXY = std::abs(track.dcaXY());
+    const float absDcaZ = std::abs(track.dcaZ());
+
+    uint64_t result = 0;
+    for (std::size_t i = 0; i < mSelections.size(); i++) {
+      const auto& sel = mSelections[i];
+      uint64_t bits = 0;
+      setBit(bits, TrackSelection::TrackCuts::kTrackType, trackType == sel.trackType);
+      setBit(bits, TrackSelection::TrackCuts::kPtRange, pt >= sel.minPt && pt <= sel.maxPt);
+      setBit(bits, TrackSelection::TrackCuts::kEtaRange, eta >= sel.minEta && eta <= sel.maxEta);
+      setBit(bits, TrackSelection::TrackCuts::kTPCNCls, tpcNClsFound >= sel.minNClustersTPC);
+      setBit(bits, TrackSelection::TrackCuts::kTPCCrossedRows, tpcNClsCrossedRows >= sel.minNCrossedRowsTPC);
+      setBit(bits, TrackSelection::TrackCuts::kTPCCrossedRowsOverNCls, tpcCrossedRowsOverFindableCls >= sel.minNCrossedRowsOverFindableClustersTPC);
+      setBit(bits, TrackSelection::TrackCuts::kTPCChi2NDF, tpcChi2NCl <= sel.maxChi2PerClusterTPC);
+      setBit(bits, TrackSelection::TrackCuts::kTPCRefit, sel.requireTPCRefit ? (isRun2 ? (flags & o2::aod::track::TPCrefit) != 0 : hasTPC) : true);
+      setBit(bits, TrackSelection::TrackCuts::kITSNCls, itsNCls >= sel.minNClustersITS);
+      setBit(bits, TrackSelection::TrackCuts::kITSChi2NDF, itsChi2NCl <= sel.maxChi2PerClusterITS);
+      setBit(bits, TrackSelection::TrackCuts::kITSRefit, sel.requireITSRefit ? (isRun2 ? (flags & o2::aod::track::ITSrefit) != 0 : hasITS) : true);
+      setBit(bits, TrackSelection::TrackCuts::kITSHits, sel.itsHits[itsClusterMap]);
+      setBit(bits, TrackSelection::TrackCuts::kGoldenChi2, (isRun2 && sel.requireGoldenChi2) ? (flags & o2::aod::track::GoldenChi2) != 0 : true);
+      setBit(bits, TrackSelection::TrackCuts::kDCAxy, sel.maxDcaXY.passes(absDcaXY, pt));
+      setBit(bits, TrackSelection::TrackCuts::kDCAz, absDcaZ <= sel.maxDcaZ);
+      if (bits == AllCuts) {
+        bits |= uint64_t(1) << SelectedBit;
+      }
+      result |= bits << (i * NBitsPerSelection);
+    }
+    return result;
+  }
+
+  /// \return true if the flags pass all the cuts of the given selection
+  static bool IsSelected(uint64_t flags, int selection)
+  {
+    return (flags >> (selection * NBitsPerSelection + SelectedBit)) & 1;
+  }
+
+  /// \return true if the flags pass the given cut of the given selection
+  static bool IsSelected(uint64_t flags, int selection, TrackSelection::TrackCuts cut)
+  {
+    return (flags >> (selection * NBitsPerSelection + static_cast<int>(cut))) & 1;
+  }
+
+ private:
+  static constexpr uint64_t AllCuts = (uint64_t(1) << static_cast<int>(TrackSelection::TrackCuts::kNCuts)) - 1;
+
+  static void setBit(uint64_t& bits, TrackSelection::TrackCuts cut, bool passed)
+  {
+    bits |= uint64_t(passed) << static_cast<int>(cut);
+  }
+
+  // Maximum DCAxy. A pT dependent cut known not to increase with pT is tabulated at the bin edges in pT: the cut at a pT
+  // within a bin lies between the values at the two edges, so the decision is taken from the table unless the DCAxy lies
+  // between them, and then the function itself is evaluated. Any other pT dependent cut is always evaluated.
+  struct DcaXYCut {
+    static constexpr int NBins = 2000;
+    static constexpr float PtMin = 0.1f;
+    static constexpr float PtMax = 10.1f;
+    static constexpr float Margin = 1e-4f; // relative margin on the values at the edges, covering the rounding of the evaluations
+
+    float maxDcaXY = 1e10f;
+    std::function<float(float)> ptDep{};
+    std::vector<float> passBelow{}; // per bin, DCAxy up to which the cut is passed for any pT in the bin
+    std::vector<float> failAbove{}; // per bin, DCAxy above which the cut is failed for any pT in the bin
+    float invWidth = NBins / (PtMax - PtMin);
+
+    void init(float max, const std::function<float(float)>& function, bool isDecreasing)
+    {
+      maxDcaXY = max;
+      ptDep = function;
+      passBelow.clear();
+      failAbove.clear();
+      if (ptDep && isDecreasing) {
+        float cutLow = ptDep(PtMin);
+        for (int i = 0; i < NBins; i++) {
+          const float cutHigh = ptDep(PtMin + (i + 1) / invWidth);
+          passBelow.push_back(cutHigh - Margin * std::abs(cutHigh));
+          failAbove.push_back(cutLow + Margin * std::abs(cutLow));
+          cutLow = cutHigh;
+        }
+      }
+    }
+
+    bool passes(float absDcaXY, float pt) const
+    {
+      if (!ptDep) {
+        return absDcaXY <= maxDcaXY;
+      }
+      if (passBelow.empty() || !(pt >= PtMin && pt < PtMax)) {
+        return absDcaXY <= ptDep(pt);
+      }
+      const int bin = std::min(static_cast<int>((pt - PtMin) * invWidth), NBins - 1);
+      if (absDcaXY <= passBelow[bin]) {
+        return true;
+      }
+      if (absDcaXY > failAbove[bin]) {
+        return false;
+      }
+      return absDcaXY <= ptDep(pt);
+    }
+  };
+
+  struct Selection {
+    o2::aod::track::TrackTypeEnum trackType{o2::aod::track::TrackTypeEnum::Track};
+    float minPt{0.f}, maxPt{1e10f};
+    float minEta{-1e10f}, maxEta{1e10f};
+    int minNClustersTPC{0};
+    int minNCrossedRowsTPC{0};
+    int minNClustersITS{0};
+    float maxChi2PerClusterTPC{1e10f};
+    float maxChi2PerClusterITS{1e10f};
+    float minNCrossedRowsOverFindableClustersTPC{0.f};
+    float maxDcaZ{1e10f};
+    bool requireITSRefit{false};
+    bool requireTPCRefit{false};
+    bool requireGoldenChi2{false};
+    std::array<bool, 256> itsHits{}; // ITS hit requirements for each cluster map
+    DcaXYCut maxDcaXY{};
+  };
+
+  std::vector<Selection> mSelections{};
+};
+
+#endif
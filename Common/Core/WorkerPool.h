@@ -0,0 +1,123 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+//
+// Pool of worker threads processing an index range (e.g. the rows of a table) in chunks
+//
+
+#ifndef WorkerPool_H
+#define WorkerPool_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+ public:
+  /// \param nThreads Number of threads processing the chunks, including the calling thread
+  explicit WorkerPool(int nThreads)
+  {
+    for (int i = 1; i < nThreads; i++) {
+      mWorkers.emplace_back([this]() { work(); });
+    }
+  }
+
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mWakeUp.notify_all();
+    for (auto& worker : mWorkers) {
+      worker.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  int getNThreads() const { return mWorkers.size() + 1; }
+
+  /// Calls function(begin, end) for the consecutive chunks [begin, end) of at most chunkSize indices covering [0, n).
+  /// The chunks are distributed over the threads as they become free and the call returns when all of them are done.
+  /// If each chunk only writes the results of its own indices, the results do not depend on the number of threads.
+  template <typename F>
+  void forEachChunk(std::size_t n, std::size_t chunkSize, F&& function)
+  {
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+    const std::size_t nChunks = (n + chunkSize - 1) / chunkSize;
+    auto job = [&function, n, chunkSize](std::size_t chunk) {
+      const std::size_t begin = chunk * chunkSize;
+      function(begin, std::min(begin + chunkSize, n));
+    };
+    if (mWorkers.empty() || nChunks < 2) {
+      for (std::size_t chunk = 0; chunk < nChunks; chunk++) {
+        job(chunk);
+      }
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJob = job;
+    mNChunks = nChunks;
+    mNextChunk = 0;
+    mNDone = 0;
+    mWakeUp.notify_all();
+    runChunks(lock);
+    mAllDone.wait(lock, [this]() { return mNDone == mNChunks; });
+    mNChunks = 0;
+    mJob = nullptr;
+  }
+
+ private:
+  /// Processes chunks until there is none left, the lock is released while a chunk is processed
+  void runChunks(std::unique_lock<std::mutex>& lock)
+  {
+    while (mNextChunk < mNChunks) {
+      const std::size_t chunk = mNextChunk++;
+      lock.unlock();
+      mJob(chunk);
+      lock.lock();
+      if (++mNDone == mNChunks) {
+        mAllDone.notify_all();
+      }
+    }
+  }
+
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+      mWakeUp.wait(lock, [this]() { return mStop || mNextChunk < mNChunks; });
+      if (mStop) {
+        return;
+      }
+      runChunks(lock);
+    }
+  }
+
+  std::vector<std::thread> mWorkers{};
+  std::mutex mMutex{};
+  std::condition_variable mWakeUp{};
+  std::condition_variable mAllDone{};
+  std::function<void(std::size_t)> mJob{};
+  std::size_t mNChunks = 0;
+  std::size_t mNextChunk = 0;
+  std::size_t mNDone = 0;
+  bool mStop = false;
+};
+
+#endif
@@ -10,8 +10,16 @@
 // or submit itself to any jurisdiction.
 
 #include <map>
+#include <set>
+#include <cstring>
+#include <algorithm>
+#include <tuple>
 #include <list>
+#include <vector>
+#include <future>
 #include <fstream>
+#include <string>
+#include <chrono>
 #include <getopt.h>
 
 #include "TSystem.h"
@@ -20,9 +28,15 @@
 #include "TList.h"
 #include "TDirectory.h"
 #include "TObjString.h"
+#include "TROOT.h"
+#include "TTreeCacheUnzip.h"
+#include "TBufferFile.h"
+#include "Compression.h"
 #include <TGrid.h>
 #include <TMap.h>
 #include <TLeaf.h>
+#include <TBranch.h>
+#include <TKey.h>
 
 const char* removeVersionSuffix(const char* treeName)
 {
@@ -62,6 +76,397 @@ const char* getTableName(const char* branchName, const char* treeName)
   return tableName;
 }
 
+// Scalar index column which is read, shifted and written back as a whole instead of entry by entry
+struct IndexColumn {
+  int* buffer;             // address connected to the output branch
+  int offset;              // offset of the referenced table in the output tree
+  std::vector<int> values; // content of the column in the current input tree
+};
+
+bool hasIndexColumns(TTree* tree)
+{
+  TObjArray* branches = tree->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+    if (TString(((TBranch*)branches->UncheckedAt(i))->GetName()).BeginsWith("fIndex")) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Column without index which is read as a whole and copied entry by entry into the address of the output branch
+struct BulkColumn {
+  char* buffer;             // address connected to the output branch
+  int entrySize;            // bytes per entry
+  std::vector<char> values; // content of the column in the current input tree
+};
+
+bool readBulk(TBranch* branch, Long64_t entries, int entrySize, char* values)
+{
+  // Reads a full column basket by basket with the bulk I/O interface into values (entries * entrySize bytes)
+  // Returns false if this fails, the caller has to fall back to reading entry by entry
+  TBufferFile buffer(TBuffer::kWrite, 32 * 1024);
+  Long64_t entry = 0;
+  while (entry < entries) {
+    auto count = branch->GetBulkRead().GetBulkEntries(entry, buffer);
+    if (count <= 0) {
+      return false;
+    }
+    count = std::min<Long64_t>(count, entries - entry);
+    memcpy(values + entry * entrySize, buffer.GetCurrent(), count * entrySize);
+    entry += count;
+  }
+  return true;
+}
+
+bool readIndexColumn(TBranch* branch, Long64_t entries, std::vector<int>& values)
+{
+  // Reads a full int column with the bulk I/O interface
+  // Returns false if the branch does not support this, the caller has to fall back to reading entry by entry
+  auto leaf = (TLeaf*)branch->GetListOfLeaves()->First();
+  if (!branch->SupportsBulkRead() || strcmp(leaf->GetTypeName(), "Int_t") != 0 || leaf->GetLenStatic() != 1) {
+    return false;
+  }
+  values.resize(entries);
+  return readBulk(branch, entries, sizeof(int), reinterpret_cast<char*>(values.data()));
+}
+
+bool readBulkColumn(TBranch* branch, Long64_t entries, BulkColumn& column)
+{
+  // Reads a full column of a basic type with a fixed number of elements per entry (scalar or fixed-size array)
+  // Returns false if the branch does not support this, the caller has to fall back to reading entry by entry
+  auto leaf = (TLeaf*)branch->GetListOfLeaves()->First();
+  if (!branch->SupportsBulkRead() || leaf->GetLeafCount() != nullptr || column.buffer == nullptr) {
+    return false;
+  }
+  column.entrySize = leaf->GetLenStatic() * leaf->GetLenType();
+  column.values.resize(entries * column.entrySize);
+  return readBulk(branch, entries, column.entrySize, column.values.data());
+}
+
+long getFilledBytes(TTree* tree)
+{
+  // Returns the sum of the TTree::Fill return values when appending all entries of the tree entry by entry,
+  // i.e. the uncompressed size of the entries of all branches, without reading the tree entry by entry.
+  // The folder size is accounted with this also for trees which are copied as a whole, so that the
+  // output folders are split at the same DFs as when every tree is filled entry by entry.
+  long nbytes = 0;
+  std::vector<int> counts;
+  TObjArray* branches = tree->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+    TBranch* br = (TBranch*)branches->UncheckedAt(i);
+    auto leaf = (TLeaf*)br->GetListOfLeaves()->First();
+    auto leafCount = leaf->GetLeafCount();
+    if (leafCount == nullptr) {
+      nbytes += tree->GetEntries() * leaf->GetLenStatic() * leaf->GetLenType();
+      continue;
+    }
+    // VLA: the number of elements per entry is in the size branch
+    long elements = 0;
+    if (readIndexColumn(leafCount->GetBranch(), tree->GetEntries(), counts)) {
+      for (auto count : counts) {
+        elements += count;
+      }
+    } else {
+      for (Long64_t entry = 0; entry < tree->GetEntries(); ++entry) {
+        leafCount->GetBranch()->GetEntry(entry);
+        elements += (long)leafCount->GetValue();
+      }
+    }
+    nbytes += elements * leaf->GetLenStatic() * leaf->GetLenType();
+  }
+  return nbytes;
+}
+
+int findMinIndex(TTree* tree)
+{
+  // Returns the most negative (i.e. unassigned) index in all index columns of the tree, at most -1
+  // Only the index columns are read, one at a time
+  int minIndex = -1;
+  if (tree->GetEntries() == 0) {
+    return minIndex;
+  }
+  std::vector<int> values;
+  TObjArray* branches = tree->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+    TBranch* br = (TBranch*)branches->UncheckedAt(i);
+    TString branchName(br->GetName());
+    if (!branchName.BeginsWith("fIndex") || branchName.EndsWith("_size")) {
+      continue;
+    }
+    if (readIndexColumn(br, tree->GetEntries(), values)) {
+      for (auto value : values) {
+        minIndex = std::min(minIndex, value);
+      }
+    } else {
+      // arrays, slices and VLAs: the values of all elements are considered
+      auto minimum = tree->GetMinimum(br->GetName());
+      if (minimum < minIndex) {
+        minIndex = (int)minimum;
+      }
+    }
+  }
+  return minIndex;
+}
+
+int shiftIndexColumn(std::vector<int>& values, int offset, int minIndexOffset)
+{
+  // Shifts all indices by offset. If negative, the index is unassigned. In this case, the different unassigned blocks
+  // have to get unique negative IDs: they are shifted by minIndexOffset (< 0) instead.
+  // Returns the smallest index after shifting (which is only negative if there were unassigned indices)
+  // NOTE both loops are branch-free so that they can be vectorized
+  int* data = values.data();
+  const size_t size = values.size();
+  for (size_t i = 0; i < size; i++) {
+    data[i] += (data[i] < 0) ? minIndexOffset : offset;
+  }
+  int minIndex = 0;
+  for (size_t i = 0; i < size; i++) {
+    minIndex = std::min(minIndex, data[i]);
+  }
+  return minIndex;
+}
+
+// Settings of the output trees
+struct OutputSettings {
+  int compression = 501;        // ROOT compression setting: 100 * algorithm + level
+  int basketSize = 0;           // 0: keep the basket sizes of the input
+  long autoFlush = 0;           // TTree::SetAutoFlush convention: > 0 entries, < 0 bytes, 0 disabled
+  static constexpr long OptimizeBasketsAutoFlush = -30000000; // auto-flush of --optimize-baskets if none is given
+  bool optimizeBaskets = false; // size baskets to the clusters, see cloneTree
+  bool recompress = false;      // baskets have to be rewritten, fast cloning is not possible
+};
+
+int parseCompression(const char* value)
+{
+  // Accepts either a ROOT compression setting (e.g. 505) or <algorithm>:<level> (e.g. zstd:5)
+  TString setting(value);
+  if (setting.IsDigit()) {
+    return setting.Atoi();
+  }
+  auto separator = setting.First(":");
+  if (separator < 0) {
+    return -1;
+  }
+  TString algorithm = setting(0, separator);
+  int level = TString(setting(separator + 1, setting.Length())).Atoi();
+  algorithm.ToLower();
+  if (algorithm == "zlib") {
+    return ROOT::CompressionSettings(ROOT::RCompressionSetting::EAlgorithm::kZLIB, level);
+  } else if (algorithm == "lzma") {
+    return ROOT::CompressionSettings(ROOT::RCompressionSetting::EAlgorithm::kLZMA, level);
+  } else if (algorithm == "lz4") {
+    return ROOT::CompressionSettings(ROOT::RCompressionSetting::EAlgorithm::kLZ4, level);
+  } else if (algorithm == "zstd") {
+    return ROOT::CompressionSettings(ROOT::RCompressionSetting::EAlgorithm::kZSTD, level);
+  }
+  return -1;
+}
+
+TTree* cloneTree(TTree* inputTree, const OutputSettings& settings)
+{
+  // Clones the input tree into the current directory
+  if (!settings.recompress) {
+    // NOTE Basket size etc. are copied in CloneTree()
+    auto outputTree = inputTree->CloneTree(-1, "fast");
+    outputTree->SetAutoFlush(settings.autoFlush);
+    return outputTree;
+  }
+
+  // the baskets are rewritten with the output settings: only the structure is cloned and then the entries are copied
+  auto outputTree = inputTree->CloneTree(0);
+  TObjArray* branches = outputTree->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+    ((TBranch*)branches->UncheckedAt(i))->SetCompressionSettings(settings.compression);
+  }
+  if (settings.basketSize > 0) {
+    outputTree->SetBasketSize("*", settings.basketSize);
+  }
+  // With an auto-flush ROOT sizes the baskets of each branch at the first flush such that every branch has one basket
+  // per cluster (TTree::OptimizeBaskets). Columnar reads then need one read per branch and cluster.
+  outputTree->SetAutoFlush(settings.autoFlush);
+  outputTree->CopyEntries(inputTree, -1);
+  return outputTree;
+}
+
+int runBenchmark(const char* sampleFileName, OutputSettings settings, std::vector<int> compressions)
+{
+  // Copies all trees of the sample file with each of the compression settings and reports the write and re-read throughput
+  auto sampleFile = TFile::Open(sampleFileName);
+  if (!sampleFile) {
+    printf("Error: Could not open sample file %s.\n", sampleFileName);
+    return 1;
+  }
+  TString benchmarkFileName = TString::Format("%s/aodMergerBenchmark_%d.root", gSystem->TempDirectory(), gSystem->GetPid());
+  settings.recompress = true;
+
+  printf("%12s %14s %14s %14s %14s\n", "compression", "size (MB)", "ratio", "write (MB/s)", "read (MB/s)");
+  for (auto compression : compressions) {
+    settings.compression = compression;
+    auto benchmarkFile = TFile::Open(benchmarkFileName, "RECREATE", "", compression);
+
+    double totalBytes = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (auto key1 : *sampleFile->GetListOfKeys()) {
+      auto dfName = ((TObjString*)key1)->GetString();
+      if (!dfName.BeginsWith("DF_")) {
+        continue;
+      }
+      auto folder = (TDirectoryFile*)sampleFile->Get(dfName);
+      auto outputDir = benchmarkFile->mkdir(dfName);
+      for (auto key2 : *folder->GetListOfKeys()) {
+        auto inputTree = (TTree*)folder->Get(((TObjString*)key2)->GetString());
+        outputDir->cd();
+        auto outputTree = cloneTree(inputTree, settings);
+        outputTree->Write();
+        totalBytes += outputTree->GetTotBytes();
+        delete outputTree;
+        delete inputTree;
+      }
+    }
+    benchmarkFile->Close();
+    double writeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    delete benchmarkFile;
+
+    startTime = std::chrono::steady_clock::now();
+    benchmarkFile = TFile::Open(benchmarkFileName);
+    double fileSize = benchmarkFile->GetSize();
+    for (auto key1 : *benchmarkFile->GetListOfKeys()) {
+      auto folder = (TDirectoryFile*)benchmarkFile->Get(((TObjString*)key1)->GetString());
+      for (auto key2 : *folder->GetListOfKeys()) {
+        auto tree = (TTree*)folder->Get(((TObjString*)key2)->GetString());
+        auto entries = tree->GetEntries();
+        for (Long64_t i = 0; i < entries; i++) {
+          tree->GetEntry(i);
+        }
+        delete tree;
+      }
+    }
+    benchmarkFile->Close();
+    double readTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    delete benchmarkFile;
+
+    printf("%12d %14.2f %14.2f %14.2f %14.2f\n", compression, fileSize / 1e6, totalBytes / fileSize, totalBytes / 1e6 / writeTime, totalBytes / 1e6 / readTime);
+  }
+
+  gSystem->Unlink(benchmarkFileName);
+  sampleFile->Close();
+  delete sampleFile;
+  return 0;
+}
+
+// DF of an input file with its position in time
+struct DFInfo {
+  std::string name;
+  int runNumber = -1;
+  double firstBC = 0;
+};
+
+// DFs which are merged in one go from the same input file. Empty dfs means all DFs of the file in the order of their names.
+struct InputGroup {
+  std::string fileName;
+  std::vector<DFInfo> dfs;
+};
+
+void getDFRunRange(TDirectory* folder, DFInfo& df)
+{
+  // Reads the run number and the first global BC of a DF from its BC table
+  for (auto key : *folder->GetListOfKeys()) {
+    if (strcmp(removeVersionSuffix(key->GetName()), "O2bc") != 0) {
+      continue;
+    }
+    auto tree = (TTree*)folder->Get(key->GetName());
+    if (tree->GetEntries() > 0) {
+      df.runNumber = (int)tree->GetMinimum("fRunNumber");
+      df.firstBC = tree->GetMinimum("fGlobalBC");
+    }
+    delete tree;
+    return;
+  }
+}
+
+// Merging statistics per tree
+struct TreeStatistics {
+  long rows = 0;      // number of merged entries
+  long bytesIn = 0;   // compressed size in the input files
+  long bytesOut = 0;  // compressed size in the output file
+  double seconds = 0; // time spent to clone and append the tree
+};
+
+void writeStatistics(const std::string& fileName, const std::map<std::string, TreeStatistics>& statistics)
+{
+  FILE* out = fopen(fileName.c_str(), "w");
+  if (!out) {
+    printf("ERROR: Could not open statistics file %s\n", fileName.c_str());
+    return;
+  }
+  fprintf(out, "{\n");
+  size_t n = 0;
+  for (auto const& [treeName, stat] : statistics) {
+    fprintf(out, "  \"%s\": {\"rows\": %ld, \"bytesIn\": %ld, \"bytesOut\": %ld, \"seconds\": %.3f}%s\n",
+            treeName.c_str(), stat.rows, stat.bytesIn, stat.bytesOut, stat.seconds, (++n < statistics.size()) ? "," : "");
+  }
+  fprintf(out, "}\n");
+  fclose(out);
+}
+
+// The merger keeps its bookkeeping in the output, in the single key mergerState: the output folders and the input files
+// merged so far ("outputFolders", "mergedInputFiles"), the state of the last folder to continue it ("lastFolder",
+// "currentDirSize", "runNumber", "unassignedIndexOffset:<tree>") and the key cycles of its trees ("cycle:<tree>").
+// The trees are written as new key cycles and the state is written after all data, so the last complete state
+// describes a consistent output. Folders and tree cycles it does not list are left by a merge which did not finish.
+
+TString getStateValue(TMap* state, const char* key)
+{
+  auto value = (TObjString*)state->GetValue(key);
+  return value ? value->GetString() : TString();
+}
+
+int removeUncommitted(TFile* file, TMap* state)
+{
+  // Removes the output folders and key cycles which are not part of the state, i.e. the data of a merge which did not
+  // finish, the tree cycles superseded by a later one and the older states. Returns the number of removed keys.
+  auto folders = (TList*)state->GetValue("outputFolders");
+  TString lastFolder = getStateValue(state, "lastFolder");
+  auto stateKey = file->GetKey("mergerState");
+  // the keys are collected first, as deleting them modifies the lists of keys
+  std::vector<std::pair<TDirectory*, TString>> removals;
+  std::set<TString> removedFolders;
+  for (auto key : *file->GetListOfKeys()) {
+    TString name(key->GetName());
+    if (name.BeginsWith("DF_") && !folders->FindObject(name)) {
+      if (removedFolders.insert(name).second) {
+        removals.push_back({file, name + ";*"});
+      }
+    } else if (name == "mergerState" && stateKey && ((TKey*)key)->GetCycle() != stateKey->GetCycle()) {
+      removals.push_back({file, TString::Format("%s;%d", name.Data(), ((TKey*)key)->GetCycle())});
+    }
+  }
+  for (auto folderName : *folders) {
+    auto folder = (TDirectory*)file->Get(((TObjString*)folderName)->GetString());
+    if (!folder) {
+      continue;
+    }
+    for (auto key : *folder->GetListOfKeys()) {
+      TString name(key->GetName());
+      int cycle = ((TKey*)key)->GetCycle();
+      // the trees of the last folder may have been continued after the state was written, the other folders are complete
+      int committedCycle = folder->GetKey(name)->GetCycle();
+      if (lastFolder == folder->GetName()) {
+        auto recordedCycle = getStateValue(state, "cycle:" + name);
+        committedCycle = recordedCycle.Length() > 0 ? recordedCycle.Atoi() : -1;
+      }
+      if (cycle != committedCycle) {
+        removals.push_back({folder, TString::Format("%s;%d", name.Data(), cycle)});
+      }
+    }
+  }
+  for (auto const& [dir, nameCycle] : removals) {
+    dir->Delete(nameCycle);
+  }
+  return removals.size();
+}
+
 // AOD merger with correct index rewriting
 // No need to know the datamodel because the branch names follow a canonical standard (identified by fIndex)
 int main(int argc, char* argv[])
@@ -70,6 +475,13 @@ int main(int argc, char* argv[])
   std::string outputFileName("AO2D.root");
   long maxDirSize = 100000000;
   bool skipNonExistingFiles = false;
+  int nJobs = 1;
+  std::string statisticsFileName;
+  OutputSettings outputSettings;
+  std::string benchmarkFileName;
+  bool appendMode = false;
+  bool sortByRun = false;
+  bool bulkIO = true;
   int exitCode = 0; // 0: success, >0: failure
 
   int option_index = 0;
@@ -78,7 +490,17 @@ int main(int argc, char* argv[])
     {"output", required_argument, nullptr, 1},
     {"max-size", required_argument, nullptr, 2},
     {"skip-non-existing-files", no_argument, nullptr, 3},
-    {"help", no_argument, nullptr, 4},
+    {"jobs", required_argument, nullptr, 4},
+    {"stats", required_argument, nullptr, 5},
+    {"compression", required_argument, nullptr, 6},
+    {"basket-size", required_argument, nullptr, 7},
+    {"auto-flush", required_argument, nullptr, 8},
+    {"optimize-baskets", no_argument, nullptr, 9},
+    {"benchmark", required_argument, nullptr, 10},
+    {"append", no_argument, nullptr, 11},
+    {"sort-by-run", no_argument, nullptr, 12},
+    {"no-bulk-io", no_argument, nullptr, 14},
+    {"help", no_argument, nullptr, 13},
     {nullptr, 0, nullptr, 0}};
 
   while (true) {
@@ -94,17 +516,70 @@ int main(int argc, char* argv[])
     } else if (c == 3) {
       skipNonExistingFiles = true;
     } else if (c == 4) {
+      nJobs = atoi(optarg);
+    } else if (c == 5) {
+      statisticsFileName = optarg;
+    } else if (c == 6) {
+      outputSettings.compression = parseCompression(optarg);
+      outputSettings.recompress = true;
+      if (outputSettings.compression < 0) {
+        printf("Error: Invalid compression setting %s\n", optarg);
+        return -2;
+      }
+    } else if (c == 7) {
+      outputSettings.basketSize = atoi(optarg);
+      outputSettings.recompress = true;
+    } else if (c == 8) {
+      outputSettings.autoFlush = atol(optarg);
+    } else if (c == 9) {
+      outputSettings.optimizeBaskets = true;
+      outputSettings.recompress = true;
+    } else if (c == 10) {
+      benchmarkFileName = optarg;
+    } else if (c == 11) {
+      appendMode = true;
+    } else if (c == 12) {
+      sortByRun = true;
+    } else if (c == 14) {
+      bulkIO = false;
+    } else if (c == 13) {
       printf("AOD merging tool. Options: \n");
       printf("  --input <inputfile.txt>      Contains path to files to be merged. Default: %s\n", inputCollection.c_str());
       printf("  --output <outputfile.root>   Target output ROOT file. Default: %s\n", outputFileName.c_str());
       printf("  --max-size <size in Bytes>   Target directory size. Default: %ld\n", maxDirSize);
       printf("  --skip-non-existing-files    Flag to allow skipping of non-existing files in the intput list.\n");
+      printf("  --jobs <n>                   Number of threads used for reading, compression and prefetching of the next input file. Default: %d\n", nJobs);
+      printf("  --stats <stats.json>         Write per-tree merging statistics (rows, bytes in/out, time) to this file.\n");
+      printf("  --compression <setting>      ROOT compression setting (e.g. 505) or <zlib|lzma|lz4|zstd>:<level>. Default: %d (baskets are copied as they are)\n", outputSettings.compression);
+      printf("  --basket-size <size in Bytes> Basket size of the output branches. Default: same as input\n");
+      printf("  --auto-flush <n>             Auto-flush of the output trees (> 0: entries, < 0: bytes). Default: %ld\n", outputSettings.autoFlush);
+      printf("  --optimize-baskets           Rewrite baskets such that each branch has one basket per cluster (for columnar reads). Without --auto-flush the auto-flush is %ld.\n", OutputSettings::OptimizeBasketsAutoFlush);
+      printf("  --benchmark <sample.root>    Report write and read throughput of different compression settings on a sample file and exit.\n");
+      printf("  --append                     Append to an existing output file. Input files which were already merged into it are skipped,\n");
+      printf("                               the data of an append which did not finish is removed.\n");
+      printf("  --sort-by-run                Merge the DFs ordered by run number and first BC. An output folder contains only a single run.\n");
+      printf("  --no-bulk-io                 Append all trees entry by entry without bulk reads (reference for the regression checks).\n");
       return -1;
     } else {
       return -2;
     }
   }
 
+  // the baskets are only optimized at a flush, without a given auto-flush the clusters are made of about 30 MB
+  bool defaultAutoFlush = false;
+  if (outputSettings.optimizeBaskets && outputSettings.autoFlush == 0) {
+    outputSettings.autoFlush = OutputSettings::OptimizeBasketsAutoFlush;
+    defaultAutoFlush = true;
+  }
+
+  if (benchmarkFileName.size() > 0) {
+    std::vector<int> compressions = {0, 101, 404, 505, 208};
+    if (outputSettings.recompress && std::find(compressions.begin(), compressions.end(), outputSettings.compression) == compressions.end()) {
+      compressions.push_back(outputSettings.compression);
+    }
+    return runBenchmark(benchmarkFileName.c_str(), outputSettings, compressions);
+  }
+
   printf("AOD merger started with:\n");
   printf("  Input file: %s\n", inputCollection.c_str());
   printf("  Ouput file name: %s\n", outputFileName.c_str());
@@ -112,38 +587,217 @@ int main(int argc, char* argv[])
   if (skipNonExistingFiles) {
     printf("  WARNING: Skipping non-existing files.\n");
   }
+  if (appendMode) {
+    printf("  Appending to existing output file\n");
+  }
+  if (sortByRun) {
+    printf("  Sorting DFs by run number\n");
+  }
+  if (nJobs > 1) {
+    printf("  Threads: %d\n", nJobs);
+  }
+  if (outputSettings.recompress) {
+    printf("  Compression: %d, basket size: %d, auto-flush: %ld%s%s\n", outputSettings.compression, outputSettings.basketSize,
+           outputSettings.autoFlush, defaultAutoFlush ? " (default of --optimize-baskets)" : "", outputSettings.optimizeBaskets ? ", optimizing baskets" : "");
+  }
+
+  // With more than one job ROOT's thread pool (bounded to nJobs threads) unzips the input baskets
+  // and compresses the output baskets of the different branches in parallel. The content of the
+  // baskets does not depend on this, therefore the output is the same as for a serial merge.
+  if (nJobs > 1) {
+    ROOT::EnableImplicitMT(nJobs);
+    TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+  }
 
   std::map<std::string, TTree*> trees;
   std::map<std::string, int> offsets;
   std::map<std::string, int> unassignedIndexOffset;
+  std::map<std::string, TreeStatistics> statistics;
+  auto collectOutputBytes = [&statistics](std::map<std::string, TTree*> const& trees) {
+    for (auto const& tree : trees) {
+      statistics[tree.first].bytesOut += tree.second->GetZipBytes();
+    }
+  };
 
-  auto outputFile = TFile::Open(outputFileName.c_str(), "RECREATE", "", 501);
+  // In append mode the output is updated in place. New data is only ever added as new folders and new key cycles and
+  // becomes part of the output when the state is written at the end, see removeUncommitted.
+  auto outputFile = TFile::Open(outputFileName.c_str(), appendMode ? "UPDATE" : "RECREATE", "", outputSettings.compression);
+  if (!outputFile || outputFile->IsZombie()) {
+    printf("Error: Could not open output file %s.\n", outputFileName.c_str());
+    return 1;
+  }
   TDirectory* outputDir = nullptr;
   long currentDirSize = 0;
-
-  std::ifstream in;
-  in.open(inputCollection);
-  TString line;
-  bool connectedToAliEn = false;
+  int folderRunNumber = -1;
   TMap* metaData = nullptr;
-  int totalMergedDFs = 0;
   int mergedDFs = 0;
-  while (in.good() && exitCode == 0) {
-    in >> line;
 
-    if (line.Length() == 0) {
-      continue;
+  // Manifest of the input files and output folders merged into the output, kept in the state written to every output,
+  // so that a later merge in append mode can skip already merged inputs and continue filling the last folder.
+  TMap* committedState = nullptr;
+  TList* mergedInputFiles = nullptr;
+  TList* outputFolders = nullptr;
+  if (appendMode) {
+    metaData = (TMap*)outputFile->Get("metaData");
+    committedState = (TMap*)outputFile->Get("mergerState");
+    if (!committedState) {
+      // new output or written without state: everything in it counts as merged
+      committedState = new TMap;
+      committedState->SetOwnerKeyValue();
+      committedState->Add(new TObjString("mergedInputFiles"), new TList);
+      committedState->Add(new TObjString("outputFolders"), new TList);
+      for (auto key : *outputFile->GetListOfKeys()) {
+        if (TString(key->GetName()).BeginsWith("DF_") && !((TList*)committedState->GetValue("outputFolders"))->FindObject(key->GetName())) {
+          ((TList*)committedState->GetValue("outputFolders"))->Add(new TObjString(key->GetName()));
+        }
+      }
+      outputFile->cd();
+      committedState->Write("mergerState", TObject::kSingleKey);
+      outputFile->Write();
+    }
+    int nRemoved = removeUncommitted(outputFile, committedState);
+    if (nRemoved > 0) {
+      printf("Removed %d folders or tree cycles of a merge into %s which did not finish\n", nRemoved, outputFileName.c_str());
+      outputFile->Write();
+    }
+    mergedInputFiles = (TList*)((TList*)committedState->GetValue("mergedInputFiles"))->Clone();
+    outputFolders = (TList*)((TList*)committedState->GetValue("outputFolders"))->Clone();
+    TString lastFolder = getStateValue(committedState, "lastFolder");
+    if (lastFolder.Length() > 0) {
+      printf("Continuing output folder %s\n", lastFolder.Data());
+      outputDir = (TDirectory*)outputFile->Get(lastFolder);
+      currentDirSize = getStateValue(committedState, "currentDirSize").Atoll();
+      if (getStateValue(committedState, "runNumber").Length() > 0) {
+        folderRunNumber = getStateValue(committedState, "runNumber").Atoi();
+      }
+      for (auto key : *outputDir->GetListOfKeys()) {
+        TString treeName(key->GetName());
+        auto tree = (TTree*)outputDir->Get(treeName);
+        // an auto-save would replace the key cycle of the tree listed in the state before the merge is complete
+        tree->SetAutoSave(0);
+        trees[treeName.Data()] = tree;
+        auto minIndexOffset = getStateValue(committedState, "unassignedIndexOffset:" + treeName);
+        unassignedIndexOffset[treeName.Data()] = minIndexOffset.Length() > 0 ? minIndexOffset.Atoi() : -1;
+        offsets[removeVersionSuffix(treeName)] = tree->GetEntries();
+      }
+      // the output already contains DFs, the trees of the next DFs are appended
+      mergedDFs = 1;
     }
+  }
+  if (!mergedInputFiles) {
+    mergedInputFiles = new TList;
+    outputFolders = new TList;
+  }
+  mergedInputFiles->SetOwner();
+  outputFolders->SetOwner();
 
-    if (line.BeginsWith("alien:") && !connectedToAliEn) {
+  std::vector<std::string> inputFiles;
+  std::ifstream in;
+  in.open(inputCollection);
+  std::string entry;
+  bool connectedToAliEn = false;
+  while (in >> entry) {
+    if (entry.rfind("alien:", 0) == 0 && !connectedToAliEn) {
+      // connect upfront, as the files may be opened from the prefetching thread
       printf("Connecting to AliEn...");
       TGrid::Connect("alien:");
       connectedToAliEn = true; // Only try once
     }
+    inputFiles.push_back(entry);
+  }
+
+  std::vector<InputGroup> inputGroups;
+  std::vector<std::pair<std::string, DFInfo>> dfList;
+  for (auto const& fileName : inputFiles) {
+    if (mergedInputFiles->FindObject(fileName.c_str())) {
+      printf("Skipping input file %s which is already merged into the output\n", fileName.c_str());
+      continue;
+    }
+    if (!sortByRun) {
+      inputGroups.push_back({fileName, {}});
+      continue;
+    }
+
+    // Sorting needs the run number and first BC of all DFs upfront. Merged files are read many times by trains which
+    // fetch the conditions (CCDB objects) for every new run: keeping runs together in the output reduces their cache misses.
+    auto inputFile = TFile::Open(fileName.c_str());
+    if (!inputFile) {
+      printf("Error: Could not open input file %s.\n", fileName.c_str());
+      if (skipNonExistingFiles) {
+        continue;
+      } else {
+        printf("Aborting merge!\n");
+        exitCode = 1;
+        break;
+      }
+    }
+    for (auto key : *inputFile->GetListOfKeys()) {
+      TString dfName(key->GetName());
+      if (!dfName.BeginsWith("DF_")) {
+        continue;
+      }
+      DFInfo df{dfName.Data()};
+      getDFRunRange((TDirectory*)inputFile->Get(dfName), df);
+      dfList.push_back({fileName, df});
+    }
+    inputFile->Close();
+    delete inputFile;
+  }
+  if (sortByRun) {
+    std::stable_sort(dfList.begin(), dfList.end(), [](auto const& a, auto const& b) {
+      return std::tie(a.second.runNumber, a.second.firstBC) < std::tie(b.second.runNumber, b.second.firstBC);
+    });
+    // consecutive DFs of the same file are merged without reopening it
+    for (auto const& [fileName, df] : dfList) {
+      if (inputGroups.empty() || inputGroups.back().fileName != fileName) {
+        inputGroups.push_back({fileName, {}});
+      }
+      inputGroups.back().dfs.push_back(df);
+    }
+  }
+  // a file can be split into several groups, it is only fully merged after its last one
+  std::map<std::string, size_t> lastGroupOfFile;
+  for (size_t iGroup = 0; iGroup < inputGroups.size(); ++iGroup) {
+    lastGroupOfFile[inputGroups[iGroup].fileName] = iGroup;
+  }
+  std::set<std::string> openedFiles;
+
+  auto closeOutputFolder = [&]() {
+    for (auto const& tree : trees) {
+      // printf("Writing %s\n", tree.first.c_str());
+      outputDir->cd();
+      tree.second->Write();
+    }
+    collectOutputBytes(trees);
+    for (auto const& tree : trees) {
+      delete tree.second;
+    }
+    outputDir = nullptr;
+    trees.clear();
+    offsets.clear();
+    mergedDFs = 0;
+  };
+
+  // the next input file is opened in the background while the current one is merged
+  std::future<TFile*> nextInputFile;
+  auto openInputFile = [](std::string fileName) -> TFile* { return TFile::Open(fileName.c_str()); };
+
+  int totalMergedDFs = 0;
+  for (size_t iGroup = 0; iGroup < inputGroups.size() && exitCode == 0; ++iGroup) {
+    auto const& inputGroup = inputGroups[iGroup];
+    TString line(inputGroup.fileName.c_str());
 
     printf("Processing input file: %s\n", line.Data());
 
-    auto inputFile = TFile::Open(line);
+    TFile* inputFile = nullptr;
+    if (nextInputFile.valid()) {
+      inputFile = nextInputFile.get();
+    } else {
+      inputFile = openInputFile(inputGroup.fileName);
+    }
+    if (nJobs > 1 && iGroup + 1 < inputGroups.size()) {
+      nextInputFile = std::async(std::launch::async, openInputFile, inputGroups[iGroup + 1].fileName);
+    }
     if (!inputFile) {
       printf("Error: Could not open input file %s.\n", line.Data());
       if (skipNonExistingFiles) {
@@ -157,6 +811,20 @@ int main(int argc, char* argv[])
 
     TList* keyList = inputFile->GetListOfKeys();
     keyList->Sort();
+    bool isFirstGroupOfFile = openedFiles.insert(inputGroup.fileName).second;
+
+    // with sorting only the planned DFs are merged, in the planned order
+    TList plannedKeys;
+    plannedKeys.SetOwner();
+    if (inputGroup.dfs.size() > 0) {
+      if (inputFile->GetKey("metaData") && isFirstGroupOfFile) {
+        plannedKeys.Add(new TObjString("metaData"));
+      }
+      for (auto const& df : inputGroup.dfs) {
+        plannedKeys.Add(new TObjString(df.name.c_str()));
+      }
+      keyList = &plannedKeys;
+    }
 
     for (auto key1 : *keyList) {
       if (((TObjString*)key1)->GetString().EqualTo("metaData")) {
@@ -188,6 +856,15 @@ int main(int argc, char* argv[])
 
       auto dfName = ((TObjString*)key1)->GetString().Data();
 
+      int runNumber = -1;
+      if (sortByRun) {
+        runNumber = std::find_if(inputGroup.dfs.begin(), inputGroup.dfs.end(), [dfName](auto const& df) { return df.name == dfName; })->runNumber;
+        if (outputDir && runNumber != folderRunNumber) {
+          printf("Run changed from %d to %d. Closing folder %s.\n", folderRunNumber, runNumber, outputDir->GetName());
+          closeOutputFolder();
+        }
+      }
+
       printf("  Processing folder %s\n", dfName);
       ++mergedDFs;
       ++totalMergedDFs;
@@ -202,6 +879,14 @@ int main(int argc, char* argv[])
         auto inputTree = (TTree*)inputFile->Get(Form("%s/%s", dfName, treeName));
         printf("    Processing tree %s with %lld entries\n", treeName, inputTree->GetEntries());
 
+        auto& treeStatistics = statistics[treeName];
+        treeStatistics.rows += inputTree->GetEntries();
+        treeStatistics.bytesIn += inputTree->GetZipBytes();
+        auto startTime = std::chrono::steady_clock::now();
+        auto addTime = [&treeStatistics, startTime]() {
+          treeStatistics.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        };
+
         if (trees.count(treeName) == 0) {
           if (mergedDFs > 1) {
             printf("    *** FATAL ***: The tree %s was not in the previous dataframe(s)\n", treeName);
@@ -209,28 +894,58 @@ int main(int argc, char* argv[])
           }
 
           // clone tree
-          // NOTE Basket size etc. are copied in CloneTree()
           if (!outputDir) {
+            if (outputFile->GetKey(dfName)) {
+              printf("    *** FATAL ***: The folder %s already exists in the output\n", dfName);
+              exitCode = 5;
+              break;
+            }
             outputDir = outputFile->mkdir(dfName);
+            outputFolders->Add(new TObjString(dfName));
             currentDirSize = 0;
+            folderRunNumber = runNumber;
             printf("Writing to output folder %s\n", dfName);
           }
           outputDir->cd();
-          auto outputTree = inputTree->CloneTree(-1, "fast");
-          outputTree->SetAutoFlush(0);
+          auto outputTree = cloneTree(inputTree, outputSettings);
           trees[treeName] = outputTree;
           currentDirSize += inputTree->GetTotBytes();
+
+          // the most negative index is needed to continue negative index assignment when appending the next DFs
+          // it is determined here from the input, so that the written output never has to be read back
+          unassignedIndexOffset[treeName] = findMinIndex(inputTree);
+          addTime();
         } else {
           // append tree
           auto outputTree = trees[treeName];
 
+          // without index columns nothing has to be rewritten and the baskets are appended without unpacking them (unless they are recompressed)
+          if (bulkIO && !hasIndexColumns(inputTree)) {
+            outputTree->CopyEntries(inputTree, -1, outputSettings.recompress ? "" : "fast");
+            currentDirSize += getFilledBytes(inputTree);
+            delete inputTree;
+            addTime();
+            continue;
+          }
+
           outputTree->CopyAddresses(inputTree);
 
           // register index and connect VLA columns
           std::vector<std::pair<int*, int>> indexList;
+          std::vector<IndexColumn> indexColumns;
+          std::vector<BulkColumn> bulkColumns;
           std::vector<char*> vlaPointers;
           std::vector<int*> indexPointers;
+          auto entries = inputTree->GetEntries();
           TObjArray* branches = inputTree->GetListOfBranches();
+          // the size branches of the VLAs have to be read together with them
+          std::set<std::string> sizeBranches;
+          for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+            auto leafCount = ((TLeaf*)((TBranch*)branches->UncheckedAt(i))->GetListOfLeaves()->First())->GetLeafCount();
+            if (leafCount != nullptr) {
+              sizeBranches.insert(leafCount->GetBranch()->GetName());
+            }
+          }
           for (int i = 0; i < branches->GetEntriesFast(); ++i) {
             TBranch* br = (TBranch*)branches->UncheckedAt(i);
             TString branchName(br->GetName());
@@ -271,36 +986,35 @@ int main(int argc, char* argv[])
               int* buffer = new int;
               *buffer = 0;
               indexPointers.push_back(buffer);
-
-              inputTree->SetBranchAddress(br->GetName(), buffer);
               outputTree->SetBranchAddress(br->GetName(), buffer);
 
-              indexList.push_back({buffer, offsets[getTableName(branchName, treeName)]});
-            }
-          }
-
-          // on the first appending pass we need to find out the most negative index in the existing output
-          // to correctly continue negative index assignment
-          if (mergedDFs == 2) {
-            int minIndex = -1;
-            if (indexList.size() > 0) {
-              outputTree->SetBranchStatus("*", 0);
-              outputTree->SetBranchStatus("fIndex*", 1);
-              auto outentries = outputTree->GetEntries();
-              for (int i = 0; i < outentries; ++i) {
-                outputTree->GetEntry(i);
-                for (const auto& idx : indexList) {
-                  minIndex = std::min(*(idx.first), minIndex);
-                }
+              // scalar index columns are read in bulk and then not touched anymore by the entry loop
+              IndexColumn column{buffer, offsets[getTableName(branchName, treeName)], {}};
+              if (bulkIO && readIndexColumn(br, entries, column.values)) {
+                inputTree->SetBranchStatus(br->GetName(), 0);
+                indexColumns.push_back(std::move(column));
+              } else {
+                inputTree->SetBranchAddress(br->GetName(), buffer);
+                indexList.push_back({buffer, column.offset});
+              }
+            } else if (sizeBranches.count(br->GetName()) == 0) {
+              // the other columns are read in bulk as well and copied into the address shared with the output branch
+              BulkColumn column{outputTree->GetBranch(br->GetName()) ? outputTree->GetBranch(br->GetName())->GetAddress() : nullptr, 0, {}};
+              if (bulkIO && readBulkColumn(br, entries, column)) {
+                inputTree->SetBranchStatus(br->GetName(), 0);
+                bulkColumns.push_back(std::move(column));
               }
-              outputTree->SetBranchStatus("*", 1);
             }
-            unassignedIndexOffset[treeName] = minIndex;
           }
 
-          auto entries = inputTree->GetEntries();
           int minIndexOffset = unassignedIndexOffset[treeName];
           auto newMinIndexOffset = minIndexOffset;
+
+          // shift the bulk-read index columns by offset
+          for (auto& column : indexColumns) {
+            newMinIndexOffset = std::min(newMinIndexOffset, shiftIndexColumn(column.values, column.offset, minIndexOffset));
+          }
+
           for (int i = 0; i < entries; i++) {
             inputTree->GetEntry(i);
             // shift index columns by offset
@@ -313,6 +1027,12 @@ int main(int argc, char* argv[])
                 *(idx.first) += idx.second;
               }
             }
+            for (const auto& column : indexColumns) {
+              *column.buffer = column.values[i];
+            }
+            for (const auto& column : bulkColumns) {
+              memcpy(column.buffer, column.values.data() + i * column.entrySize, column.entrySize);
+            }
             int nbytes = outputTree->Fill();
             if (nbytes > 0) {
               currentDirSize += nbytes;
@@ -328,6 +1048,7 @@ int main(int argc, char* argv[])
           for (auto& buffer : vlaPointers) {
             delete[] buffer;
           }
+          addTime();
         }
       }
       if (exitCode > 0) {
@@ -365,33 +1086,81 @@ int main(int argc, char* argv[])
 
       if (currentDirSize > maxDirSize) {
         printf("Maximum size reached: %ld. Closing folder %s.\n", currentDirSize, dfName);
-        for (auto const& tree : trees) {
-          // printf("Writing %s\n", tree.first.c_str());
-          outputDir->cd();
-          tree.second->Write();
-          delete tree.second;
-        }
-        outputDir = nullptr;
-        trees.clear();
-        offsets.clear();
-        mergedDFs = 0;
+        closeOutputFolder();
       }
     }
     inputFile->Close();
+    delete inputFile;
+    if (exitCode == 0 && iGroup == lastGroupOfFile[inputGroup.fileName]) {
+      mergedInputFiles->Add(new TObjString(line));
+    }
   }
 
-  outputFile->Write();
-  outputFile->Close();
+  // a prefetched file is pending if the merge was aborted
+  if (nextInputFile.valid()) {
+    delete nextInputFile.get();
+  }
+
+  if (appendMode && totalMergedDFs == 0 && exitCode == 0) {
+    printf("No new input to append.\n");
+    outputFile->Close();
+    if (statisticsFileName.size() > 0) {
+      writeStatistics(statisticsFileName, statistics);
+    }
+    return 0;
+  }
 
-  if (totalMergedDFs == 0) {
+  if (totalMergedDFs == 0 && exitCode == 0) {
     printf("ERROR: Did not merge a single DF. This does not seem right.\n");
     exitCode = 2;
   }
 
+  if (exitCode == 0) {
+    // the data first: the trees of the open folder as new key cycles and the lists of keys of all folders
+    outputFile->Write();
+    collectOutputBytes(trees);
+
+    // then the state, written as a single key, which makes the data part of the output
+    TMap state;
+    state.SetOwnerKeyValue();
+    state.Add(new TObjString("lastFolder"), new TObjString(outputDir ? outputDir->GetName() : ""));
+    state.Add(new TObjString("currentDirSize"), new TObjString(TString::Format("%ld", currentDirSize)));
+    state.Add(new TObjString("runNumber"), new TObjString(TString::Format("%d", folderRunNumber)));
+    for (auto const& tree : trees) {
+      state.Add(new TObjString(TString::Format("unassignedIndexOffset:%s", tree.first.c_str())), new TObjString(TString::Format("%d", unassignedIndexOffset[tree.first])));
+      state.Add(new TObjString(TString::Format("cycle:%s", tree.first.c_str())), new TObjString(TString::Format("%d", outputDir->GetKey(tree.first.c_str())->GetCycle())));
+    }
+    state.Add(new TObjString("mergedInputFiles"), mergedInputFiles);
+    state.Add(new TObjString("outputFolders"), outputFolders);
+    outputFile->cd();
+    state.Write("mergerState", TObject::kSingleKey);
+    outputFile->Write();
+
+    // the key cycles of the continued trees and the state they replace are not needed anymore
+    if (appendMode) {
+      removeUncommitted(outputFile, &state);
+    }
+  } else if (appendMode) {
+    // the data of this merge is removed again, the output keeps the previously merged data
+    for (auto const& tree : trees) {
+      delete tree.second;
+    }
+    trees.clear();
+    removeUncommitted(outputFile, committedState);
+    printf("Merge failed in append mode. The data merged into %s before is unchanged.\n", outputFileName.c_str());
+    delete mergedInputFiles;
+    delete outputFolders;
+  }
+  outputFile->Close();
+
+  if (statisticsFileName.size() > 0) {
+    writeStatistics(statisticsFileName, statistics);
+  }
+
   // in case of failure, remove the incomplete file
-  if (exitCode != 0) {
-    printf("Removing incomplete output file %s.\n", outputFile->GetName());
-    gSystem->Unlink(outputFile->GetName());
+  if (exitCode != 0 && !appendMode) {
+    printf("Removing incomplete output file %s.\n", outputFileName.c_str());
+    gSystem->Unlink(outputFileName.c_str());
   }
 
   printf("AOD merger finished.\n");
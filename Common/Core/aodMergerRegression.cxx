@@ -0,0 +1,355 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// Regression harness of the AOD merger
+// Generates AO2D input files with the index column types the merger rewrites (scalar indices, unassigned indices,
+// index arrays, index slices) and tables without indices, merges them with the merger and a reference and compares
+// the outputs folder by folder, tree by tree and value by value. By default the reference is the same merger appending
+// all trees entry by entry (--no-bulk-io), another merger executable (e.g. of a previous version) can be given instead.
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <getopt.h>
+
+#include "TSystem.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TMap.h"
+#include "TKey.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+#include "TObjString.h"
+#include "TRandom3.h"
+
+void writeInputFile(const char* fileName, int firstDF, int nDFs, TRandom3& random)
+{
+  // Writes nDFs DFs with the layout of an MC AO2D: the index columns of all types the merger handles refer to the
+  // tables of the same DF, about 10% of the scalar indices are unassigned (negative)
+  auto file = TFile::Open(fileName, "RECREATE", "", 505);
+  TMap metaData;
+  metaData.Add(new TObjString("DataType"), new TObjString("MC"));
+  metaData.Write("metaData", TObject::kSingleKey);
+
+  for (int iDF = firstDF; iDF < firstDF + nDFs; ++iDF) {
+    auto dir = file->mkdir(TString::Format("DF_%d", iDF));
+    dir->cd();
+
+    ULong64_t globalBC;
+    int runNumber = 500000 + iDF / 4;
+    auto bcs = new TTree("O2bc_001", "O2bc_001");
+    bcs->Branch("fRunNumber", &runNumber, "fRunNumber/I");
+    bcs->Branch("fGlobalBC", &globalBC, "fGlobalBC/l");
+    int nBCs = 50 + random.Integer(100);
+    for (int i = 0; i < nBCs; ++i) {
+      globalBC = 1000000ull * iDF + 10 * i;
+      bcs->Fill();
+    }
+
+    int indexBC;
+    float posZ;
+    float covariance[6];
+    auto collisions = new TTree("O2collision", "O2collision");
+    collisions->Branch("fIndexBCs", &indexBC, "fIndexBCs/I");
+    collisions->Branch("fPosZ", &posZ, "fPosZ/F");
+    collisions->Branch("fCovariance", covariance, "fCovariance[6]/F");
+    int nCollisions = 1 + random.Integer(20);
+    for (int i = 0; i < nCollisions; ++i) {
+      indexBC = random.Integer(nBCs);
+      posZ = random.Gaus(0, 5);
+      for (auto& element : covariance) {
+        element = random.Uniform();
+      }
+      collisions->Fill();
+    }
+
+    int indexMother[8];
+    int sizeMothers;
+    int indexDaughters[2];
+    int pdgCode;
+    auto particles = new TTree("O2mcparticle_001", "O2mcparticle_001");
+    particles->Branch("fIndexArrayMcParticles_Mothers_size", &sizeMothers, "fIndexArrayMcParticles_Mothers_size/I");
+    particles->Branch("fIndexArrayMcParticles_Mothers", indexMother, "fIndexArrayMcParticles_Mothers[fIndexArrayMcParticles_Mothers_size]/I");
+    particles->Branch("fIndexSliceMcParticles_Daughters", indexDaughters, "fIndexSliceMcParticles_Daughters[2]/I");
+    particles->Branch("fPdgCode", &pdgCode, "fPdgCode/I");
+    int nParticles = 100 + random.Integer(400);
+    for (int i = 0; i < nParticles; ++i) {
+      sizeMothers = i == 0 ? 0 : random.Integer(3);
+      for (int j = 0; j < sizeMothers; ++j) {
+        indexMother[j] = random.Integer(i);
+      }
+      bool hasDaughters = i + 2 < nParticles && random.Uniform() < 0.5;
+      indexDaughters[0] = hasDaughters ? i + 1 : -1;
+      indexDaughters[1] = hasDaughters ? i + 2 : -1;
+      pdgCode = random.Integer(5000) - 2500;
+      particles->Fill();
+    }
+
+    int indexCollision;
+    int indexParticle;
+    float pt;
+    UChar_t flags;
+    auto tracks = new TTree("O2track", "O2track");
+    tracks->Branch("fIndexCollisions", &indexCollision, "fIndexCollisions/I");
+    tracks->Branch("fIndexMcParticles", &indexParticle, "fIndexMcParticles/I");
+    tracks->Branch("fPt", &pt, "fPt/F");
+    tracks->Branch("fFlags", &flags, "fFlags/b");
+    int nTracks = 200 + random.Integer(1000);
+    for (int i = 0; i < nTracks; ++i) {
+      indexCollision = random.Uniform() < 0.1 ? -1 - (int)random.Integer(3) : (int)random.Integer(nCollisions);
+      indexParticle = random.Uniform() < 0.1 ? -1 : (int)random.Integer(nParticles);
+      pt = random.Exp(1);
+      flags = random.Integer(256);
+      tracks->Fill();
+    }
+
+    dir->Write();
+    delete bcs;
+    delete collisions;
+    delete particles;
+    delete tracks;
+  }
+  file->Close();
+  delete file;
+}
+
+std::string removeOption(const std::string& options, const std::string& option)
+{
+  // Removes an option and its argument from a list of options
+  std::string result;
+  bool skipArgument = false;
+  std::unique_ptr<TObjArray> tokens(TString(options).Tokenize(" "));
+  for (auto token : *tokens) {
+    TString value = ((TObjString*)token)->GetString();
+    if (value == option.c_str()) {
+      skipArgument = true;
+    } else if (skipArgument) {
+      skipArgument = false;
+    } else {
+      result += std::string(result.empty() ? "" : " ") + value.Data();
+    }
+  }
+  return result;
+}
+
+double runMerger(const std::string& merger, const std::string& options, const std::string& inputList, const std::string& output)
+{
+  // Returns the wall time of the merge in seconds, or a negative value if it failed
+  TString command = TString::Format("%s --input %s --output %s %s > %s.log 2>&1", merger.c_str(), inputList.c_str(), output.c_str(), options.c_str(), output.c_str());
+  printf("Running %s\n", command.Data());
+  auto startTime = std::chrono::steady_clock::now();
+  int exitCode = gSystem->Exec(command);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  if (exitCode != 0) {
+    printf("ERROR: %s failed with exit code %d, see %s.log\n", merger.c_str(), exitCode, output.c_str());
+    return -1;
+  }
+  return seconds;
+}
+
+int compareTrees(TTree* reference, TTree* tree, const char* path)
+{
+  // Returns the number of differences, each branch is reported at its first differing entry
+  if (reference->GetEntries() != tree->GetEntries()) {
+    printf("DIFFERENCE: %s has %lld entries instead of %lld\n", path, tree->GetEntries(), reference->GetEntries());
+    return 1;
+  }
+  int nDifferences = 0;
+  TObjArray* branches = reference->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+    auto branchName = ((TBranch*)branches->UncheckedAt(i))->GetName();
+    auto referenceLeaf = (TLeaf*)((TBranch*)branches->UncheckedAt(i))->GetListOfLeaves()->First();
+    auto branch = tree->GetBranch(branchName);
+    if (!branch) {
+      printf("DIFFERENCE: %s has no branch %s\n", path, branchName);
+      nDifferences++;
+      continue;
+    }
+    auto leaf = (TLeaf*)branch->GetListOfLeaves()->First();
+    for (Long64_t entry = 0; entry < reference->GetEntries(); ++entry) {
+      // the size branches of the VLAs are read together with them
+      if (referenceLeaf->GetLeafCount() && leaf->GetLeafCount()) {
+        referenceLeaf->GetLeafCount()->GetBranch()->GetEntry(entry);
+        leaf->GetLeafCount()->GetBranch()->GetEntry(entry);
+      }
+      referenceLeaf->GetBranch()->GetEntry(entry);
+      branch->GetEntry(entry);
+      bool same = referenceLeaf->GetLen() == leaf->GetLen();
+      for (int j = 0; same && j < referenceLeaf->GetLen(); ++j) {
+        same = referenceLeaf->GetValue(j) == leaf->GetValue(j);
+      }
+      if (!same) {
+        printf("DIFFERENCE: %s branch %s differs first at entry %lld\n", path, branchName, entry);
+        nDifferences++;
+        break;
+      }
+    }
+  }
+  return nDifferences;
+}
+
+int compareOutputs(const std::string& referenceFileName, const std::string& fileName)
+{
+  // Compares the DF folders and the metadata, the bookkeeping objects of the merger may differ between versions
+  auto referenceFile = TFile::Open(referenceFileName.c_str());
+  auto file = TFile::Open(fileName.c_str());
+  if (!referenceFile || !file) {
+    printf("ERROR: Could not open the outputs %s and %s\n", referenceFileName.c_str(), fileName.c_str());
+    return 1;
+  }
+  int nDifferences = 0;
+  int nFolders = 0;
+  auto compareKeys = [&nDifferences](TFile* from, TFile* to) {
+    for (auto key : *from->GetListOfKeys()) {
+      TString name(key->GetName());
+      if ((name.BeginsWith("DF_") || name == "metaData") && !to->GetKey(name)) {
+        printf("DIFFERENCE: %s only in %s\n", name.Data(), from->GetName());
+        nDifferences++;
+      }
+    }
+  };
+  compareKeys(referenceFile, file);
+  compareKeys(file, referenceFile);
+  for (auto key : *referenceFile->GetListOfKeys()) {
+    TString dfName(key->GetName());
+    if (!dfName.BeginsWith("DF_") || !file->GetKey(dfName)) {
+      continue;
+    }
+    nFolders++;
+    auto referenceFolder = (TDirectory*)referenceFile->Get(dfName);
+    auto folder = (TDirectory*)file->Get(dfName);
+    for (auto treeKey : *referenceFolder->GetListOfKeys()) {
+      auto path = TString::Format("%s/%s", dfName.Data(), treeKey->GetName());
+      auto referenceTree = (TTree*)referenceFolder->Get(treeKey->GetName());
+      auto tree = (TTree*)folder->Get(treeKey->GetName());
+      if (!tree) {
+        printf("DIFFERENCE: %s is missing\n", path.Data());
+        nDifferences++;
+      } else {
+        nDifferences += compareTrees(referenceTree, tree, path);
+      }
+      delete referenceTree;
+      delete tree;
+    }
+    if (folder->GetListOfKeys()->GetEntries() != referenceFolder->GetListOfKeys()->GetEntries()) {
+      printf("DIFFERENCE: %s has %d trees instead of %d\n", dfName.Data(), folder->GetListOfKeys()->GetEntries(), referenceFolder->GetListOfKeys()->GetEntries());
+      nDifferences++;
+    }
+  }
+  printf("Compared %d output folders: %d differences\n", nFolders, nDifferences);
+  referenceFile->Close();
+  file->Close();
+  delete referenceFile;
+  delete file;
+  return nDifferences;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string merger("o2-aod-merger");
+  std::string reference;
+  std::vector<std::string> optionSets = {"", "--max-size 20000", "--max-size 20000 --jobs 4", "--max-size 20000 --compression zstd:5 --optimize-baskets"};
+  std::string workDir = TString::Format("%s/aodMergerRegression_%d", gSystem->TempDirectory(), gSystem->GetPid()).Data();
+  int nFiles = 4;
+  int nDFs = 5;
+  int seed = 1234;
+  bool keep = false;
+
+  int option_index = 0;
+  static struct option long_options[] = {
+    {"merger", required_argument, nullptr, 0},
+    {"reference", required_argument, nullptr, 1},
+    {"options", required_argument, nullptr, 2},
+    {"files", required_argument, nullptr, 3},
+    {"dfs", required_argument, nullptr, 4},
+    {"seed", required_argument, nullptr, 5},
+    {"work-dir", required_argument, nullptr, 6},
+    {"keep", no_argument, nullptr, 7},
+    {"help", no_argument, nullptr, 8},
+    {nullptr, 0, nullptr, 0}};
+
+  while (true) {
+    int c = getopt_long(argc, argv, "", long_options, &option_index);
+    if (c == -1) {
+      break;
+    } else if (c == 0) {
+      merger = optarg;
+    } else if (c == 1) {
+      reference = optarg;
+    } else if (c == 2) {
+      optionSets = {optarg};
+    } else if (c == 3) {
+      nFiles = atoi(optarg);
+    } else if (c == 4) {
+      nDFs = atoi(optarg);
+    } else if (c == 5) {
+      seed = atoi(optarg);
+    } else if (c == 6) {
+      workDir = optarg;
+    } else if (c == 7) {
+      keep = true;
+    } else if (c == 8) {
+      printf("AOD merger regression harness. Options: \n");
+      printf("  --merger <executable>        Merger to check. Default: %s\n", merger.c_str());
+      printf("  --reference <executable>     Merger giving the reference output, e.g. built from a previous version. Default: the checked merger with --no-bulk-io\n");
+      printf("  --options <options>          Merger options to check, the reference runs with the same options except --jobs. Default: several sets of --max-size, --jobs, --compression and --optimize-baskets\n");
+      printf("  --files <n>                  Number of generated input files. Default: %d\n", nFiles);
+      printf("  --dfs <n>                    Number of DFs per input file. Default: %d\n", nDFs);
+      printf("  --seed <n>                   Seed of the generated input. Default: %d\n", seed);
+      printf("  --work-dir <dir>             Directory of the input and output files. Default: %s\n", workDir.c_str());
+      printf("  --keep                       Keep the input and output files.\n");
+      return -1;
+    } else {
+      return -2;
+    }
+  }
+
+  gSystem->mkdir(workDir.c_str(), kTRUE);
+  TRandom3 random(seed);
+  std::string inputList = workDir + "/input.txt";
+  FILE* list = fopen(inputList.c_str(), "w");
+  for (int iFile = 0; iFile < nFiles; ++iFile) {
+    auto fileName = TString::Format("%s/AO2D_%d.root", workDir.c_str(), iFile);
+    writeInputFile(fileName, iFile * nDFs, nDFs, random);
+    fprintf(list, "%s\n", fileName.Data());
+  }
+  fclose(list);
+  printf("Generated %d input files with %d DFs each in %s\n", nFiles, nDFs, workDir.c_str());
+
+  int nFailures = 0;
+  for (size_t iSet = 0; iSet < optionSets.size(); ++iSet) {
+    auto const& options = optionSets[iSet];
+    // the reference merges serially, without bulk I/O if it is the checked merger
+    std::string referenceOptions = removeOption(options, "--jobs");
+    if (reference.empty()) {
+      referenceOptions += " --no-bulk-io";
+    }
+    std::string referenceOutput = TString::Format("%s/reference_%zu.root", workDir.c_str(), iSet).Data();
+    std::string output = TString::Format("%s/output_%zu.root", workDir.c_str(), iSet).Data();
+    double referenceSeconds = runMerger(reference.empty() ? merger : reference, referenceOptions, inputList, referenceOutput);
+    double seconds = runMerger(merger, options, inputList, output);
+    if (referenceSeconds < 0 || seconds < 0) {
+      nFailures++;
+      continue;
+    }
+    printf("Options \"%s\": reference %.2f s, merger %.2f s\n", options.c_str(), referenceSeconds, seconds);
+    if (compareOutputs(referenceOutput, output) != 0) {
+      nFailures++;
+    }
+  }
+
+  if (!keep) {
+    gSystem->Exec(TString::Format("rm -rf %s", workDir.c_str()));
+  }
+  printf("%s: %d of %zu option sets differ from the reference\n", nFailures ? "FAILED" : "PASSED", nFailures, optionSets.size());
+  return nFailures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   benchBetheBlochTable.cxx
+/// \brief  Checks the accuracy of o2::pid::tpc::BetheBlochTable against BetheBlochAleph on a dense random sample of βγ,
+///         i.e. that the bound checked at 7 points per interval when the table is built holds everywhere in the range,
+///         and that the analytic formula is used outside of the range. Compares the timing of the table and of the formula,
+///         and of o2::pid::tpc::Response::GetResponseAllSpecies with and without the table.
+///         Returns a non-zero exit code if the relative error exceeds the requested maximum.
+///
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common/Core/PID/BetheBlochTable.h"
+#include "Common/Core/PID/TPCPIDResponse.h"
+
+using namespace o2::pid::tpc;
+
+namespace
+{
+/// Track with the getters used by the TPC response
+struct Track {
+  float signal, innerParam, oneOverPt, tanLambda;
+  int16_t nClusters;
+  float tpcSignal() const { return signal; }
+  float tpcInnerParam() const { return innerParam; }
+  int16_t tpcNClsFound() const { return nClusters; }
+  float signed1Pt() const { return oneOverPt; }
+  float tgl() const { return tanLambda; }
+};
+
+/// Collision with the getter used by the TPC response
+struct Collision {
+  int mult;
+  int multTPC() const { return mult; }
+};
+
+float analytic(const std::array<float, 5>& p, const float bg)
+{
+  return o2::tpc::BetheBlochAleph(bg, p[0], p[1], p[2], p[3], p[4]);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int n = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  constexpr float BgMin = 0.05f;
+  constexpr float BgMax = 1.e5f;
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  int nFailed = 0;
+
+  // βγ uniform in log inside the tabulated range
+  std::vector<float> bgs(n);
+  for (auto& bg : bgs) {
+    bg = BgMin * std::pow(BgMax / BgMin, uniform(generator));
+  }
+
+  // default parameters of the TPC response and of the TPC reconstruction
+  const std::vector<std::array<float, 5>> parameterSets{Response().GetBetheBlochParams(), {0.0820172f, 9.94795f, 8.97292e-05f, 2.05873f, 1.65272f}};
+  for (std::size_t iSet = 0; iSet < parameterSets.size(); iSet++) {
+    const auto& params = parameterSets[iSet];
+    for (const float maxRelError : {1.e-4f, 1.e-5f}) {
+      BetheBlochTable table;
+      auto start = std::chrono::steady_clock::now();
+      bool isValid = table.Init(params, maxRelError, BgMin, BgMax);
+      double timeInit = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      if (!isValid) {
+        printf("FAILED: parameter set %zu, maximum relative error %g: table not built\n", iSet, maxRelError);
+        ++nFailed;
+        continue;
+      }
+
+      double maxRelDiff = 0.;
+      float bgMaxRelDiff = 0.f;
+      for (const auto bg : bgs) {
+        const float exact = analytic(params, bg);
+        const double relDiff = std::abs(table(bg) - exact) / std::abs(exact);
+        if (relDiff > maxRelDiff) {
+          maxRelDiff = relDiff;
+          bgMaxRelDiff = bg;
+        }
+      }
+      // outside of the range the table gives the analytic formula
+      for (const float bg : {0.01f, 0.049f, std::nextafter(BgMin, 0.f), BgMax, 2.e5f}) {
+        const float exact = analytic(params, bg);
+        const float value = table(bg);
+        if (std::memcmp(&exact, &value, sizeof(float)) != 0) {
+          printf("FAILED: parameter set %zu: βγ %g outside of the table: %a instead of %a\n", iSet, bg, value, exact);
+          ++nFailed;
+        }
+      }
+      const bool isOK = maxRelDiff <= maxRelError;
+      printf("parameter set %zu, maximum relative error %g: %d intervals built in %.2f ms, error at the check points %g, on %d random βγ %g (βγ = %g)%s\n",
+             iSet, maxRelError, table.GetNIntervals(), timeInit, table.GetMaxRelError(), n, maxRelDiff, bgMaxRelDiff, isOK ? "" : " FAILED");
+      nFailed += !isOK;
+    }
+  }
+
+  // micro-benchmark of a single evaluation
+  {
+    const auto& params = parameterSets[0];
+    BetheBlochTable table;
+    table.Init(params, 1.e-5f, BgMin, BgMax);
+    double sum = 0.;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto bg : bgs) {
+      sum += analytic(params, bg);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (const auto bg : bgs) {
+      sum += table(bg);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    printf("BetheBlochAleph %.2f ns, table %.2f ns per call (checksum %g)\n", std::chrono::duration<double, std::nano>(middle - start).count() / n,
+           std::chrono::duration<double, std::nano>(stop - middle).count() / n, sum);
+  }
+
+  // TPC response of random tracks for all the species, with and without the table
+  const int nTracks = n / 20;
+  std::vector<Track> tracks(nTracks);
+  std::vector<Collision> collisions(nTracks);
+  for (int i = 0; i < nTracks; i++) {
+    tracks[i] = Track{uniform(generator) * 300.f, 0.1f + uniform(generator) * uniform(generator) * 20.f,
+                      (uniform(generator) - 0.5f) * 20.f, (uniform(generator) - 0.5f) * 2.f, static_cast<int16_t>(1 + uniform(generator) * 159)};
+    collisions[i] = Collision{static_cast<int>(uniform(generator) * 5000)};
+  }
+  for (int mode = 0; mode < 2; mode++) {
+    Response responseAnalytic, responseTable;
+    responseAnalytic.SetUseDefaultResolutionParam(mode == 0);
+    responseTable.SetUseDefaultResolutionParam(mode == 0);
+    responseTable.SetBetheBlochTable(1.e-5f);
+    Response::SpeciesArray expSignal, expSigma, nSigma, expSignalTable, expSigmaTable, nSigmaTable;
+    double maxRelDiffSignal = 0.;
+    double maxDiffNSigma = 0.;
+    for (int i = 0; i < nTracks; i++) {
+      responseAnalytic.GetResponseAllSpecies(collisions[i], tracks[i], expSignal, expSigma, nSigma);
+      responseTable.GetResponseAllSpecies(collisions[i], tracks[i], expSignalTable, expSigmaTable, nSigmaTable);
+      for (int id = 0; id < Response::NSpecies; id++) {
+        if (expSignal[id] > 0.f) {
+          maxRelDiffSignal = std::max(maxRelDiffSignal, static_cast<double>(std::abs(expSignalTable[id] - expSignal[id]) / expSignal[id]));
+        }
+        if (std::isfinite(nSigma[id])) {
+          maxDiffNSigma = std::max(maxDiffNSigma, static_cast<double>(std::abs(nSigmaTable[id] - nSigma[id]) / std::max(1.f, std::abs(nSigma[id]))));
+        }
+      }
+    }
+    double sum = 0.;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nTracks; i++) {
+      responseAnalytic.GetResponseAllSpecies(collisions[i], tracks[i], expSignal, expSigma, nSigma);
+      sum += nSigma[2];
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < nTracks; i++) {
+      responseTable.GetResponseAllSpecies(collisions[i], tracks[i], expSignal, expSigma, nSigma);
+      sum += nSigma[2];
+    }
+    auto stop = std::chrono::steady_clock::now();
+    printf("GetResponseAllSpecies, %s resolution: max. relative difference of the expected signal %g, max. difference of the nσ %g (relative for |nσ| > 1); "
+           "formula %.0f ns, table %.0f ns per track (checksum %g)\n",
+           mode == 0 ? "default" : "full", maxRelDiffSignal, maxDiffNSigma, std::chrono::duration<double, std::nano>(middle - start).count() / nTracks,
+           std::chrono::duration<double, std::nano>(stop - middle).count() / nTracks, sum);
+  }
+
+  printf("%s\n", nFailed ? "FAILED" : "OK");
+  return nFailed ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   benchTPCPIDResponseAllSpecies.cxx
+/// \brief  Checks that o2::pid::tpc::Response::GetResponseAllSpecies is bitwise identical to the single-species getters
+///         for random tracks, with the default and the full resolution parametrization, and compares their timing.
+///         Returns a non-zero exit code if a value differs.
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common/Core/PID/TPCPIDResponse.h"
+
+namespace
+{
+/// Track with the getters used by the TPC response
+struct Track {
+  float signal, innerParam, oneOverPt, tanLambda;
+  int16_t nClusters;
+  float tpcSignal() const { return signal; }
+  float tpcInnerParam() const { return innerParam; }
+  int16_t tpcNClsFound() const { return nClusters; }
+  float signed1Pt() const { return oneOverPt; }
+  float tgl() const { return tanLambda; }
+};
+
+/// Collision with the getter used by the TPC response
+struct Collision {
+  int mult;
+  int multTPC() const { return mult; }
+};
+
+bool isBitwiseEqual(float a, float b)
+{
+  return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int nTracks = argc > 1 ? std::atoi(argv[1]) : 300000;
+  using Response = o2::pid::tpc::Response;
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::vector<Track> tracks(nTracks);
+  std::vector<Collision> collisions(nTracks);
+  for (int i = 0; i < nTracks; i++) {
+    // includes tracks without clusters
+    tracks[i] = Track{uniform(generator) * 300.f, 0.05f + uniform(generator) * uniform(generator) * 20.f,
+                      (uniform(generator) - 0.5f) * 20.f, (uniform(generator) - 0.5f) * 2.f, static_cast<int16_t>(uniform(generator) * 160)};
+    collisions[i] = Collision{static_cast<int>(uniform(generator) * 5000)};
+  }
+
+  long nDifferent = 0;
+  long nChecked = 0;
+  for (int mode = 0; mode < 2; mode++) {
+    Response response;
+    response.SetUseDefaultResolutionParam(mode == 0);
+    Response::SpeciesArray expSignal, expSigma, nSigma;
+    for (int i = 0; i < nTracks; i++) {
+      response.GetResponseAllSpecies(collisions[i], tracks[i], expSignal, expSigma, nSigma);
+      for (int id = 0; id < Response::NSpecies; id++) {
+        float expSignalSingle = response.GetExpectedSignal(tracks[i], id);
+        float expSigmaSingle = response.GetExpectedSigma(collisions[i], tracks[i], id);
+        float nSigmaSingle = response.GetNumberOfSigma(collisions[i], tracks[i], id);
+        ++nChecked;
+        if (!isBitwiseEqual(expSignal[id], expSignalSingle) || !isBitwiseEqual(expSigma[id], expSigmaSingle) || !isBitwiseEqual(nSigma[id], nSigmaSingle)) {
+          if (nDifferent++ < 10) {
+            printf("FAILED: %s resolution, track %d, species %d: signal %a vs %a, sigma %a vs %a, nsigma %a vs %a\n", mode == 0 ? "default" : "full", i, id,
+                   expSignal[id], expSignalSingle, expSigma[id], expSigmaSingle, nSigma[id], nSigmaSingle);
+          }
+        }
+      }
+    }
+
+    double sum = 0.;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nTracks; i++) {
+      for (int id = 0; id < Response::NSpecies; id++) {
+        sum += response.GetExpectedSigma(collisions[i], tracks[i], id) + response.GetNumberOfSigma(collisions[i], tracks[i], id);
+      }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < nTracks; i++) {
+      response.GetResponseAllSpecies(collisions[i], tracks[i], expSignal, expSigma, nSigma);
+      for (int id = 0; id < Response::NSpecies; id++) {
+        sum += expSigma[id] + nSigma[id];
+      }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    printf("%s resolution: single-species getters %.0f ns, GetResponseAllSpecies %.0f ns per track for %d species (checksum %g)\n",
+           mode == 0 ? "default" : "full", std::chrono::duration<double, std::nano>(middle - start).count() / nTracks,
+           std::chrono::duration<double, std::nano>(stop - middle).count() / nTracks, Response::NSpecies, sum);
+  }
+
+  printf("%ld track/species combinations checked, %ld not bitwise identical: %s\n", nChecked, nDifferent, nDifferent ? "FAILED" : "OK");
+  return nDifferent ? 1 : 0;
+}
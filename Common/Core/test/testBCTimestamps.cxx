@@ -0,0 +1,105 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testBCTimestamps.cxx
+/// \brief  Checks that the timestamps of a whole BC table computed with o2::analysis::timestamp::fillTimestamps, as in the
+///         table mode of the timestamp task (processTable), are the same as the ones computed BC by BC with getTimestamp,
+///         as in processBC. The data frames contain several runs, in blocks of random length, including runs that come back
+///         after a block of another run (A, B, A) and empty blocks, for Run 3 data and in the Run 2 MC mode.
+///         Also checks that the start of the run is looked up once per block of BCs of the same run.
+///         Returns a non-zero exit code if a check fails.
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Common/Core/BCTimestamps.h"
+
+using namespace o2::analysis::timestamp;
+
+int main(int argc, char* argv[])
+{
+  const int nDataFrames = argc > 1 ? std::atoi(argv[1]) : 200;
+  const int nRuns = 8;
+  std::mt19937_64 generator(3);
+
+  // SOR timestamp and first orbit of each run
+  std::map<int, RunStart> runStarts;
+  for (int run = 0; run < nRuns; run++) {
+    runStarts[500000 + run] = RunStart{1650000000000L + run * 3600000L, o2::InteractionRecord(0, static_cast<uint32_t>(generator() % 100000000))};
+  }
+
+  int nFailed = 0;
+  long nBCs = 0, nMultiRun = 0, nRepeatedRun = 0;
+  double timeReference = 0., timeTable = 0.;
+  for (const bool isRun2MC : {false, true}) {
+    for (int df = 0; df < nDataFrames; df++) {
+      // Blocks of BCs of random runs, with increasing global BCs inside each block
+      std::vector<uint64_t> globalBCs;
+      std::vector<int> runNumbers;
+      int nBlocks = 0;
+      std::map<int, int> nBlocksOfRun;
+      const int nBlocksGenerated = 1 + generator() % 6;
+      for (int block = 0; block < nBlocksGenerated; block++) {
+        const int run = 500000 + generator() % nRuns;
+        const int n = generator() % 3000;
+        if (n > 0 && (runNumbers.empty() || runNumbers.back() != run)) {
+          nBlocks++;
+          nBlocksOfRun[run]++;
+        }
+        uint64_t globalBC = static_cast<uint64_t>(runStarts[run].firstIR.orbit) * o2::constants::lhc::LHCMaxBunches + generator() % 1000000000;
+        for (int i = 0; i < n; i++) {
+          globalBC += 1 + generator() % 5000;
+          globalBCs.push_back(globalBC);
+          runNumbers.push_back(run);
+        }
+      }
+      nBCs += globalBCs.size();
+      nMultiRun += nBlocksOfRun.size() > 1;
+      for (const auto& run : nBlocksOfRun) {
+        nRepeatedRun += run.second > 1;
+      }
+
+      // BC by BC, as processBC
+      std::vector<uint64_t> reference(globalBCs.size());
+      auto start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < globalBCs.size(); i++) {
+        reference[i] = getTimestamp(runStarts[runNumbers[i]], globalBCs[i], isRun2MC);
+      }
+      timeReference += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+      // Whole table, as processTable, with an output buffer reused from a previous (larger) data frame
+      std::vector<uint64_t> timestamps(5000, 0);
+      int nLookups = 0;
+      start = std::chrono::steady_clock::now();
+      fillTimestamps(globalBCs, runNumbers, isRun2MC, [&](const int run) { nLookups++; return runStarts[run]; }, timestamps);
+      timeTable += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+      if (timestamps != reference) {
+        printf("FAILED: %s data frame %d with %zu BCs in %d blocks: different timestamps\n", isRun2MC ? "Run 2 MC" : "Run 3", df, globalBCs.size(), nBlocks);
+        nFailed++;
+      }
+      if (nLookups != nBlocks) {
+        printf("FAILED: %s data frame %d: %d lookups of the run start for %d blocks\n", isRun2MC ? "Run 2 MC" : "Run 3", df, nLookups, nBlocks);
+        nFailed++;
+      }
+    }
+  }
+  printf("%d data frames, %ld BCs, %ld data frames with several runs, %ld runs split in several blocks: per BC, BC by BC %.1f ns, whole table %.1f ns\n",
+         2 * nDataFrames, nBCs, nMultiRun, nRepeatedRun, timeReference / nBCs, timeTable / nBCs);
+  printf("%s\n", nFailed ? "FAILED" : "OK");
+  return nFailed ? 1 : 0;
+}
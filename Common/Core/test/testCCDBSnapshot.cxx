@@ -0,0 +1,167 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testCCDBSnapshot.cxx
+/// \brief  Checks the round trip of CCDB objects through a snapshot file written by CCDBSnapshotWriter and read by CCDBSnapshot:
+///         objects in consecutive validity intervals added out of order, an object overlapping shorter ones, an object with
+///         headers only as the RCT ones, the lookup of the latest object for a negative timestamp, the headers with the
+///         validity interval, the objects deserialized once, the missing objects, the selection through the url and
+///         the recording of the requests to the CCDB in the file given by O2_CCDB_SNAPSHOT_RECORD.
+///         Returns a non-zero exit code if a check fails.
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Common/Core/CCDBSnapshot.h"
+// ROOT includes
+#include "TNamed.h"
+
+namespace
+{
+int nFailed = 0;
+
+void check(const bool isOK, const char* what, const long timestamp = 0)
+{
+  if (!isOK && nFailed++ < 20) {
+    printf("FAILED: %s (timestamp %ld)\n", what, timestamp);
+  }
+}
+
+/// Image of a TNamed as stored in the CCDB
+std::vector<char> makeBlob(const std::string& title)
+{
+  TNamed object("object", title.c_str());
+  return *o2::ccdb::CcdbApi::createObjectImage(&object);
+}
+
+/// Stand-in for the BasicCCDBManager service, which is not used when the requests are only recorded
+struct Manager {
+  TNamed object{"object", "from the CCDB"};
+  template <typename T>
+  T* get(const std::string&)
+  {
+    return &object;
+  }
+  template <typename T>
+  T* getForTimeStamp(const std::string&, long)
+  {
+    return &object;
+  }
+};
+struct ManagerService {
+  Manager manager;
+  Manager* operator->() { return &manager; }
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int nLookups = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const std::string fileName = "testCCDBSnapshot.bin";
+  const std::string recordFileName = "testCCDBSnapshotRecord.txt";
+  const long intervalLength = 100;
+
+  // Path A: consecutive intervals [i * 100, (i + 1) * 100) added in reverse order,
+  // path B: an object valid in [0, 1000) and a shorter one valid in [200, 300), RCT: headers only
+  {
+    CCDBSnapshotWriter writer;
+    for (int i = 9; i >= 0; i--) {
+      writer.add("A", i * intervalLength, (i + 1) * intervalLength, {{"Key", "A" + std::to_string(i)}}, makeBlob("A" + std::to_string(i)));
+    }
+    check(!writer.add("A", 0, intervalLength, {}, makeBlob("duplicate")), "same object added twice");
+    writer.add("B", 0, 1000, {}, makeBlob("long"));
+    writer.add("B", 200, 300, {}, makeBlob("short"));
+    writer.add("RCT/Info/RunInformation/500000", 0, 10, {{"SOR", "1650000000000"}, {"EOR", "1650003600000"}}, {});
+    check(writer.size() == 13, "number of objects");
+    check(writer.write(fileName), "snapshot written");
+  }
+
+  CCDBSnapshot* snapshot = CCDBSnapshot::fromUrl(CCDBSnapshot::UrlPrefix + fileName);
+  check(snapshot != nullptr && CCDBSnapshot::fromUrl("http://alice-ccdb.cern.ch") == nullptr, "snapshot selected by the url");
+  if (!snapshot) {
+    printf("FAILED\n");
+    return 1;
+  }
+  check(&CCDBSnapshot::open(fileName) == snapshot, "snapshot opened once");
+
+  for (long timestamp = 0; timestamp < 10 * intervalLength; timestamp++) {
+    const std::string expected = "A" + std::to_string(timestamp / intervalLength);
+    auto* objectA = snapshot->getForTimeStamp<TNamed>("A", timestamp);
+    check(objectA && expected == objectA->GetTitle(), "object of consecutive intervals", timestamp);
+    check(objectA == snapshot->getForTimeStamp<TNamed>("A", timestamp), "object deserialized once", timestamp);
+    auto headers = snapshot->retrieveHeaders("A", {}, timestamp);
+    check(headers["Key"] == expected && headers["Valid-From"] == std::to_string(timestamp / intervalLength * intervalLength) &&
+            headers["Valid-Until"] == std::to_string((timestamp / intervalLength + 1) * intervalLength),
+          "headers and validity", timestamp);
+    auto* objectB = snapshot->getForTimeStamp<TNamed>("B", timestamp);
+    check(objectB && std::string(objectB->GetTitle()) == (timestamp >= 200 && timestamp < 300 ? "short" : "long"), "overlapping objects", timestamp);
+  }
+  check(snapshot->getForTimeStamp<TNamed>("A", 10 * intervalLength) == nullptr, "no object after the last interval", 10 * intervalLength);
+  check(snapshot->getForTimeStamp<TNamed>("C", 0) == nullptr && snapshot->retrieveHeaders("C", {}, 0).empty(), "no object for an unknown path");
+  auto* latest = snapshot->get<TNamed>("A");
+  check(latest && std::string(latest->GetTitle()) == "A9", "latest object", -1);
+
+  auto headers = snapshot->retrieveHeaders("RCT/Info/RunInformation/500000", {}, -1);
+  check(headers["SOR"] == "1650000000000" && headers["EOR"] == "1650003600000" && headers["Valid-Until"] == "10", "headers of an object without payload", -1);
+
+  long from = 0, until = 0;
+  std::unique_ptr<TNamed> copy(snapshot->retrieveObject<TNamed>("B", 250, from, until));
+  check(copy && std::string(copy->GetTitle()) == "short" && copy.get() != snapshot->getForTimeStamp<TNamed>("B", 250) && from == 200 && until == 300,
+        "copy of the object with its validity", 250);
+
+  // Requests to the CCDB without snapshot, each recorded once
+  std::remove(recordFileName.c_str());
+  setenv(CCDBSnapshot::RecordFileVariable, recordFileName.c_str(), 1);
+  ManagerService ccdb;
+  check(CCDBSnapshot::getObject<TNamed>(nullptr, ccdb, "GLO/GRP/GRP", 123) == &ccdb->object, "object from the CCDB manager");
+  CCDBSnapshot::getObject<TNamed>(nullptr, ccdb, "GLO/GRP/GRP", 123);
+  CCDBSnapshot::getObject<TNamed>(nullptr, ccdb, "GLO/Param/MatLUT");
+  CCDBSnapshot::record("RCT/Info/RunInformation/500000", -1);
+  auto* fromSnapshot = CCDBSnapshot::getObject<TNamed>(snapshot, ccdb, "A", 150);
+  check(fromSnapshot && std::string(fromSnapshot->GetTitle()) == "A1", "object from the snapshot", 150);
+  {
+    std::ifstream in(recordFileName);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) {
+      lines.push_back(line);
+    }
+    check(lines == std::vector<std::string>{"GLO/GRP/GRP 123", "GLO/Param/MatLUT -1", "RCT/Info/RunInformation/500000 -1"}, "recorded requests");
+  }
+
+  // Lookup time of the objects
+  std::mt19937 generator(17);
+  std::uniform_int_distribution<long> uniform(0, 10 * intervalLength - 1);
+  std::vector<long> timestamps(nLookups);
+  for (auto& timestamp : timestamps) {
+    timestamp = uniform(generator);
+  }
+  long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto timestamp : timestamps) {
+    sum += snapshot->getForTimeStamp<TNamed>("A", timestamp) != nullptr;
+  }
+  double time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  check(sum == nLookups, "lookups");
+  printf("%d lookups of the deserialized objects: %.1f ns per lookup\n", nLookups, time / nLookups);
+
+  std::remove(fileName.c_str());
+  std::remove(recordFileName.c_str());
+  printf("%s\n", nFailed ? "FAILED" : "OK");
+  return nFailed ? 1 : 0;
+}
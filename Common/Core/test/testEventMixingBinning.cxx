@@ -0,0 +1,190 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testEventMixingBinning.cxx
+/// \brief  Checks the mixing binning of Common/Core/EventMixing.h against the previous implementations
+///         of eventmixing::getMixingBin and MixingHandler::FindEventCategory (PWGDQ), with values on the bin edges,
+///         next to them, outside the binning, infinite, NaN and random.
+///         Returns a non-zero exit code if a bin number differs.
+///
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Common/Core/EventMixing.h"
+
+namespace
+{
+/// Previous implementation of eventmixing::getMixingBin
+template <typename T1, typename T2>
+int getMixingBinPrevious(const T1& vtxBins, const T1& multBins, const T2& vtx, const T2& mult)
+{
+  if (vtx < vtxBins.at(0)) {
+    return -1;
+  }
+  if (mult < multBins.at(0)) {
+    return -1;
+  }
+  for (unsigned int i = 1; i < vtxBins.size(); i++) {
+    if (vtx < vtxBins.at(i)) {
+      for (unsigned int j = 1; j < multBins.size(); j++) {
+        if (mult < multBins.at(j)) {
+          return i + j * (vtxBins.size() + 1);
+        }
+      }
+    }
+  }
+  return -1;
+}
+
+/// TMath::BinarySearch
+int binarySearch(int n, const float* array, float value)
+{
+  const float* pind = std::lower_bound(array, array + n, value);
+  if ((pind != array + n) && (*pind == value)) {
+    return pind - array;
+  }
+  return pind - array - 1;
+}
+
+/// Previous implementation of MixingHandler::FindEventCategory
+int findEventCategoryPrevious(const std::vector<std::vector<float>>& limits, const std::vector<int>& variables, const float* values)
+{
+  std::vector<int> bin;
+  for (std::size_t iVar = 0; iVar < limits.size(); iVar++) {
+    int binValue = binarySearch(limits[iVar].size(), limits[iVar].data(), values[variables[iVar]]);
+    bin.push_back(binValue);
+    if (bin[iVar] == -1 || bin[iVar] == static_cast<int>(limits[iVar].size()) - 1) {
+      return -1;
+    }
+  }
+  int category = 0;
+  for (std::size_t iv1 = 0; iv1 < variables.size(); iv1++) {
+    int tempCategory = 1;
+    for (std::size_t iv2 = iv1; iv2 < variables.size(); iv2++) {
+      tempCategory *= (iv2 == iv1 ? bin[iv2] : static_cast<int>(limits[iv2].size()) - 1);
+    }
+    category += tempCategory;
+  }
+  return category;
+}
+
+/// Values on the edges, next to them, outside, infinite, NaN and random within the range
+std::vector<float> getTestValues(const std::vector<float>& edges, std::mt19937& generator)
+{
+  std::vector<float> values{std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+  for (auto edge : edges) {
+    values.push_back(edge);
+    values.push_back(std::nextafter(edge, -std::numeric_limits<float>::infinity()));
+    values.push_back(std::nextafter(edge, std::numeric_limits<float>::infinity()));
+  }
+  values.push_back(edges.front() - 1.f);
+  values.push_back(edges.back() + 1.f);
+  std::uniform_real_distribution<float> uniform(edges.front(), edges.back());
+  for (int i = 0; i < 50; i++) {
+    values.push_back(uniform(generator));
+  }
+  return values;
+}
+} // namespace
+
+int main()
+{
+  std::mt19937 generator(42);
+  int nFailed = 0;
+  long nChecked = 0;
+
+  // binnings: defaults of the FemtoDream hash task, uniform with edges not exactly representable, non-uniform, single bin
+  std::vector<std::vector<float>> binnings{
+    {-10.0f, -8.f, -6.f, -4.f, -2.f, 0.f, 2.f, 4.f, 6.f, 8.f, 10.f},
+    {0.0f, 20.0f, 40.0f, 60.0f, 80.0f, 100.0f, 200.0f, 99999.f},
+    {0.f, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f, 0.9f, 1.f},
+    {-0.3f, -0.2f, -0.1f, 0.f, 0.1f, 0.2f, 0.3f},
+    {0.f, 5.f, 10.f, 20.f, 30.f, 40.f, 50.f, 60.f, 70.f, 80.f, 90.f},
+    {1.f, 2.f}};
+  std::vector<std::vector<float>> values;
+  for (const auto& edges : binnings) {
+    values.push_back(getTestValues(edges, generator));
+  }
+
+  // eventmixing::getMixingBin and getMixingBinning
+  for (std::size_t iVtx = 0; iVtx < binnings.size(); iVtx++) {
+    for (std::size_t iMult = 0; iMult < binnings.size(); iMult++) {
+      const auto& vtxBins = binnings[iVtx];
+      const auto& multBins = binnings[iMult];
+      auto binning = eventmixing::getMixingBinning(vtxBins, multBins);
+      for (auto vtx : values[iVtx]) {
+        for (auto mult : values[iMult]) {
+          int binPrevious = getMixingBinPrevious(vtxBins, multBins, vtx, mult);
+          int bin = eventmixing::getMixingBin(vtxBins, multBins, vtx, mult);
+          int binBinning = binning.getBin({vtx, mult});
+          ++nChecked;
+          if (bin != binPrevious || binBinning != binPrevious) {
+            if (nFailed++ < 20) {
+              printf("FAILED getMixingBin: binnings %zu, %zu, vtx %.9g, mult %.9g: previous %d, getMixingBin %d, getMixingBinning %d\n",
+                     iVtx, iMult, vtx, mult, binPrevious, bin, binBinning);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // MixingHandler: three variables, stored in a value array in a different order
+  const std::vector<int> variables{2, 0, 1};
+  for (std::size_t i0 = 0; i0 < binnings.size(); i0++) {
+    for (std::size_t i1 = 0; i1 < binnings.size(); i1 += 2) {
+      for (std::size_t i2 = 1; i2 < binnings.size(); i2 += 2) {
+        std::vector<std::vector<float>> limits{binnings[i0], binnings[i1], binnings[i2]};
+        eventmixing::MixingBinning binning;
+        for (const auto& edges : limits) {
+          binning.addAxis(eventmixing::BinningAxis(edges.data(), edges.size()));
+        }
+        for (auto v0 : values[i0]) {
+          for (auto v1 : values[i1]) {
+            for (std::size_t k = 0; k < values[i2].size(); k += 7) {
+              float valueArray[3];
+              valueArray[variables[0]] = v0;
+              valueArray[variables[1]] = v1;
+              valueArray[variables[2]] = values[i2][k];
+              int categoryPrevious = findEventCategoryPrevious(limits, variables, valueArray);
+              int category = binning.getBin(valueArray, variables.data());
+              ++nChecked;
+              if (category != categoryPrevious) {
+                if (nFailed++ < 20) {
+                  printf("FAILED FindEventCategory: binnings %zu, %zu, %zu, values %.9g, %.9g, %.9g: previous %d, MixingBinning %d\n",
+                         i0, i1, i2, v0, v1, values[i2][k], categoryPrevious, category);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Duplicate edges: empty bins [low, low) are skipped as in getMixingBin, unlike the previous FindEventCategory.
+  const std::vector<float> degenerate{0.f, 1.f, 1.f, 2.f};
+  eventmixing::BinningAxis axis(degenerate);
+  ++nChecked;
+  if (axis.findBin(1.f) != 2 || eventmixing::findBin(degenerate, 1.f) != 2 || axis.findBin(0.5f) != 0) {
+    printf("FAILED duplicate edges: %d %d %d\n", axis.findBin(1.f), eventmixing::findBin(degenerate, 1.f), axis.findBin(0.5f));
+    ++nFailed;
+  }
+
+  printf("%ld bin numbers checked, %d different: %s\n", nChecked, nFailed, nFailed ? "FAILED" : "OK");
+  return nFailed ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testPIDBayesFromNSigma.cxx
+/// \brief  Checks that the Bayesian probabilities of pidBayes computed from the Nsigma of the full TPC and TOF tables
+///         (processFromNSigma) agree with the ones computed from the detector responses (processStandard), for random
+///         tracks with both detectors, TPC only and TOF only. The tables are filled with the real TPC and TOF responses,
+///         as pidTPCFull and pidTOFFull without TOF event time do. The probability computations are copies of the members
+///         of bayesPid (ComputeTPCProbability, ComputeTOFProbability, MergeProbabilities, ComputeBayesProbabilities and
+///         ComputeProbabilitiesFromNSigma, without the logging) and have to be kept in sync with them.
+///         Tracks with |Nsigma_TPC| within float rounding of the 5 sigma range are only counted, since the mismatch
+///         decision can differ for them. Returns a non-zero exit code if the probabilities differ by more than the tolerance.
+///
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Common/Core/PID/PIDTOF.h"
+#include "Common/Core/PID/TOFReso.h"
+#include "Common/Core/PID/TPCPIDResponse.h"
+
+using namespace o2::pid;
+using PID = o2::track::PID;
+
+namespace
+{
+constexpr float MaxAbsDiff = 1.e-6f;          // tolerance on the Bayesian probabilities
+constexpr float BoundaryWidth = 1.e-4f;       // width around the 5 sigma range of the tracks only counted
+constexpr double MaxBoundaryFraction = 1.e-3; // maximum fraction of these tracks
+
+struct Collision {
+  float time, timeRes;
+  int mult;
+  float collisionTime() const { return time; }
+  float collisionTimeRes() const { return timeRes; }
+  int multTPC() const { return mult; }
+};
+
+/// Track with the getters used by the TPC and TOF responses
+struct Track {
+  float momentum, tofSignalValue, tofExpMomValue, lengthValue, signal, innerParam, oneOverPt, tanLambda;
+  int16_t nClusters;
+  bool hasTOFValue, hasCollision;
+  Collision collisionValue;
+  float p() const { return momentum; }
+  float tofSignal() const { return tofSignalValue; }
+  float tofExpMom() const { return tofExpMomValue; }
+  float length() const { return lengthValue; }
+  bool hasTOF() const { return hasTOFValue; }
+  bool has_collision() const { return hasCollision; }
+  Collision collision() const { return collisionValue; }
+  int trackType() const { return o2::aod::track::Track; }
+  float tpcSignal() const { return signal; }
+  float tpcInnerParam() const { return innerParam; }
+  int16_t tpcNClsFound() const { return nClusters; }
+  float signed1Pt() const { return oneOverPt; }
+  float tgl() const { return tanLambda; }
+};
+
+using SpeciesArray = std::array<float, PID::NIDs>;
+
+/// Copy of the probability computations of bayesPid
+struct BayesPid {
+  enum ProbType { kTOF, kTPC, kNDet, kPrior, kMerged, kBayesian, kNProb };
+  using ProbabilityArray = std::array<SpeciesArray, kNProb>;
+
+  std::vector<int> enabledSpecies{PID::Electron, PID::Muon, PID::Pion, PID::Kaon, PID::Proton, PID::Deuteron, PID::Triton, PID::Helium3, PID::Alpha};
+  bool enabledDet[kNDet] = {true, true};
+  float fRange = 5.f;
+  float fgTOFmismatchProb = 0.f;
+  float fTOFtail = 0.9;
+  tpc::Response responseTPC;
+  DetectorResponse responseTOF;
+
+  template <PID::ID pid>
+  bool checkEnabled(ProbabilityArray& probability, ProbType detIndex)
+  {
+    if (!enabledDet[detIndex]) {
+      return false;
+    }
+    probability[detIndex][pid] = 1.f / enabledSpecies.size();
+    return true;
+  }
+
+  template <PID::ID pid>
+  void ComputeTPCProbability(ProbabilityArray& probability, const Collision& collision, const Track& track)
+  {
+    if (!checkEnabled<pid>(probability, kTPC)) {
+      return;
+    }
+    const float dedx = track.tpcSignal();
+    bool mismatch = true;
+    const float bethe = responseTPC.GetExpectedSignal(track, pid);
+    const float sigma = responseTPC.GetExpectedSigma(collision, track, pid);
+    if (std::abs(dedx - bethe) > fRange * sigma) {
+      probability[kTPC][pid] = exp(-0.5 * fRange * fRange);
+    } else {
+      probability[kTPC][pid] = exp(-0.5 * (dedx - bethe) * (dedx - bethe) / (sigma * sigma));
+      mismatch = false;
+    }
+    if (probability[kTPC][pid] <= 0.f) {
+      probability[kTPC][pid] = 0.f;
+    }
+    if (mismatch) {
+      probability[kTPC][pid] = 1.f / probability[kTPC].size();
+    }
+  }
+
+  template <PID::ID pid>
+  void ComputeTOFProbability(ProbabilityArray& probability, const Track& track)
+  {
+    if (!checkEnabled<pid>(probability, kTOF)) {
+      return;
+    }
+    if (!track.hasTOF()) {
+      return;
+    }
+    constexpr tof::ExpTimes<Track, pid> responseTOFPID;
+    float mismPropagationFactor[10] = {1., 1., 1., 1., 1., 1., 1., 1., 1., 1.};
+    const float meanCorrFactor = 0.07 / fTOFtail;
+    const float nsigmas = responseTOFPID.GetSeparation(responseTOF, track) + meanCorrFactor;
+    const float sig = responseTOFPID.GetExpectedSigma(responseTOF, track);
+    if (nsigmas < fTOFtail) {
+      probability[kTOF][pid] = exp(-0.5 * nsigmas * nsigmas) / sig;
+    } else {
+      probability[kTOF][pid] = exp(-(nsigmas - fTOFtail * 0.5) * fTOFtail) / sig;
+    }
+    probability[kTOF][pid] += fgTOFmismatchProb * mismPropagationFactor[pid];
+  }
+
+  void MergeProbabilities(ProbabilityArray& probability)
+  {
+    for (const auto enabledPid : enabledSpecies) {
+      probability[kMerged][enabledPid] = 1.f;
+      for (int det = 0; det < kNDet; det++) {
+        probability[kMerged][enabledPid] *= probability[det][enabledPid];
+      }
+    }
+  }
+
+  bool ComputeBayesProbabilities(ProbabilityArray& probability)
+  {
+    float sum = 0.;
+    for (const auto enabledPid : enabledSpecies) {
+      sum += probability[kMerged][enabledPid] * probability[kPrior][enabledPid];
+    }
+    if (sum <= 0) {
+      for (long unsigned int i = 0; i < probability[kBayesian].size(); i++) {
+        probability[kBayesian][i] = 1.f / probability[kBayesian].size();
+      }
+      return false;
+    }
+    for (const auto enabledPid : enabledSpecies) {
+      probability[kBayesian][enabledPid] = probability[kMerged][enabledPid] * probability[kPrior][enabledPid] / sum;
+    }
+    return true;
+  }
+
+  template <std::size_t... Ids>
+  bool ComputeProbabilities(ProbabilityArray& probability, const Collision& collision, const Track& trk, std::index_sequence<Ids...>)
+  {
+    (ComputeTPCProbability<Ids>(probability, collision, trk), ...);
+    (ComputeTOFProbability<Ids>(probability, trk), ...);
+    MergeProbabilities(probability);
+    return ComputeBayesProbabilities(probability);
+  }
+
+  bool ComputeProbabilitiesFromNSigma(ProbabilityArray& probability, const Track& trk, const SpeciesArray& tpcNSigma, const SpeciesArray& tofNSigma, const SpeciesArray& tofExpSigma)
+  {
+    const bool hasTOF = trk.hasTOF();
+    const float flat = 1.f / enabledSpecies.size();
+    const float tpcMismatch = 1.f / probability[kTPC].size();
+    const float meanCorrFactor = 0.07 / fTOFtail;
+
+    float sum = 0.f;
+    for (const auto pid : enabledSpecies) {
+      if (enabledDet[kTPC]) {
+        probability[kTPC][pid] = std::abs(tpcNSigma[pid]) > fRange ? tpcMismatch : std::exp(-0.5f * tpcNSigma[pid] * tpcNSigma[pid]);
+      }
+      if (enabledDet[kTOF]) {
+        const float nsigmas = tofNSigma[pid] + meanCorrFactor;
+        if (hasTOF) {
+          probability[kTOF][pid] = (nsigmas < fTOFtail ? std::exp(-0.5f * nsigmas * nsigmas) : std::exp(-(nsigmas - fTOFtail * 0.5f) * fTOFtail)) / tofExpSigma[pid] + fgTOFmismatchProb;
+        } else {
+          probability[kTOF][pid] = flat;
+        }
+      }
+      probability[kMerged][pid] = probability[kTOF][pid] * probability[kTPC][pid];
+      sum += probability[kMerged][pid] * probability[kPrior][pid];
+    }
+    if (sum <= 0) {
+      probability[kBayesian].fill(1.f / probability[kBayesian].size());
+      return false;
+    }
+    for (const auto pid : enabledSpecies) {
+      probability[kBayesian][pid] = probability[kMerged][pid] * probability[kPrior][pid] / sum;
+    }
+    return true;
+  }
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int nTracks = argc > 1 ? std::atoi(argv[1]) : 500000;
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::normal_distribution<float> gaus(0.f, 1.f);
+
+  BayesPid task;
+  auto* tofReso = new tof::TOFReso;
+  tofReso->SetParameters(std::vector<float>{0.008f, 0.008f, 0.002f, 40.f, 60.f});
+  task.responseTOF.LoadParam(DetectorResponse::kSigma, tofReso);
+
+  long nChecked = 0, nBoundary = 0, nValidityDifferent = 0, nMostProbableDifferent = 0;
+  double maxAbsDiff = 0., maxGapMostProbable = 0.;
+  const char* configurations[3] = {"TPC and TOF", "TPC only", "TOF only"};
+  for (int configuration = 0; configuration < 3; configuration++) {
+    task.enabledDet[BayesPid::kTPC] = configuration != 2;
+    task.enabledDet[BayesPid::kTOF] = configuration != 1;
+    BayesPid::ProbabilityArray probabilityStandard;
+    for (auto& probabilities : probabilityStandard) {
+      probabilities.fill(1.f);
+    }
+    BayesPid::ProbabilityArray probabilityFromNSigma = probabilityStandard;
+    for (int i = 0; i < nTracks; i++) {
+      // signals around the expected ones of a random species, so that the likelihoods are not all negligible
+      const auto id = static_cast<PID::ID>(uniform(generator) * PID::NIDs) % PID::NIDs;
+      Track track{};
+      track.momentum = track.innerParam = track.tofExpMomValue = 0.1f + uniform(generator) * uniform(generator) * 5.f;
+      track.tanLambda = (uniform(generator) - 0.5f) * 2.f;
+      track.oneOverPt = (uniform(generator) - 0.5f) * 20.f;
+      track.nClusters = 60 + static_cast<int16_t>(uniform(generator) * 100);
+      track.collisionValue = Collision{uniform(generator) * 100.f, 10.f + uniform(generator) * 100.f, static_cast<int>(uniform(generator) * 5000)};
+      track.hasCollision = uniform(generator) < 0.98f;
+      track.hasTOFValue = uniform(generator) < 0.7f;
+      track.lengthValue = 350.f + uniform(generator) * 100.f;
+      track.tofSignalValue = track.collisionValue.time * 1000.f + tof::ExpTimes<Track, PID::Electron>::ComputeExpectedTime(track.tofExpMomValue, track.lengthValue, PID::getMass2Z(id)) + (uniform(generator) - 0.5f) * 400.f;
+      track.signal = task.responseTPC.GetExpectedSignal(track, id) * (1.f + 0.07f * gaus(generator));
+
+      // full tables, as filled by pidTPCFull and by pidTOFFull without TOF event time
+      SpeciesArray tpcExpSignal, tpcExpSigma, tpcNSigma, tofExpSigma, tofNSigma;
+      task.responseTPC.GetResponseAllSpecies(track.collisionValue, track, tpcExpSignal, tpcExpSigma, tpcNSigma);
+      if (track.hasCollision) {
+        tof::ExpTimesAllSpecies<Track>::GetResponse(task.responseTOF, track, track.collisionValue.time * 1000.f, track.collisionValue.timeRes * 1000.f, tofExpSigma, tofNSigma);
+      } else {
+        tofExpSigma.fill(tof::defaultReturnValue);
+        tofNSigma.fill(tof::defaultReturnValue);
+      }
+
+      const bool isValidStandard = task.ComputeProbabilities(probabilityStandard, track.collisionValue, track, std::make_index_sequence<PID::NIDs>{});
+      const bool isValidFromNSigma = task.ComputeProbabilitiesFromNSigma(probabilityFromNSigma, track, tpcNSigma, tofNSigma, tofExpSigma);
+      bool isAtBoundary = false;
+      for (int k = 0; k < PID::NIDs; k++) {
+        isAtBoundary |= task.enabledDet[BayesPid::kTPC] && std::abs(std::abs(tpcNSigma[k]) - task.fRange) < BoundaryWidth;
+      }
+      if (isAtBoundary) {
+        ++nBoundary;
+        continue;
+      }
+      ++nChecked;
+      nValidityDifferent += isValidStandard != isValidFromNSigma;
+      const auto& bayesStandard = probabilityStandard[BayesPid::kBayesian];
+      const auto& bayesFromNSigma = probabilityFromNSigma[BayesPid::kBayesian];
+      for (int k = 0; k < PID::NIDs; k++) {
+        maxAbsDiff = std::max(maxAbsDiff, static_cast<double>(std::abs(bayesStandard[k] - bayesFromNSigma[k])));
+      }
+      const auto mostProbableStandard = std::max_element(bayesStandard.begin(), bayesStandard.end()) - bayesStandard.begin();
+      const auto mostProbableFromNSigma = std::max_element(bayesFromNSigma.begin(), bayesFromNSigma.end()) - bayesFromNSigma.begin();
+      if (mostProbableStandard != mostProbableFromNSigma) {
+        ++nMostProbableDifferent;
+        maxGapMostProbable = std::max(maxGapMostProbable, static_cast<double>(std::abs(bayesStandard[mostProbableStandard] - bayesStandard[mostProbableFromNSigma])));
+      }
+    }
+    printf("%s: %d tracks\n", configurations[configuration], nTracks);
+  }
+
+  const double boundaryFraction = static_cast<double>(nBoundary) / (nChecked + nBoundary);
+  const bool isOK = nValidityDifferent == 0 && maxAbsDiff <= MaxAbsDiff && maxGapMostProbable <= MaxAbsDiff && boundaryFraction <= MaxBoundaryFraction;
+  printf("%ld tracks compared, %ld at the 5 sigma range not compared (fraction %.2g)\n", nChecked, nBoundary, boundaryFraction);
+  printf("validity different for %ld tracks, max. abs. difference of the probabilities %.3g (%.3g in the stored percentage)\n",
+         nValidityDifferent, maxAbsDiff, maxAbsDiff * 100.);
+  printf("most probable species different for %ld tracks, max. difference of their probabilities in the standard mode %.3g\n", nMostProbableDifferent, maxGapMostProbable);
+  printf("%s\n", isOK ? "OK" : "FAILED");
+  return isOK ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testPIDParamBatch.cxx
+/// \brief  Checks that the batch evaluation of the PID parametrizations (Parametrization::Evaluate and the batch
+///         operator() of DetectorResponse) is bitwise identical to the evaluation of one input at a time, for TOFReso
+///         (EvaluateBatch) and for a parametrization without batch implementation (default loop over operator()),
+///         on random inputs including non-positive momenta. Compares the timing of the two evaluations.
+///         Returns a non-zero exit code if a value differs.
+///
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common/Core/PID/DetectorResponse.h"
+#include "Common/Core/PID/TOFReso.h"
+
+using namespace o2::pid;
+
+namespace
+{
+/// Parametrization implementing only operator(), as the ones of the users which are not converted
+class ParamWithoutBatch : public Parametrization
+{
+ public:
+  ParamWithoutBatch() : Parametrization("ParamWithoutBatch", 2){};
+  pidvar_t operator()(const pidvar_t* x) const override { return mParameters[0] + mParameters[1] * x[0] * x[0] / (x[1] + x[2] * x[3]); }
+};
+
+struct Check {
+  const char* name;
+  long nDifferent = 0;
+  double timeSingle = 0.;
+  double timeBatch = 0.;
+};
+
+/// Evaluates the parametrization of the response for all the inputs one at a time and in batches of nBatch inputs
+void run(Check& check, const DetectorResponse& response, const std::vector<pidvar_t>& x, int nVariables, int nBatch)
+{
+  const std::size_t n = x.size() / nVariables;
+  std::vector<pidvar_t> ySingle(n), yBatch(n);
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n; i++) {
+    ySingle[i] = response(DetectorResponse::kSigma, x.data() + i * nVariables);
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (std::size_t first = 0; first < n; first += nBatch) {
+    const std::size_t size = std::min<std::size_t>(nBatch, n - first);
+    response(DetectorResponse::kSigma, gsl::span<const pidvar_t>(x.data() + first * nVariables, size * nVariables), gsl::span<pidvar_t>(yBatch.data() + first, size));
+  }
+  auto stop = std::chrono::steady_clock::now();
+  check.timeSingle = std::chrono::duration<double, std::nano>(middle - start).count() / n;
+  check.timeBatch = std::chrono::duration<double, std::nano>(stop - middle).count() / n;
+  for (std::size_t i = 0; i < n; i++) {
+    if (std::memcmp(&ySingle[i], &yBatch[i], sizeof(pidvar_t)) != 0) {
+      if (check.nDifferent++ < 10) {
+        printf("FAILED %s: input %zu: single %a, batch %a\n", check.name, i, ySingle[i], yBatch[i]);
+      }
+    }
+  }
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  constexpr int nVariables = 4; // as in ExpTimes::GetExpectedSigmaVariables: momentum, TOF signal, event time resolution, mass
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::vector<pidvar_t> x(n * nVariables);
+  for (int i = 0; i < n; i++) {
+    x[i * nVariables + 0] = i % 50 == 0 ? -uniform(generator) : 0.05f + uniform(generator) * 5.f;
+    x[i * nVariables + 1] = 10000.f + uniform(generator) * 20000.f;
+    x[i * nVariables + 2] = uniform(generator) * 200.f;
+    x[i * nVariables + 3] = o2::track::PID::getMass2Z(static_cast<o2::track::PID::ID>(i % o2::track::PID::NIDs));
+  }
+
+  // TOFReso with the default parameters of the TOF PID tasks
+  auto* tofReso = new tof::TOFReso;
+  tofReso->SetParameters(std::vector<pidvar_t>{0.008f, 0.008f, 0.002f, 40.f, 60.f});
+  auto* withoutBatch = new ParamWithoutBatch;
+  withoutBatch->SetParameters(std::vector<pidvar_t>{60.f, 2.f});
+
+  std::vector<Check> checks{{"TOFReso, batches of 9"}, {"TOFReso, one batch"}, {"default loop, batches of 9"}};
+  DetectorResponse responseTOFReso;
+  responseTOFReso.LoadParam(DetectorResponse::kSigma, tofReso);
+  DetectorResponse responseWithoutBatch;
+  responseWithoutBatch.LoadParam(DetectorResponse::kSigma, withoutBatch);
+  // batches of the size used for all the species of a track, and the whole input at once
+  run(checks[0], responseTOFReso, x, nVariables, o2::track::PID::NIDs);
+  run(checks[1], responseTOFReso, x, nVariables, n);
+  run(checks[2], responseWithoutBatch, x, nVariables, o2::track::PID::NIDs);
+
+  // empty batch
+  responseTOFReso(DetectorResponse::kSigma, gsl::span<const pidvar_t>(x.data(), 0), gsl::span<pidvar_t>(x.data(), 0));
+
+  long nDifferent = 0;
+  for (const auto& check : checks) {
+    printf("%-28s %ld/%d not bitwise identical, single %.2f ns, batch %.2f ns per input\n", check.name, check.nDifferent, n, check.timeSingle, check.timeBatch);
+    nDifferent += check.nDifferent;
+  }
+  printf("%s\n", nDifferent ? "FAILED" : "OK");
+  return nDifferent ? 1 : 0;
+}
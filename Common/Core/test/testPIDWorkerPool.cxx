@@ -0,0 +1,218 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testPIDWorkerPool.cxx
+/// \brief  Checks that the multi-threaded mode of the PID table producers (nThreads > 1) gives the same results as the
+///         single-threaded one: the responses computed in chunks on the WorkerPool, as in pidTPC and pidTOF, are compared
+///         bitwise with a serial loop, for several numbers of threads and chunk sizes, with the real TPC response
+///         (the tracks split in two segments as around a CCDB update) and TOF response (TOFReso).
+///         The reordered update of the Bayesian probabilities of pidBayes, where invalid tracks overwrite the
+///         probabilities of all the species and valid tracks only the ones of the enabled species, is checked with
+///         a stand-in for the computation of the probabilities.
+///         Returns a non-zero exit code if a result differs.
+///
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Common/Core/WorkerPool.h"
+#include "Common/Core/PID/PIDTOF.h"
+#include "Common/Core/PID/TOFReso.h"
+#include "Common/Core/PID/TPCPIDResponse.h"
+
+namespace
+{
+/// Track with the getters used by the TPC and TOF responses
+struct Track {
+  float signal, innerParam, oneOverPt, tanLambda, momentum, tofSignalValue, tofExpMomValue, lengthValue;
+  int16_t nClusters;
+  bool hasTOFValue;
+  int collisionId;
+  float tpcSignal() const { return signal; }
+  float tpcInnerParam() const { return innerParam; }
+  int16_t tpcNClsFound() const { return nClusters; }
+  float signed1Pt() const { return oneOverPt; }
+  float tgl() const { return tanLambda; }
+  float p() const { return momentum; }
+  float tofSignal() const { return tofSignalValue; }
+  float tofExpMom() const { return tofExpMomValue; }
+  float length() const { return lengthValue; }
+  bool hasTOF() const { return hasTOFValue; }
+  int trackType() const { return o2::aod::track::Track; }
+};
+
+/// Collision with the getters used by the TPC and TOF responses
+struct Collision {
+  int mult;
+  float time, timeRes;
+  int multTPC() const { return mult; }
+};
+
+using SpeciesArray = std::array<float, o2::track::PID::NIDs>;
+
+const std::vector<int> NThreads{1, 2, 3, 4, 8, 16};
+const std::vector<int> ChunkSizes{1, 7, 1000, 100000};
+
+/// Compares the results computed by fill(pool, results, chunkSize) on the worker pools with the serial reference
+template <typename T, typename F>
+int check(const char* name, const std::vector<T>& reference, F&& fill)
+{
+  int nFailed = 0;
+  for (const auto nThreads : NThreads) {
+    WorkerPool pool(nThreads);
+    for (const auto chunkSize : ChunkSizes) {
+      std::vector<T> results(reference.size());
+      auto start = std::chrono::steady_clock::now();
+      fill(pool, results, chunkSize);
+      double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      const bool isSame = std::memcmp(results.data(), reference.data(), reference.size() * sizeof(T)) == 0;
+      nFailed += !isSame;
+      if (chunkSize == 1000 || !isSame) {
+        printf("%s: %2d threads, chunks of %6d tracks: %.1f ms, %s\n", name, nThreads, chunkSize, time, isSame ? "identical" : "FAILED");
+      }
+    }
+  }
+  return nFailed;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int nTracks = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const int nCollisions = 5000;
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::vector<Collision> collisions(nCollisions);
+  for (auto& collision : collisions) {
+    collision = Collision{static_cast<int>(uniform(generator) * 5000), uniform(generator) * 0.1f, uniform(generator) * 0.2f};
+  }
+  std::vector<Track> tracks(nTracks);
+  for (auto& track : tracks) {
+    const float p = 0.05f + uniform(generator) * uniform(generator) * 20.f;
+    track = Track{uniform(generator) * 300.f, p, (uniform(generator) - 0.5f) * 20.f, (uniform(generator) - 0.5f) * 2.f, p,
+                  10000.f + uniform(generator) * 20000.f, p, 300.f + uniform(generator) * 200.f,
+                  static_cast<int16_t>(uniform(generator) * 160), uniform(generator) < 0.7f, static_cast<int>(uniform(generator) * nCollisions)};
+  }
+  int nFailed = 0;
+
+  // TPC: serial reference, then chunks in two segments as around an update of the CCDB object
+  {
+    o2::pid::tpc::Response response;
+    response.SetUseDefaultResolutionParam(false);
+    SpeciesArray expSignal, expSigma;
+    std::vector<SpeciesArray> reference(nTracks);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nTracks; i++) {
+      response.GetResponseAllSpecies(collisions[tracks[i].collisionId], tracks[i], expSignal, expSigma, reference[i]);
+    }
+    printf("TPC: serial %.1f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    const std::size_t segmentEnd = nTracks / 3 + 1;
+    nFailed += check("TPC", reference, [&](WorkerPool& pool, std::vector<SpeciesArray>& nSigma, int chunkSize) {
+      for (const auto& segment : {std::pair<std::size_t, std::size_t>{0, segmentEnd}, {segmentEnd, nTracks}}) {
+        const std::size_t first = segment.first;
+        pool.forEachChunk(segment.second - first, chunkSize, [&](const std::size_t begin, const std::size_t end) {
+          SpeciesArray expSignalChunk, expSigmaChunk;
+          for (std::size_t i = first + begin; i < first + end; i++) {
+            response.GetResponseAllSpecies(collisions[tracks[i].collisionId], tracks[i], expSignalChunk, expSigmaChunk, nSigma[i]);
+          }
+        });
+      }
+    });
+  }
+
+  // TOF without TOF event time, with the default TOFReso parameters
+  {
+    using ResponseAllSpecies = o2::pid::tof::ExpTimesAllSpecies<Track>;
+    auto* tofReso = new o2::pid::tof::TOFReso;
+    tofReso->SetParameters(std::vector<float>{0.008f, 0.008f, 0.002f, 40.f, 60.f});
+    o2::pid::DetectorResponse response;
+    response.LoadParam(o2::pid::DetectorResponse::kSigma, tofReso);
+    auto computeResponse = [&](const Track& track, SpeciesArray& expSigma, SpeciesArray& nSigma) {
+      const auto& collision = collisions[track.collisionId];
+      ResponseAllSpecies::GetResponse(response, track, collision.time * 1000.f, collision.timeRes * 1000.f, expSigma, nSigma);
+    };
+    SpeciesArray expSigma;
+    std::vector<SpeciesArray> reference(nTracks);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nTracks; i++) {
+      computeResponse(tracks[i], expSigma, reference[i]);
+    }
+    printf("TOF: serial %.1f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    nFailed += check("TOF", reference, [&](WorkerPool& pool, std::vector<SpeciesArray>& nSigma, int chunkSize) {
+      pool.forEachChunk(nTracks, chunkSize, [&](const std::size_t begin, const std::size_t end) {
+        SpeciesArray expSigmaChunk;
+        for (std::size_t i = begin; i < end; i++) {
+          computeResponse(tracks[i], expSigmaChunk, nSigma[i]);
+        }
+      });
+    });
+  }
+
+  // Bayes: stand-in for ComputeProbabilities, which keeps the probabilities of the disabled species of the previous
+  // tracks unless the track is invalid. The tables are filled with the probabilities after each track.
+  {
+    const std::vector<int> enabledSpecies{2, 3, 4};
+    auto computeProbabilities = [&](SpeciesArray& probability, const Track& track) {
+      if (track.nClusters < 10) { // invalid: all the species are overwritten
+        probability.fill(track.nClusters * 0.01f);
+        return false;
+      }
+      for (const auto id : enabledSpecies) {
+        probability[id] = std::exp(-0.5f * track.signal / (id + 1.f) / track.innerParam);
+      }
+      return true;
+    };
+    SpeciesArray probability{};
+    std::vector<SpeciesArray> reference(nTracks);
+    for (int i = 0; i < nTracks; i++) {
+      computeProbabilities(probability, tracks[i]);
+      reference[i] = probability;
+    }
+    nFailed += check("Bayes", reference, [&](WorkerPool& pool, std::vector<SpeciesArray>& tables, int chunkSize) {
+      // as bayesPid::processParallel
+      struct TrackProbabilities {
+        bool valid = true;
+        SpeciesArray bayesian{};
+      };
+      const SpeciesArray initial{};
+      std::vector<TrackProbabilities> probabilityBuffer(nTracks);
+      pool.forEachChunk(nTracks, chunkSize, [&](const std::size_t begin, const std::size_t end) {
+        SpeciesArray probabilityChunk = initial;
+        for (std::size_t i = begin; i < end; i++) {
+          probabilityBuffer[i].valid = computeProbabilities(probabilityChunk, tracks[i]);
+          probabilityBuffer[i].bayesian = probabilityChunk;
+        }
+      });
+      SpeciesArray current = initial;
+      for (int i = 0; i < nTracks; i++) {
+        if (probabilityBuffer[i].valid) {
+          for (const auto id : enabledSpecies) {
+            current[id] = probabilityBuffer[i].bayesian[id];
+          }
+        } else {
+          current = probabilityBuffer[i].bayesian;
+        }
+        tables[i] = current;
+      }
+    });
+  }
+
+  printf("%s\n", nFailed ? "FAILED" : "OK");
+  return nFailed ? 1 : 0;
+}
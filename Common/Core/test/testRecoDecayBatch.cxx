@@ -0,0 +1,236 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testRecoDecayBatch.cxx
+/// \brief  Checks that the batch versions of the RecoDecay helpers agree with the scalar ones on random candidates.
+///         Reports the number of results which are not bitwise identical and the maximum differences.
+///         Returns a non-zero exit code if a difference exceeds the tolerance. Differences are possible only if the compiler
+///         contracts multiplications and additions (FMA) differently in the two versions; they are within a few ULP,
+///         except for results close to zero after a cancellation (e.g. CPA), hence the additional absolute tolerance.
+///
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common/Core/RecoDecay.h"
+
+namespace
+{
+constexpr int64_t MaxULP = 4;         // tolerance in ULP
+constexpr double MaxAbsDiff = 1.e-12; // absolute tolerance for results close to zero
+
+int64_t ulpDistance(double a, double b)
+{
+  if ((std::isnan(a) && std::isnan(b)) || a == b) {
+    return 0;
+  }
+  if (std::isnan(a) || std::isnan(b) || std::signbit(a) != std::signbit(b)) {
+    return INT64_MAX;
+  }
+  int64_t ia, ib;
+  std::memcpy(&ia, &a, sizeof(a));
+  std::memcpy(&ib, &b, sizeof(b));
+  return std::abs(ia - ib);
+}
+
+struct Comparison {
+  const char* name;
+  std::size_t nDifferent = 0;
+  int64_t maxULP = 0;
+  double maxAbsDiff = 0.;
+  bool isOK = true;
+  double timeBatch = 0.;
+  double timeScalar = 0.;
+
+  void compare(const std::vector<double>& batch, const std::vector<double>& scalar)
+  {
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+      auto ulp = ulpDistance(batch[i], scalar[i]);
+      if (ulp != 0) {
+        ++nDifferent;
+        maxULP = std::max(maxULP, ulp);
+        auto absDiff = std::abs(batch[i] - scalar[i]);
+        maxAbsDiff = std::max(maxAbsDiff, absDiff);
+        isOK &= ulp <= MaxULP || absDiff <= MaxAbsDiff;
+      }
+    }
+  }
+  bool print(std::size_t n) const
+  {
+    printf("%-26s %zu/%zu not bitwise identical, max. %lld ULP, max. abs. difference %g, batch %.2f ns, scalar %.2f ns per candidate%s\n",
+           name, nDifferent, n, (long long)maxULP, maxAbsDiff, timeBatch / n, timeScalar / n, isOK ? "" : " FAILED");
+    return isOK;
+  }
+};
+
+template <typename F>
+double measure(F&& f)
+{
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::size_t n = argc > 1 ? std::atol(argv[1]) : 1000000;
+  std::mt19937_64 generator(12345);
+  std::normal_distribution<float> gausMom(0.f, 2.f);
+  std::normal_distribution<float> gausPV(0.f, 0.01f);
+  std::normal_distribution<double> gausSV(0., 0.1);
+  std::uniform_real_distribution<float> uniform(0.f, 0.01f);
+
+  // 3-prong candidates with float prong quantities (as in the HF tables) and double secondary vertices
+  array<std::vector<float>, 3> px, py, pz, impPar, errImpPar;
+  std::vector<float> xPV(n), yPV(n), zPV(n), errDecLenXY(n);
+  std::vector<double> xSV(n), ySV(n), zSV(n), pxCand(n), pyCand(n), pzCand(n), length(n);
+  for (int iProng = 0; iProng < 3; ++iProng) {
+    for (auto* vec : {&px[iProng], &py[iProng], &pz[iProng], &impPar[iProng], &errImpPar[iProng]}) {
+      vec->resize(n);
+    }
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    for (int iProng = 0; iProng < 3; ++iProng) {
+      px[iProng][i] = gausMom(generator);
+      py[iProng][i] = gausMom(generator);
+      pz[iProng][i] = gausMom(generator);
+      impPar[iProng][i] = gausPV(generator);
+      errImpPar[iProng][i] = uniform(generator);
+    }
+    xPV[i] = gausPV(generator);
+    yPV[i] = gausPV(generator);
+    zPV[i] = gausPV(generator) * 100.f;
+    xSV[i] = xPV[i] + gausSV(generator);
+    ySV[i] = yPV[i] + gausSV(generator);
+    zSV[i] = zPV[i] + gausSV(generator);
+    errDecLenXY[i] = uniform(generator);
+    pxCand[i] = (double)px[0][i] + px[1][i] + px[2][i];
+    pyCand[i] = (double)py[0][i] + py[1][i] + py[2][i];
+    pzCand[i] = (double)pz[0][i] + pz[1][i] + pz[2][i];
+    length[i] = RecoDecay::distance(array{xPV[i], yPV[i], zPV[i]}, array{xSV[i], ySV[i], zSV[i]});
+  }
+  // edge cases: zero momentum and secondary vertex on the primary vertex
+  if (n > 2) {
+    for (int iProng = 0; iProng < 3; ++iProng) {
+      px[iProng][0] = py[iProng][0] = pz[iProng][0] = 0.f;
+    }
+    pxCand[0] = pyCand[0] = pzCand[0] = 0.;
+    xSV[1] = xPV[1];
+    ySV[1] = yPV[1];
+    zSV[1] = zPV[1];
+  }
+
+  auto spans = [](const array<std::vector<float>, 3>& vecs) {
+    return array<gsl::span<const float>, 3>{gsl::span<const float>(vecs[0]), gsl::span<const float>(vecs[1]), gsl::span<const float>(vecs[2])};
+  };
+  auto span = [](const auto& vec) { return gsl::span<const typename std::decay_t<decltype(vec)>::value_type>(vec); };
+  const array<double, 3> masses{0.938272, 0.493677, 0.13957};
+  std::vector<double> batch(n), scalar(n);
+  std::vector<Comparison> comparisons;
+
+  {
+    Comparison comp{"M2Batch"};
+    comp.timeBatch = measure([&]() { RecoDecay::M2Batch(spans(px), spans(py), spans(pz), masses, gsl::span<double>(batch)); });
+    comp.timeScalar = measure([&]() {
+      for (std::size_t i = 0; i < n; ++i) {
+        scalar[i] = RecoDecay::M2(array{array{px[0][i], py[0][i], pz[0][i]}, array{px[1][i], py[1][i], pz[1][i]}, array{px[2][i], py[2][i], pz[2][i]}}, masses);
+      }
+    });
+    comp.compare(batch, scalar);
+    comparisons.push_back(comp);
+  }
+  {
+    Comparison comp{"MBatch"};
+    comp.timeBatch = measure([&]() { RecoDecay::MBatch(spans(px), spans(py), spans(pz), masses, gsl::span<double>(batch)); });
+    comp.timeScalar = measure([&]() {
+      for (std::size_t i = 0; i < n; ++i) {
+        scalar[i] = RecoDecay::M(array{array{px[0][i], py[0][i], pz[0][i]}, array{px[1][i], py[1][i], pz[1][i]}, array{px[2][i], py[2][i], pz[2][i]}}, masses);
+      }
+    });
+    comp.compare(batch, scalar);
+    comparisons.push_back(comp);
+  }
+  {
+    Comparison comp{"CPABatch"};
+    comp.timeBatch = measure([&]() { RecoDecay::CPABatch(span(xPV), span(yPV), span(zPV), span(xSV), span(ySV), span(zSV), span(pxCand), span(pyCand), span(pzCand), gsl::span<double>(batch)); });
+    comp.timeScalar = measure([&]() {
+      for (std::size_t i = 0; i < n; ++i) {
+        scalar[i] = RecoDecay::CPA(array{xPV[i], yPV[i], zPV[i]}, array{xSV[i], ySV[i], zSV[i]}, array{pxCand[i], pyCand[i], pzCand[i]});
+      }
+    });
+    comp.compare(batch, scalar);
+    comparisons.push_back(comp);
+  }
+  {
+    Comparison comp{"CPAXYBatch"};
+    comp.timeBatch = measure([&]() { RecoDecay::CPAXYBatch(span(xPV), span(yPV), span(xSV), span(ySV), span(pxCand), span(pyCand), gsl::span<double>(batch)); });
+    comp.timeScalar = measure([&]() {
+      for (std::size_t i = 0; i < n; ++i) {
+        scalar[i] = RecoDecay::CPAXY(array{xPV[i], yPV[i]}, array{xSV[i], ySV[i]}, array{pxCand[i], pyCand[i]});
+      }
+    });
+    comp.compare(batch, scalar);
+    comparisons.push_back(comp);
+  }
+  {
+    Comparison comp{"CtBatch"};
+    comp.timeBatch = measure([&]() { RecoDecay::CtBatch(span(pxCand), span(pyCand), span(pzCand), span(length), masses[0], gsl::span<double>(batch)); });
+    comp.timeScalar = measure([&]() {
+      for (std::size_t i = 0; i < n; ++i) {
+        scalar[i] = RecoDecay::Ct(array{pxCand[i], pyCand[i], pzCand[i]}, length[i], masses[0]);
+      }
+    });
+    comp.compare(batch, scalar);
+    comparisons.push_back(comp);
+  }
+  {
+    Comparison comp{"ImpParXYBatch"};
+    comp.timeBatch = measure([&]() { RecoDecay::ImpParXYBatch(span(xPV), span(yPV), span(zPV), span(xSV), span(ySV), span(zSV), span(pxCand), span(pyCand), span(pzCand), gsl::span<double>(batch)); });
+    comp.timeScalar = measure([&]() {
+      for (std::size_t i = 0; i < n; ++i) {
+        scalar[i] = RecoDecay::ImpParXY(array{xPV[i], yPV[i], zPV[i]}, array{xSV[i], ySV[i], zSV[i]}, array{pxCand[i], pyCand[i], pzCand[i]});
+      }
+    });
+    comp.compare(batch, scalar);
+    comparisons.push_back(comp);
+  }
+  {
+    Comparison comp{"maxNormalisedDeltaIPBatch"};
+    comp.timeBatch = measure([&]() {
+      RecoDecay::maxNormalisedDeltaIPBatch(span(xPV), span(yPV), span(xSV), span(ySV), span(errDecLenXY), span(pxCand), span(pyCand),
+                                           spans(impPar), spans(errImpPar), spans(px), spans(py), gsl::span<double>(batch));
+    });
+    comp.timeScalar = measure([&]() {
+      for (std::size_t i = 0; i < n; ++i) {
+        scalar[i] = RecoDecay::maxNormalisedDeltaIP(array{xPV[i], yPV[i]}, array{xSV[i], ySV[i]}, errDecLenXY[i], array{pxCand[i], pyCand[i]},
+                                                    array{impPar[0][i], impPar[1][i], impPar[2][i]}, array{errImpPar[0][i], errImpPar[1][i], errImpPar[2][i]},
+                                                    array{array{px[0][i], py[0][i]}, array{px[1][i], py[1][i]}, array{px[2][i], py[2][i]}});
+      }
+    });
+    comp.compare(batch, scalar);
+    comparisons.push_back(comp);
+  }
+
+  bool isOK = true;
+  for (const auto& comp : comparisons) {
+    isOK &= comp.print(n);
+  }
+  printf("%s\n", isOK ? "OK" : "FAILED");
+  return isOK ? 0 : 1;
+}
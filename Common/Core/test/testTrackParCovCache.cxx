@@ -0,0 +1,247 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testTrackParCovCache.cxx
+/// \brief  Checks TrackParCovCache on mock tables of random tracks: the track parameters and covariances handed out by the
+///         cache filled from the track and covariance columns, and by the cache filled from the rows of aod::TracksParCovCache
+///         written as in the track-parcov-cache task (round trip through fillTrackParCovCacheColumns and
+///         getTrackParCovFromCache), are compared bitwise with getTrackParCov of each track. The global indices of sliced
+///         and filtered tables, which do not start at 0 and have gaps, and empty tables are checked with has and size.
+///         Compares the time of the conversion of the tracks for each pair, as the vertexers did before, with the cache.
+///         Returns a non-zero exit code if a check fails.
+///
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common/Core/TrackParCovCache.h"
+
+namespace
+{
+/// Track with the getters of the track and covariance columns used by getTrackParCov
+struct Track {
+  int64_t index;
+  float xValue, alphaValue, par[5], cov[15];
+  int64_t globalIndex() const { return index; }
+  float x() const { return xValue; }
+  float alpha() const { return alphaValue; }
+  float y() const { return par[0]; }
+  float z() const { return par[1]; }
+  float snp() const { return par[2]; }
+  float tgl() const { return par[3]; }
+  float signed1Pt() const { return par[4]; }
+  float cYY() const { return cov[0]; }
+  float cZY() const { return cov[1]; }
+  float cZZ() const { return cov[2]; }
+  float cSnpY() const { return cov[3]; }
+  float cSnpZ() const { return cov[4]; }
+  float cSnpSnp() const { return cov[5]; }
+  float cTglY() const { return cov[6]; }
+  float cTglZ() const { return cov[7]; }
+  float cTglSnp() const { return cov[8]; }
+  float cTglTgl() const { return cov[9]; }
+  float c1PtY() const { return cov[10]; }
+  float c1PtZ() const { return cov[11]; }
+  float c1PtSnp() const { return cov[12]; }
+  float c1PtTgl() const { return cov[13]; }
+  float c1Pt21Pt2() const { return cov[14]; }
+};
+
+/// Row of aod::TracksParCovCache with the global index of its track
+struct CachedTrack {
+  int64_t index;
+  float refXValue, refAlphaValue, parValue[5], covValue[15], bzValue;
+  int64_t globalIndex() const { return index; }
+  float refX() const { return refXValue; }
+  float refAlpha() const { return refAlphaValue; }
+  const float* par() const { return parValue; }
+  const float* cov() const { return covValue; }
+  float bz() const { return bzValue; }
+};
+
+/// Table of rows, whose iterators are also rows as the ones of the framework tables
+template <typename Row>
+class Table
+{
+ public:
+  class iterator : public Row
+  {
+   public:
+    iterator(const Row* row, const Row* end) : mRow(row), mEnd(end) { load(); }
+    const Row& operator*() const { return *mRow; }
+    iterator& operator++()
+    {
+      ++mRow;
+      load();
+      return *this;
+    }
+    bool operator!=(const iterator& other) const { return mRow != other.mRow; }
+
+   private:
+    void load()
+    {
+      if (mRow != mEnd) {
+        static_cast<Row&>(*this) = *mRow;
+      }
+    }
+    const Row* mRow;
+    const Row* mEnd;
+  };
+
+  std::vector<Row> rows;
+  std::size_t size() const { return rows.size(); }
+  iterator begin() const { return iterator(rows.data(), rows.data() + rows.size()); }
+  iterator end() const { return iterator(rows.data() + rows.size(), rows.data() + rows.size()); }
+};
+
+bool isSame(const o2::track::TrackParCov& a, const o2::track::TrackParCov& b)
+{
+  float parA[5], parB[5];
+  for (int i = 0; i < 5; i++) {
+    parA[i] = a.getParam(i);
+    parB[i] = b.getParam(i);
+  }
+  const float xA = a.getX(), xB = b.getX(), alphaA = a.getAlpha(), alphaB = b.getAlpha();
+  return std::memcmp(&xA, &xB, sizeof(float)) == 0 && std::memcmp(&alphaA, &alphaB, sizeof(float)) == 0 &&
+         std::memcmp(parA, parB, sizeof(parA)) == 0 && std::memcmp(a.getCov().data(), b.getCov().data(), sizeof(float) * 15) == 0;
+}
+
+/// Checks the content of a cache filled with the tracks of the table
+int check(const char* name, const TrackParCovCache& cache, const Table<Track>& tracks, const int64_t firstIndex, const int64_t lastIndex)
+{
+  int nFailed = 0;
+  std::vector<bool> isInTable(lastIndex - firstIndex + 3, false);
+  for (const auto& track : tracks.rows) {
+    isInTable[track.index - firstIndex + 1] = true;
+    if (!cache.has(track.index) || !isSame(cache.get(track.index), getTrackParCov(track))) {
+      if (nFailed++ < 10) {
+        printf("FAILED: %s: track %lld different from getTrackParCov\n", name, static_cast<long long>(track.index));
+      }
+    }
+  }
+  // the indices of the range which are not in the table, and the indices around the range
+  for (int64_t index = firstIndex - 1; index <= lastIndex + 1; index++) {
+    if (!isInTable[index - firstIndex + 1] && cache.has(index)) {
+      if (nFailed++ < 10) {
+        printf("FAILED: %s: track %lld not in the table but in the cache\n", name, static_cast<long long>(index));
+      }
+    }
+  }
+  const std::size_t expectedSize = tracks.size() ? lastIndex - firstIndex + 1 : 0;
+  if (cache.size() != expectedSize) {
+    printf("FAILED: %s: size %zu instead of %zu\n", name, cache.size(), expectedSize);
+    nFailed++;
+  }
+  printf("%s: %zu tracks, global indices %lld to %lld: %s\n", name, tracks.size(), static_cast<long long>(firstIndex), static_cast<long long>(lastIndex), nFailed ? "FAILED" : "OK");
+  return nFailed;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int nTracks = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const float bz = -4.99f;
+  std::mt19937 generator(13);
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+
+  Table<Track> tracks;
+  Table<CachedTrack> cachedTracks;
+  for (int64_t i = 0; i < nTracks; i++) {
+    Track track{i, 80.f * std::abs(uniform(generator)), 3.14f * uniform(generator), {}, {}};
+    for (auto& par : track.par) {
+      par = uniform(generator) * 10.f;
+    }
+    for (auto& cov : track.cov) {
+      cov = uniform(generator) * 1.e-2f;
+    }
+    tracks.rows.push_back(track);
+    // as the track-parcov-cache task, without propagation
+    const auto trackParCov = getTrackParCov(track);
+    CachedTrack cachedTrack{i, trackParCov.getX(), trackParCov.getAlpha(), {}, {}, bz};
+    fillTrackParCovCacheColumns(trackParCov, cachedTrack.parValue, cachedTrack.covValue);
+    cachedTracks.rows.push_back(cachedTrack);
+  }
+  int nFailed = 0;
+
+  // whole table, from the track and covariance columns and from the cache table
+  TrackParCovCache cache;
+  cache.fill(tracks);
+  nFailed += check("whole table", cache, tracks, 0, nTracks - 1);
+  TrackParCovCache cacheFromTable;
+  cacheFromTable.fillFromCache(cachedTracks);
+  nFailed += check("whole table, from TracksParCovCache", cacheFromTable, tracks, 0, nTracks - 1);
+  if (cacheFromTable.getBz() != bz) {
+    printf("FAILED: magnetic field %g kG instead of %g kG\n", cacheFromTable.getBz(), bz);
+    nFailed++;
+  }
+
+  // slice of the tracks of a collision, then filtered with about half of the tracks passing, refilling the same cache
+  const int64_t first = nTracks / 3, last = nTracks / 3 + 999;
+  Table<Track> slice, filtered;
+  Table<CachedTrack> sliceCached, filteredCached;
+  for (int64_t i = first; i <= last; i++) {
+    slice.rows.push_back(tracks.rows[i]);
+    sliceCached.rows.push_back(cachedTracks.rows[i]);
+    if (uniform(generator) > 0.f || i == first || i == last) {
+      filtered.rows.push_back(tracks.rows[i]);
+      filteredCached.rows.push_back(cachedTracks.rows[i]);
+    }
+  }
+  cache.fill(slice);
+  nFailed += check("slice", cache, slice, first, last);
+  cache.fill(filtered);
+  nFailed += check("filtered slice", cache, filtered, first, last);
+  cacheFromTable.fillFromCache(filteredCached);
+  nFailed += check("filtered slice, from TracksParCovCache", cacheFromTable, filtered, first, last);
+
+  // empty table
+  cache.fill(Table<Track>{});
+  if (cache.size() != 0 || cache.has(0) || cache.has(first)) {
+    printf("FAILED: empty table: size %zu\n", cache.size());
+    nFailed++;
+  }
+
+  // pairs of the tracks of the slice, as in the vertexers: conversion of both tracks for each pair or cache
+  {
+    double sum = 0.;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& track0 : slice.rows) {
+      for (const auto& track1 : slice.rows) {
+        const auto trackParCov0 = getTrackParCov(track0);
+        const auto trackParCov1 = getTrackParCov(track1);
+        sum += trackParCov0.getCov()[14] + trackParCov1.getParam(4);
+      }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    cache.fill(slice);
+    for (const auto& track0 : slice.rows) {
+      for (const auto& track1 : slice.rows) {
+        const auto& trackParCov0 = cache.get(track0.index);
+        const auto& trackParCov1 = cache.get(track1.index);
+        sum += trackParCov0.getCov()[14] + trackParCov1.getParam(4);
+      }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    const double nPairs = static_cast<double>(slice.size()) * slice.size();
+    printf("%.0f pairs: conversion per pair %.2f ns, cache %.2f ns per pair (checksum %g)\n", nPairs,
+           std::chrono::duration<double, std::nano>(middle - start).count() / nPairs, std::chrono::duration<double, std::nano>(stop - middle).count() / nPairs, sum);
+  }
+
+  printf("%s\n", nFailed ? "FAILED" : "OK");
+  return nFailed ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file McDecayIndex.h
+/// \brief Per-DF index of the MC decay trees, used to speed up the MC matching of RecoDecay
+///
+/// The index is produced by the mc-decay-index workflow and is joinable with aod::McParticles.
+
+#ifndef O2_ANALYSIS_MCDECAYINDEX_H_
+#define O2_ANALYSIS_MCDECAYINDEX_H_
+
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include "Framework/AnalysisDataModel.h"
+
+namespace o2::aod
+{
+namespace mcdecayindex
+{
+/// PDG codes (absolute values) of the particles which are indexed as ancestors, i.e. the typical mothers looked for in the MC matching
+constexpr std::array<int, 23> PDGIndexedAncestors{
+  310,     // K0S
+  411,     // D+
+  413,     // D*+
+  421,     // D0
+  431,     // Ds+
+  443,     // J/ψ
+  511,     // B0
+  521,     // B+
+  531,     // Bs0
+  3122,    // Λ
+  3312,    // Ξ-
+  3334,    // Ω-
+  4122,    // Λc+
+  4132,    // Ξc0
+  4232,    // Ξc+
+  4332,    // Ωc0
+  4422,    // Ξcc++
+  5122,    // Λb0
+  5132,    // Ξb-
+  5232,    // Ξb0
+  20443,   // χc1
+  100443,  // ψ(2S)
+  9920443  // X(3872)
+};
+
+/// Checks whether ancestors with this PDG code are indexed
+/// \param pdg  PDG code (particle or antiparticle)
+constexpr bool isIndexedAncestor(int pdg)
+{
+  auto absPdg = pdg < 0 ? -pdg : pdg;
+  for (auto code : PDGIndexedAncestors) {
+    if (code == absPdg) {
+      return true;
+    }
+  }
+  return false;
+}
+
+DECLARE_SOA_COLUMN(Depth, depth, int16_t);                         //! Number of generations above the particle (following the first mother)
+DECLARE_SOA_COLUMN(AncestorId, ancestorId, int);                   //! Index of the closest indexed ancestor, -1 if none
+DECLARE_SOA_COLUMN(LastAncestorId, lastAncestorId, int);           //! Index of the most distant indexed ancestor, -1 if none
+DECLARE_SOA_COLUMN(FinalDaughtersBegin, finalDaughtersBegin, int); //! First row of the final-state daughters in McFinalDaughters (indexed particles only, -1 otherwise)
+DECLARE_SOA_COLUMN(FinalDaughtersEnd, finalDaughtersEnd, int);     //! One past the last row of the final-state daughters in McFinalDaughters
+DECLARE_SOA_DYNAMIC_COLUMN(NFinalDaughters, nFinalDaughters,       //! Number of final-state daughters
+                           [](int begin, int end) -> int { return begin < 0 ? 0 : end - begin; });
+DECLARE_SOA_INDEX_COLUMN(McParticle, mcParticle); //! Final-state daughter
+} // namespace mcdecayindex
+
+DECLARE_SOA_TABLE(McDecayIndices, "AOD", "MCDECAYINDEX", //! Decay tree index, joinable with McParticles
+                  mcdecayindex::Depth,
+                  mcdecayindex::AncestorId,
+                  mcdecayindex::LastAncestorId,
+                  mcdecayindex::FinalDaughtersBegin,
+                  mcdecayindex::FinalDaughtersEnd,
+                  mcdecayindex::NFinalDaughters<mcdecayindex::FinalDaughtersBegin, mcdecayindex::FinalDaughtersEnd>);
+using McDecayIndex = McDecayIndices::iterator;
+
+DECLARE_SOA_TABLE(McFinalDaughters, "AOD", "MCFINALDAU", //! Flattened lists of the final-state daughters of the indexed particles
+                  mcdecayindex::McParticleId);
+using McFinalDaughter = McFinalDaughters::iterator;
+
+namespace mcdecayindex
+{
+/// True if the MC particle iterator provides the decay tree index (i.e. McParticles joined with McDecayIndices)
+template <typename P, typename = void>
+struct hasDecayIndex : std::false_type {
+};
+template <typename P>
+struct hasDecayIndex<P, std::void_t<decltype(std::declval<P>().ancestorId()), decltype(std::declval<P>().depth())>> : std::true_type {
+};
+} // namespace mcdecayindex
+} // namespace o2::aod
+
+#endif // O2_ANALYSIS_MCDECAYINDEX_H_
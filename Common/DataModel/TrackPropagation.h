@@ -76,6 +76,22 @@ DECLARE_SOA_TABLE(TracksParPropagated, "AOD", "TRACKPARPROPAG", //! additional t
 using TrackParPropagated = TracksParPropagated::iterator;
 // TODO: replace this table with dynamical columns in the tracksPropagated table
 
+namespace trackparcovcache
+{
+DECLARE_SOA_COLUMN(RefX, refX, float);         //! X of the cached track parameters
+DECLARE_SOA_COLUMN(RefAlpha, refAlpha, float); //! alpha of the cached track parameters
+DECLARE_SOA_COLUMN(Par, par, float[5]);        //! track parameters y, z, snp, tgl, signed 1/pt
+DECLARE_SOA_COLUMN(Cov, cov, float[15]);       //! covariance matrix of the track parameters, in the order of the TrackParCov
+DECLARE_SOA_COLUMN(Bz, bz, float);             //! magnetic field in kG used for the cached parameters
+} // namespace trackparcovcache
+
+DECLARE_SOA_TABLE(TracksParCovCache, "AOD", "TRKPARCOVCACHE", //! track parameters and covariance in the layout of the TrackParCov, for the secondary vertexers
+                  trackparcovcache::RefX, trackparcovcache::RefAlpha,
+                  trackparcovcache::Par, trackparcovcache::Cov,
+                  trackparcovcache::Bz);
+
+using TrackParCovCached = TracksParCovCache::iterator;
+
 } // namespace o2::aod
 
 #endif // O2_ANALYSIS_TRACKPROPAGATION_H_
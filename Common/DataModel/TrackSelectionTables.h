@@ -26,6 +26,22 @@ DECLARE_SOA_COLUMN(DcaZ, dcaZ, float);   //!
 DECLARE_SOA_COLUMN(IsGlobalTrack, isGlobalTrack, uint8_t);       //!
 DECLARE_SOA_COLUMN(IsGlobalTrackSDD, isGlobalTrackSDD, uint8_t); //!
 
+// Bitmask of the track selections evaluated by the track-selection task (see TrackSelectionBatch):
+// for each selection, one bit per TrackSelection::TrackCuts and the overall decision
+namespace trackcutflags
+{
+constexpr int NBitsPerSelection = 16;
+constexpr int SelectedBit = 15;
+// index of the selections filled by the track-selection task
+constexpr int GlobalTrack = 0;
+constexpr int GlobalTrackSDD = 1;
+} // namespace trackcutflags
+DECLARE_SOA_COLUMN(TrackCutFlags, trackCutFlags, uint64_t);          //!
+DECLARE_SOA_DYNAMIC_COLUMN(PassesTrackSelection, passesTrackSelection, //! Passes all cuts of the given selection
+                           [](uint64_t flags, int selection) -> bool { return (flags >> (selection * trackcutflags::NBitsPerSelection + trackcutflags::SelectedBit)) & 1; });
+DECLARE_SOA_DYNAMIC_COLUMN(PassesTrackCut, passesTrackCut, //! Passes the given cut (TrackSelection::TrackCuts) of the given selection
+                           [](uint64_t flags, int selection, int cut) -> bool { return (flags >> (selection * trackcutflags::NBitsPerSelection + cut)) & 1; });
+
 } // namespace track
 DECLARE_SOA_TABLE(TracksExtended, "AOD", "TRACKEXTENDED", //!
                   track::DcaXY,
@@ -34,6 +50,11 @@ DECLARE_SOA_TABLE(TracksExtended, "AOD", "TRACKEXTENDED", //!
 DECLARE_SOA_TABLE(TrackSelection, "AOD", "TRACKSELECTION", //!
                   track::IsGlobalTrack,
                   track::IsGlobalTrackSDD);
+
+DECLARE_SOA_TABLE(TrackSelectionFlags, "AOD", "TRACKSELFLAGS", //!
+                  track::TrackCutFlags,
+                  track::PassesTrackSelection<track::TrackCutFlags>,
+                  track::PassesTrackCut<track::TrackCutFlags>);
 } // namespace o2::aod
 
 #endif // O2_ANALYSIS_TRACKSELECTIONTABLES_H_
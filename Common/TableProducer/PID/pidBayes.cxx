@@ -25,8 +25,11 @@
 #include "Common/Core/PID/PIDResponse.h"
 #include "Common/Core/PID/PIDTOF.h"
 #include "Common/Core/PID/TPCPIDResponse.h"
+#include "Common/Core/CCDBObjectCache.h"
+#include "Common/Core/WorkerPool.h"
 #include "Common/DataModel/Multiplicity.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "Framework/StaticFor.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -72,6 +75,8 @@ struct bayesPid {
   static constexpr const char* detectorName[kNDet] = {"TOF", "TPC"};
   // TPC PID Response
   o2::pid::tpc::Response responseTPC;
+  o2::analysis::CCDBObjectCache<Parametrization> responseCacheTOF;        // owns the TOF parametrization loaded from the CCDB
+  o2::analysis::CCDBObjectCache<o2::pid::tpc::Response> responseCacheTPC; // owns the TPC response loaded from the CCDB
   o2::pid::tpc::Response* responseTPCptr = nullptr;
   Service<o2::ccdb::BasicCCDBManager> ccdb;
   Configurable<std::string> paramfileTOF{"param-file-TOF", "", "Path to the TOF parametrization object, if emtpy the parametrization is not taken from file"};
@@ -87,6 +92,8 @@ struct bayesPid {
   Configurable<std::string> ccdbPathTOF{"ccdbPathTOF", "Analysis/PID/TOF", "Path of the TOF parametrization on the CCDB"};
   Configurable<std::string> ccdbPathTPC{"ccdbPathTPC", "Analysis/PID/TPC/Response", "Path of the TPC parametrization on the CCDB"};
   Configurable<long> timestamp{"ccdb-timestamp", -1, "timestamp of the object"};
+  Configurable<int> nThreads{"nThreads", 1, "Number of threads computing the probabilities, the tracks are processed in chunks on a worker pool if larger than 1"};
+  Configurable<int> chunkSize{"chunkSize", 1024, "Number of tracks per chunk in the multi-threaded mode"};
   // Configuration flags to include and exclude particle hypotheses
   // Configurable<LabeledArray<int>> pid{"pid",
   //                                     {{-1, -1, -1, -1, -1, -1, -1, -1, -1}, 9, {"el", "mu", "pi", "ka", "pr", "de", "tr", "he", "al"}},
@@ -101,12 +108,21 @@ struct bayesPid {
   Configurable<int> pidHe{"pid-he", -1, {"Produce PID information for the Helium3 mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
   Configurable<int> pidAl{"pid-al", -1, {"Produce PID information for the Alpha mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
 
-  std::array<std::array<float, PID::NIDs>, kNProb> Probability; /// Probabilities for all the cases defined in ProbType
-  std::vector<PID::ID> enabledSpecies;                          /// Enabled species
+  using ProbabilityArray = std::array<std::array<float, PID::NIDs>, kNProb>;
+  ProbabilityArray Probability;        /// Probabilities for all the cases defined in ProbType
+  std::vector<PID::ID> enabledSpecies; /// Enabled species
+
+  /// Bayesian probabilities of a track in the multi-threaded mode
+  struct TrackProbabilities {
+    bool valid = true;                       /// False if the probabilities of the track are invalid
+    std::array<float, PID::NIDs> bayesian{}; /// Bayesian probabilities
+  };
+  std::unique_ptr<WorkerPool> workerPool;            /// Only used in the multi-threaded mode
+  std::vector<TrackProbabilities> probabilityBuffer; /// Probabilities of all the tracks in the multi-threaded mode
 
   /// Checker of the species that are enabled and initializer of the probabilities
   template <ProbType detIndex, o2::track::PID::ID pid>
-  bool checkEnabled()
+  bool checkEnabled(ProbabilityArray& probability)
   {
     static_assert(detIndex < kNDet && detIndex >= 0);
     if (!enabledDet[detIndex]) {
@@ -119,7 +135,7 @@ struct bayesPid {
       LOG(debug) << "Testing " << PID::getName(enabledPid) << " " << (int)enabledPid << " vs " << (int)pid;
       if (enabledPid == pid) {
         LOG(debug) << "Particle " << PID::getName(enabledPid) << " enabled";
-        Probability[detIndex][pid] = 1.f / enabledSpecies.size(); // set flat distribution (no decision yet)
+        probability[detIndex][pid] = 1.f / enabledSpecies.size(); // set flat distribution (no decision yet)
         return true;
       }
     }
@@ -212,13 +228,20 @@ struct bayesPid {
     } else { // All ok
       LOG(info) << enabledSpecies.size() << " species enabled for the Bayesian PID computation";
     }
+    if (nThreads.value > 1) {
+      LOGP(info, "Computing the Bayesian probabilities on {} threads in chunks of {} tracks", nThreads.value, chunkSize.value);
+      workerPool = std::make_unique<WorkerPool>(nThreads.value);
+    }
     // Getting the parametrization parameters
-    ccdb->setURL(url.value);
+    // Not later than now objects
+    const long createdNotAfter = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!o2::analysis::isLocalFileUrl(url.value)) {
+      ccdb->setURL(url.value);
+    }
     ccdb->setTimestamp(timestamp.value);
     ccdb->setCaching(true);
     ccdb->setLocalObjectValidityChecking();
-    // Not later than now objects
-    ccdb->setCreatedNotAfter(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    ccdb->setCreatedNotAfter(createdNotAfter);
     //
     const std::vector<float> p = {0.008, 0.008, 0.002, 40.0};
     Response[kTOF].SetParameters(DetectorResponse::kSigma, p);
@@ -230,7 +253,9 @@ struct bayesPid {
     } else { // Loading it from CCDB
       std::string path = ccdbPathTOF.value + "/" + TOFsigmaname.value;
       LOG(info) << "Loading exp. sigma parametrization from CCDB, using path: " << path << " for timestamp " << timestamp.value;
-      Response[kTOF].LoadParam(DetectorResponse::kSigma, ccdb->getForTimeStamp<Parametrization>(path, timestamp.value));
+      responseCacheTOF.init(o2::analysis::getFetcher<Parametrization>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), path,
+                            [this](Parametrization* object) { Response[kTOF].LoadParam(DetectorResponse::kSigma, object); });
+      responseCacheTOF.update(timestamp.value);
     }
     if (fnameTPC != "") { // Loading the parametrization from file
       LOGP(info, "Loading TPC response from file {}", fnameTPC);
@@ -244,7 +269,9 @@ struct bayesPid {
     } else {
       const std::string pathTPC = ccdbPathTPC.value;
       const auto time = timestamp.value;
-      responseTPC.SetParameters(ccdb->getForTimeStamp<o2::pid::tpc::Response>(pathTPC, time));
+      responseCacheTPC.init(o2::analysis::getFetcher<o2::pid::tpc::Response>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), pathTPC,
+                            [this](o2::pid::tpc::Response* object) { responseTPC.SetParameters(object); });
+      responseCacheTPC.update(time);
       LOGP(info, "Loading TPC response from CCDB, using path: {} for timestamp {}", pathTPC, time);
       responseTPC.PrintAll();
     }
@@ -252,10 +279,10 @@ struct bayesPid {
 
   /// Computes PID probabilities for the TPC
   template <o2::track::PID::ID pid>
-  void ComputeTPCProbability(const Coll::iterator& collision, const Trks::iterator& track)
+  void ComputeTPCProbability(ProbabilityArray& probability, const Coll::iterator& collision, const Trks::iterator& track)
   {
 
-    if (!checkEnabled<kTPC, pid>()) {
+    if (!checkEnabled<kTPC, pid>(probability)) {
       return;
     }
 
@@ -273,17 +300,17 @@ struct bayesPid {
 
     if (abs(dedx - bethe) > fRange * sigma) {
       // Probability[kTPC][pid] = exp(-0.5 * fRange * fRange) / sigma; // BUG fix
-      Probability[kTPC][pid] = exp(-0.5 * fRange * fRange);
+      probability[kTPC][pid] = exp(-0.5 * fRange * fRange);
     } else {
       // Probability[kTPC][pid] = exp(-0.5 * (dedx - bethe) * (dedx - bethe) / (sigma * sigma)) / sigma; //BUG fix
-      Probability[kTPC][pid] = exp(-0.5 * (dedx - bethe) * (dedx - bethe) / (sigma * sigma));
+      probability[kTPC][pid] = exp(-0.5 * (dedx - bethe) * (dedx - bethe) / (sigma * sigma));
       mismatch = false;
     }
-    if (Probability[kTPC][pid] <= 0.f) {
-      Probability[kTPC][pid] = 0.f;
+    if (probability[kTPC][pid] <= 0.f) {
+      probability[kTPC][pid] = 0.f;
     }
     if (mismatch) {
-      Probability[kTPC][pid] = 1.f / Probability[kTPC].size();
+      probability[kTPC][pid] = 1.f / probability[kTPC].size();
     }
   }
 
@@ -299,10 +326,10 @@ struct bayesPid {
 
   /// Compute PID probabilities for TOF
   template <o2::track::PID::ID pid>
-  void ComputeTOFProbability(const Trks::iterator& track)
+  void ComputeTOFProbability(ProbabilityArray& probability, const Trks::iterator& track)
   {
 
-    if (!checkEnabled<kTOF, pid>()) {
+    if (!checkEnabled<kTOF, pid>(probability)) {
       return;
     }
 
@@ -363,36 +390,36 @@ struct bayesPid {
     const float sig = responseTOFPID.GetExpectedSigma(Response[kTOF], track);
 
     if (nsigmas < fTOFtail) {
-      Probability[kTOF][pid] = exp(-0.5 * nsigmas * nsigmas) / sig;
+      probability[kTOF][pid] = exp(-0.5 * nsigmas * nsigmas) / sig;
     } else {
-      Probability[kTOF][pid] = exp(-(nsigmas - fTOFtail * 0.5) * fTOFtail) / sig;
+      probability[kTOF][pid] = exp(-(nsigmas - fTOFtail * 0.5) * fTOFtail) / sig;
     }
 
-    Probability[kTOF][pid] += fgTOFmismatchProb * mismPropagationFactor[pid];
-    LOG(debug) << "For " << pid_constants::sNames[pid] << " with signal " << track.tofSignal() << " computing exp time " << expTime << " and sigma " << sig << " and nsigma " << nsigmas << " probability " << Probability[kTOF][pid];
+    probability[kTOF][pid] += fgTOFmismatchProb * mismPropagationFactor[pid];
+    LOG(debug) << "For " << pid_constants::sNames[pid] << " with signal " << track.tofSignal() << " computing exp time " << expTime << " and sigma " << sig << " and nsigma " << nsigmas << " probability " << probability[kTOF][pid];
   }
 
   /// Calculate probabilities from all enabled detectors and species
-  void MergeProbabilities()
+  void MergeProbabilities(ProbabilityArray& probability)
   {
     LOG(debug) << "Merging probabilities";
 
     float probSum[kNDet + 1] = {0.f}; /// Summed probabilities for all detectors + 1 for the sum of all detectors
 
     for (const auto enabledPid : enabledSpecies) {
-      Probability[kMerged][enabledPid] = 1.f;
+      probability[kMerged][enabledPid] = 1.f;
       for (int det = 0; det < kNDet; det++) {
-        probSum[det] += Probability[det][enabledPid];
-        Probability[kMerged][enabledPid] *= Probability[det][enabledPid];
+        probSum[det] += probability[det][enabledPid];
+        probability[kMerged][enabledPid] *= probability[det][enabledPid];
       }
-      probSum[kNDet] += Probability[kMerged][enabledPid];
+      probSum[kNDet] += probability[kMerged][enabledPid];
       LOG(debug) << "For " << PID::getName(enabledPid);
       for (int det = 0; det < kNDet; det++) {
         if (enabledDet[det]) {
-          LOG(debug) << "\t" << detectorName[det] << " Probability " << Probability[det][enabledPid];
+          LOG(debug) << "\t" << detectorName[det] << " Probability " << probability[det][enabledPid];
         }
       }
-      LOG(debug) << "\tCombined: " << Probability[kMerged][enabledPid];
+      LOG(debug) << "\tCombined: " << probability[kMerged][enabledPid];
     }
     for (int det = 0; det < kNDet; det++) {
       if (enabledDet[det]) {
@@ -403,111 +430,234 @@ struct bayesPid {
   }
 
   /// Calculate Bayesian probabilities
-  void ComputeBayesProbabilities()
+  /// \return false if the probabilities are invalid, in which case all the Bayesian probabilities are set to a flat distribution
+  bool ComputeBayesProbabilities(ProbabilityArray& probability)
   {
     LOG(debug) << "Computing bayes probabilities";
 
     float sum = 0.;
     for (const auto enabledPid : enabledSpecies) {
-      LOG(debug) << "Adding " << Probability[kMerged][enabledPid] << " with prior " << Probability[kPrior][enabledPid];
-      sum += Probability[kMerged][enabledPid] * Probability[kPrior][enabledPid];
+      LOG(debug) << "Adding " << probability[kMerged][enabledPid] << " with prior " << probability[kPrior][enabledPid];
+      sum += probability[kMerged][enabledPid] * probability[kPrior][enabledPid];
     }
     if (sum <= 0) {
       LOG(warning) << "Invalid probability densities or prior probabilities";
-      for (long unsigned int i = 0; i < Probability[kBayesian].size(); i++) {
-        Probability[kBayesian][i] = 1.f / Probability[kBayesian].size();
+      for (long unsigned int i = 0; i < probability[kBayesian].size(); i++) {
+        probability[kBayesian][i] = 1.f / probability[kBayesian].size();
       }
-      return;
+      return false;
     }
     for (const auto enabledPid : enabledSpecies) {
-      Probability[kBayesian][enabledPid] = Probability[kMerged][enabledPid] * Probability[kPrior][enabledPid] / sum;
+      probability[kBayesian][enabledPid] = probability[kMerged][enabledPid] * probability[kPrior][enabledPid] / sum;
       // if (probDensityMism) {
       //   probDensityMism[enabledPid] *= Probability[kPrior][enabledPid] / sum;
       // }
-      LOG(debug) << "For " << PID::getName(enabledPid) << " merged prob. " << Probability[kMerged][enabledPid] << " prior " << Probability[kPrior][enabledPid] << " sum " << sum << " bayesian Probability: " << Probability[kBayesian][enabledPid];
+      LOG(debug) << "For " << PID::getName(enabledPid) << " merged prob. " << probability[kMerged][enabledPid] << " prior " << probability[kPrior][enabledPid] << " sum " << sum << " bayesian Probability: " << probability[kBayesian][enabledPid];
     }
+    return true;
   }
 
-  void process(Coll const& collisions, Trks const& tracks)
+  /// Computes the Bayesian probabilities of a track
+  /// \return false if the probabilities are invalid, see ComputeBayesProbabilities
+  bool ComputeProbabilities(ProbabilityArray& probability, const Coll::iterator& collision, const Trks::iterator& trk)
   {
+    ComputeTPCProbability<PID::Electron>(probability, collision, trk);
+    ComputeTPCProbability<PID::Muon>(probability, collision, trk);
+    ComputeTPCProbability<PID::Pion>(probability, collision, trk);
+    ComputeTPCProbability<PID::Kaon>(probability, collision, trk);
+    ComputeTPCProbability<PID::Proton>(probability, collision, trk);
+    ComputeTPCProbability<PID::Deuteron>(probability, collision, trk);
+    ComputeTPCProbability<PID::Triton>(probability, collision, trk);
+    ComputeTPCProbability<PID::Helium3>(probability, collision, trk);
+    ComputeTPCProbability<PID::Alpha>(probability, collision, trk);
+
+    ComputeTOFProbability<PID::Electron>(probability, trk);
+    ComputeTOFProbability<PID::Muon>(probability, trk);
+    ComputeTOFProbability<PID::Pion>(probability, trk);
+    ComputeTOFProbability<PID::Kaon>(probability, trk);
+    ComputeTOFProbability<PID::Proton>(probability, trk);
+    ComputeTOFProbability<PID::Deuteron>(probability, trk);
+    ComputeTOFProbability<PID::Triton>(probability, trk);
+    ComputeTOFProbability<PID::Helium3>(probability, trk);
+    ComputeTOFProbability<PID::Alpha>(probability, trk);
+
+    MergeProbabilities(probability);
+
+    return ComputeBayesProbabilities(probability);
+  }
 
-    // Check and fill enabled tables
-    auto makeTable = [&tracks](const Configurable<int>& flag, auto& table) {
+  /// Computes the Bayesian probabilities of a track from the Nsigma and expected resolution in the full TPC and TOF tables,
+  /// with the same likelihoods as ComputeTPCProbability and ComputeTOFProbability but without evaluating the detector responses
+  /// \return false if the probabilities are invalid, see ComputeBayesProbabilities
+  template <typename TrackType>
+  bool ComputeProbabilitiesFromNSigma(ProbabilityArray& probability, const TrackType& trk)
+  {
+    std::array<float, PID::NIDs> tpcNSigma, tofNSigma, tofExpSigma;
+    static_for<0, PID::NIDs - 1>([&](auto i) {
+      constexpr PID::ID id = i.value;
+      tpcNSigma[id] = o2::aod::pidutils::tpcNSigma<id>(trk);
+      tofNSigma[id] = o2::aod::pidutils::tofNSigma<id>(trk);
+      tofExpSigma[id] = o2::aod::pidutils::tofExpSigma<id>(trk);
+    });
+    const bool hasTOF = trk.hasTOF();
+    const float flat = 1.f / enabledSpecies.size();
+    const float tpcMismatch = 1.f / probability[kTPC].size();
+    const float meanCorrFactor = 0.07 / fTOFtail;
+
+    // Likelihoods, merged probabilities and normalization in one loop over the species
+    float sum = 0.f;
+    for (const auto pid : enabledSpecies) {
+      if (enabledDet[kTPC]) {
+        probability[kTPC][pid] = std::abs(tpcNSigma[pid]) > fRange ? tpcMismatch : std::exp(-0.5f * tpcNSigma[pid] * tpcNSigma[pid]);
+      }
+      if (enabledDet[kTOF]) {
+        const float nsigmas = tofNSigma[pid] + meanCorrFactor;
+        if (hasTOF) {
+          probability[kTOF][pid] = (nsigmas < fTOFtail ? std::exp(-0.5f * nsigmas * nsigmas) : std::exp(-(nsigmas - fTOFtail * 0.5f) * fTOFtail)) / tofExpSigma[pid] + fgTOFmismatchProb;
+        } else {
+          probability[kTOF][pid] = flat;
+        }
+      }
+      probability[kMerged][pid] = probability[kTOF][pid] * probability[kTPC][pid];
+      sum += probability[kMerged][pid] * probability[kPrior][pid];
+    }
+    if (sum <= 0) {
+      LOG(warning) << "Invalid probability densities or prior probabilities";
+      probability[kBayesian].fill(1.f / probability[kBayesian].size());
+      return false;
+    }
+    for (const auto pid : enabledSpecies) {
+      probability[kBayesian][pid] = probability[kMerged][pid] * probability[kPrior][pid] / sum;
+    }
+    return true;
+  }
+
+  /// Prepares the memory of the enabled tables
+  void reserveTables(const int nTracks)
+  {
+    auto reserveTable = [nTracks](const Configurable<int>& flag, auto& table) {
       if (flag.value == 1) {
-        // Prepare memory for enabled tables
-        table.reserve(tracks.size());
+        table.reserve(nTracks);
       }
     };
 
-    tableBayes.reserve(tracks.size());
-    makeTable(pidEl, tablePIDEl);
-    makeTable(pidMu, tablePIDMu);
-    makeTable(pidPi, tablePIDPi);
-    makeTable(pidKa, tablePIDKa);
-    makeTable(pidPr, tablePIDPr);
-    makeTable(pidDe, tablePIDDe);
-    makeTable(pidTr, tablePIDTr);
-    makeTable(pidHe, tablePIDHe);
-    makeTable(pidAl, tablePIDAl);
+    tableBayes.reserve(nTracks);
+    reserveTable(pidEl, tablePIDEl);
+    reserveTable(pidMu, tablePIDMu);
+    reserveTable(pidPi, tablePIDPi);
+    reserveTable(pidKa, tablePIDKa);
+    reserveTable(pidPr, tablePIDPr);
+    reserveTable(pidDe, tablePIDDe);
+    reserveTable(pidTr, tablePIDTr);
+    reserveTable(pidHe, tablePIDHe);
+    reserveTable(pidAl, tablePIDAl);
+  }
 
-    for (auto const& trk : tracks) { // Loop on Tracks
+  /// Fills the enabled tables with the current Bayesian probabilities
+  void fillTables()
+  {
+    if (pidEl == 1) {
+      tablePIDEl(Probability[kBayesian][PID::Electron] * 100.f);
+    }
+    if (pidMu == 1) {
+      tablePIDMu(Probability[kBayesian][PID::Muon] * 100.f);
+    }
+    if (pidPi == 1) {
+      tablePIDPi(Probability[kBayesian][PID::Pion] * 100.f);
+    }
+    if (pidKa == 1) {
+      tablePIDKa(Probability[kBayesian][PID::Kaon] * 100.f);
+    }
+    if (pidPr == 1) {
+      tablePIDPr(Probability[kBayesian][PID::Proton] * 100.f);
+    }
+    if (pidDe == 1) {
+      tablePIDDe(Probability[kBayesian][PID::Deuteron] * 100.f);
+    }
+    if (pidTr == 1) {
+      tablePIDTr(Probability[kBayesian][PID::Triton] * 100.f);
+    }
+    if (pidHe == 1) {
+      tablePIDHe(Probability[kBayesian][PID::Helium3] * 100.f);
+    }
+    if (pidAl == 1) {
+      tablePIDAl(Probability[kBayesian][PID::Alpha] * 100.f);
+    }
+    const auto mostProbable = std::max_element(Probability[kBayesian].begin(), Probability[kBayesian].end());
+    tableBayes((*mostProbable) * 100.f, std::distance(Probability[kBayesian].begin(), mostProbable));
+  }
 
-      auto collision = collisions.iteratorAt(trk.collisionId());
-      ComputeTPCProbability<PID::Electron>(collision, trk);
-      ComputeTPCProbability<PID::Muon>(collision, trk);
-      ComputeTPCProbability<PID::Pion>(collision, trk);
-      ComputeTPCProbability<PID::Kaon>(collision, trk);
-      ComputeTPCProbability<PID::Proton>(collision, trk);
-      ComputeTPCProbability<PID::Deuteron>(collision, trk);
-      ComputeTPCProbability<PID::Triton>(collision, trk);
-      ComputeTPCProbability<PID::Helium3>(collision, trk);
-      ComputeTPCProbability<PID::Alpha>(collision, trk);
-
-      ComputeTOFProbability<PID::Electron>(trk);
-      ComputeTOFProbability<PID::Muon>(trk);
-      ComputeTOFProbability<PID::Pion>(trk);
-      ComputeTOFProbability<PID::Kaon>(trk);
-      ComputeTOFProbability<PID::Proton>(trk);
-      ComputeTOFProbability<PID::Deuteron>(trk);
-      ComputeTOFProbability<PID::Triton>(trk);
-      ComputeTOFProbability<PID::Helium3>(trk);
-      ComputeTOFProbability<PID::Alpha>(trk);
-
-      MergeProbabilities();
-
-      ComputeBayesProbabilities();
-
-      if (pidEl == 1) {
-        tablePIDEl(Probability[kBayesian][PID::Electron] * 100.f);
-      }
-      if (pidMu == 1) {
-        tablePIDMu(Probability[kBayesian][PID::Muon] * 100.f);
-      }
-      if (pidPi == 1) {
-        tablePIDPi(Probability[kBayesian][PID::Pion] * 100.f);
-      }
-      if (pidKa == 1) {
-        tablePIDKa(Probability[kBayesian][PID::Kaon] * 100.f);
-      }
-      if (pidPr == 1) {
-        tablePIDPr(Probability[kBayesian][PID::Proton] * 100.f);
-      }
-      if (pidDe == 1) {
-        tablePIDDe(Probability[kBayesian][PID::Deuteron] * 100.f);
-      }
-      if (pidTr == 1) {
-        tablePIDTr(Probability[kBayesian][PID::Triton] * 100.f);
-      }
-      if (pidHe == 1) {
-        tablePIDHe(Probability[kBayesian][PID::Helium3] * 100.f);
+  /// Fills the tables from the probabilities computed in chunks on the worker pool, in the order of the tracks
+  /// \param computeProbabilities Computes the probabilities of the track with the given index
+  template <typename F>
+  void processParallel(const std::size_t nTracks, F&& computeProbabilities)
+  {
+    probabilityBuffer.resize(nTracks);
+    workerPool->forEachChunk(nTracks, chunkSize.value, [&](const std::size_t begin, const std::size_t end) {
+      ProbabilityArray probability = Probability; // the priors and the probabilities of the disabled detectors and species are not modified
+      for (std::size_t i = begin; i < end; i++) {
+        probabilityBuffer[i].valid = computeProbabilities(probability, i);
+        probabilityBuffer[i].bayesian = probability[kBayesian];
       }
-      if (pidAl == 1) {
-        tablePIDAl(Probability[kBayesian][PID::Alpha] * 100.f);
+    });
+    // The Bayesian probabilities of the disabled species are only changed by the invalid tracks, they are updated in order as in the single-threaded mode
+    for (const auto& trackProbabilities : probabilityBuffer) {
+      if (trackProbabilities.valid) {
+        for (const auto enabledPid : enabledSpecies) {
+          Probability[kBayesian][enabledPid] = trackProbabilities.bayesian[enabledPid];
+        }
+      } else {
+        Probability[kBayesian] = trackProbabilities.bayesian;
       }
-      const auto mostProbable = std::max_element(Probability[kBayesian].begin(), Probability[kBayesian].end());
-      tableBayes((*mostProbable) * 100.f, std::distance(Probability[kBayesian].begin(), mostProbable));
+      fillTables();
+    }
+  }
+
+  void processStandard(Coll const& collisions, Trks const& tracks)
+  {
+    reserveTables(tracks.size());
+
+    if (workerPool) {
+      processParallel(tracks.size(), [&](ProbabilityArray& probability, const std::size_t i) {
+        auto trk = tracks.rawIteratorAt(i);
+        return ComputeProbabilities(probability, collisions.iteratorAt(trk.collisionId()), trk);
+      });
+      return;
+    }
+
+    for (auto const& trk : tracks) { // Loop on Tracks
+      ComputeProbabilities(Probability, collisions.iteratorAt(trk.collisionId()), trk);
+      fillTables();
     }
   }
+
+  PROCESS_SWITCH(bayesPid, processStandard, "Compute the Bayesian PID from the TPC and TOF responses", true);
+
+  using TrksWithNSigma = soa::Join<aod::Tracks, aod::TracksExtra, aod::TOFSignal,
+                                   aod::pidTPCFullEl, aod::pidTPCFullMu, aod::pidTPCFullPi,
+                                   aod::pidTPCFullKa, aod::pidTPCFullPr, aod::pidTPCFullDe,
+                                   aod::pidTPCFullTr, aod::pidTPCFullHe, aod::pidTPCFullAl,
+                                   aod::pidTOFFullEl, aod::pidTOFFullMu, aod::pidTOFFullPi,
+                                   aod::pidTOFFullKa, aod::pidTOFFullPr, aod::pidTOFFullDe,
+                                   aod::pidTOFFullTr, aod::pidTOFFullHe, aod::pidTOFFullAl>;
+  void processFromNSigma(TrksWithNSigma const& tracks)
+  {
+    reserveTables(tracks.size());
+
+    if (workerPool) {
+      processParallel(tracks.size(), [&](ProbabilityArray& probability, const std::size_t i) {
+        return ComputeProbabilitiesFromNSigma(probability, tracks.rawIteratorAt(i));
+      });
+      return;
+    }
+
+    for (auto const& trk : tracks) { // Loop on Tracks
+      ComputeProbabilitiesFromNSigma(Probability, trk);
+      fillTables();
+    }
+  }
+
+  PROCESS_SWITCH(bayesPid, processFromNSigma, "Compute the Bayesian PID from the Nsigma in the full TPC and TOF tables (pidTPCFull and pidTOFFull without TOF event time)", false);
 };
 
 struct bayesPidQa {
@@ -24,6 +24,8 @@
 #include <CCDB/BasicCCDBManager.h>
 #include "Common/Core/PID/PIDResponse.h"
 #include "Common/Core/PID/PIDTOF.h"
+#include "Common/Core/CCDBObjectCache.h"
+#include "Common/Core/WorkerPool.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "Common/DataModel/EventSelection.h"
 #include "TableHelper.h"
@@ -59,12 +61,16 @@ struct tofPid {
   Produces<o2::aod::pidTOFAl> tablePIDAl;
   // Detector response and input parameters
   DetectorResponse response;
+  o2::analysis::CCDBObjectCache<Parametrization> responseCache; // owns the parametrization loaded from the CCDB
   Service<o2::ccdb::BasicCCDBManager> ccdb;
   Configurable<std::string> paramfile{"param-file", "", "Path to the parametrization object, if emtpy the parametrization is not taken from file"};
   Configurable<std::string> sigmaname{"param-sigma", "TOFReso", "Name of the parametrization for the expected sigma, used in both file and CCDB mode"};
   Configurable<std::string> url{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository"};
   Configurable<std::string> ccdbPath{"ccdbPath", "Analysis/PID/TOF", "Path of the TOF parametrization on the CCDB"};
   Configurable<long> timestamp{"ccdb-timestamp", -1, "timestamp of the object"};
+  Configurable<int> nThreads{"nThreads", 1, "Number of threads computing the responses without TOF event time, the tracks are processed in chunks on a worker pool if larger than 1"};
+  Configurable<int> chunkSize{"chunkSize", 1024, "Number of tracks per chunk in the multi-threaded mode"};
+  std::unique_ptr<WorkerPool> workerPool; // only used in the multi-threaded mode
   // Configuration flags to include and exclude particle hypotheses
   Configurable<int> pidEl{"pid-el", -1, {"Produce PID information for the Electron mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
   Configurable<int> pidMu{"pid-mu", -1, {"Produce PID information for the Muon mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
@@ -104,13 +110,21 @@ struct tofPid {
     enableFlag("He", pidHe);
     enableFlag("Al", pidAl);
 
+    if (nThreads.value > 1) {
+      LOGP(info, "Computing the TOF responses on {} threads in chunks of {} tracks", nThreads.value, chunkSize.value);
+      workerPool = std::make_unique<WorkerPool>(nThreads.value);
+    }
+
     // Getting the parametrization parameters
-    ccdb->setURL(url.value);
+    // Not later than now objects
+    const long createdNotAfter = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!o2::analysis::isLocalFileUrl(url.value)) {
+      ccdb->setURL(url.value);
+    }
     ccdb->setTimestamp(timestamp.value);
     ccdb->setCaching(true);
     ccdb->setLocalObjectValidityChecking();
-    // Not later than now objects
-    ccdb->setCreatedNotAfter(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    ccdb->setCreatedNotAfter(createdNotAfter);
     //
     const std::vector<float> p = {0.008, 0.008, 0.002, 40.0};
     response.SetParameters(DetectorResponse::kSigma, p);
@@ -121,24 +135,32 @@ struct tofPid {
     } else { // Loading it from CCDB
       std::string path = ccdbPath.value + "/" + sigmaname.value;
       LOG(info) << "Loading exp. sigma parametrization from CCDB, using path: " << path << " for timestamp " << timestamp.value;
-      response.LoadParam(DetectorResponse::kSigma, ccdb->getForTimeStamp<Parametrization>(path, timestamp.value));
+      responseCache.init(o2::analysis::getFetcher<Parametrization>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), path,
+                         [this](Parametrization* object) { response.LoadParam(DetectorResponse::kSigma, object); });
+      responseCache.update(timestamp.value);
     }
   }
 
   using TrksEvTime = soa::Join<aod::Tracks, aod::TracksExtra, aod::TOFSignal, aod::TrackSelection>;
-  template <o2::track::PID::ID pid>
-  using ResponseImplementationEvTime = o2::pid::tof::ExpTimes<TrksEvTime::iterator, pid>;
+  using ResponseAllSpeciesEvTime = o2::pid::tof::ExpTimesAllSpecies<TrksEvTime::iterator>;
   void processEvTime(TrksEvTime const& tracks, aod::Collisions const&)
   {
-    constexpr auto responseEl = ResponseImplementationEvTime<PID::Electron>();
-    constexpr auto responseMu = ResponseImplementationEvTime<PID::Muon>();
-    constexpr auto responsePi = ResponseImplementationEvTime<PID::Pion>();
-    constexpr auto responseKa = ResponseImplementationEvTime<PID::Kaon>();
-    constexpr auto responsePr = ResponseImplementationEvTime<PID::Proton>();
-    constexpr auto responseDe = ResponseImplementationEvTime<PID::Deuteron>();
-    constexpr auto responseTr = ResponseImplementationEvTime<PID::Triton>();
-    constexpr auto responseHe = ResponseImplementationEvTime<PID::Helium3>();
-    constexpr auto responseAl = ResponseImplementationEvTime<PID::Alpha>();
+    uint32_t speciesMask = 0;
+    auto enableSpecies = [&speciesMask](const Configurable<int>& flag, const o2::track::PID::ID pid) {
+      if (flag.value == 1) {
+        speciesMask |= 1u << pid;
+      }
+    };
+    enableSpecies(pidEl, PID::Electron);
+    enableSpecies(pidMu, PID::Muon);
+    enableSpecies(pidPi, PID::Pion);
+    enableSpecies(pidKa, PID::Kaon);
+    enableSpecies(pidPr, PID::Proton);
+    enableSpecies(pidDe, PID::Deuteron);
+    enableSpecies(pidTr, PID::Triton);
+    enableSpecies(pidHe, PID::Helium3);
+    enableSpecies(pidAl, PID::Alpha);
+    ResponseAllSpeciesEvTime::SpeciesArray expSigma, nSigma;
 
     auto reserveTable = [&tracks](const Configurable<int>& flag, auto& table) {
       if (flag.value != 1) {
@@ -192,79 +214,124 @@ struct tofPid {
       static constexpr bool removebias = true;
       int ngoodtracks = 0;
 
-      // Check and fill enabled tables
-      auto makeTable = [&tracksInCollision, &evTime, &ngoodtracks, this](const Configurable<int>& flag, auto& table, const auto& responsePID) {
-        if (flag.value == 1) {
-          ngoodtracks = 0;
-          // Prepare memory for enabled tables
-          table.reserve(tracksInCollision.size());
-          for (auto const& trk : tracksInCollision) { // Loop on Tracks
-            float et = evTime.mEventTime;
-            float erret = evTime.mEventTimeError;
-            if constexpr (removebias) {
-              evTime.removeBias<TrksEvTime::iterator, filterForTOFEventTime>(trk, ngoodtracks, et, erret);
-            }
-            if (erret > 199.f) {
-              aod::pidutils::packInTable<aod::pidtof_tiny::binning>(-999.f,
-                                                                    table);
-              continue;
-            }
-
-            aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(response, trk, et, erret),
-                                                                  table);
-          }
+      // Fill the enabled tables, in one pass over the tracks for all the species
+      auto makeTable = [&expSigma, &nSigma](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
+        if (flag.value != 1) {
+          return;
         }
+        aod::pidutils::packInTable<aod::pidtof_tiny::binning>(nSigma[pid], table);
       };
 
-      makeTable(pidEl, tablePIDEl, responseEl);
-      makeTable(pidMu, tablePIDMu, responseMu);
-      makeTable(pidPi, tablePIDPi, responsePi);
-      makeTable(pidKa, tablePIDKa, responseKa);
-      makeTable(pidPr, tablePIDPr, responsePr);
-      makeTable(pidDe, tablePIDDe, responseDe);
-      makeTable(pidTr, tablePIDTr, responseTr);
-      makeTable(pidHe, tablePIDHe, responseHe);
-      makeTable(pidAl, tablePIDAl, responseAl);
+      for (auto const& trk : tracksInCollision) { // Loop on Tracks
+        float et = evTime.mEventTime;
+        float erret = evTime.mEventTimeError;
+        if constexpr (removebias) {
+          evTime.removeBias<TrksEvTime::iterator, filterForTOFEventTime>(trk, ngoodtracks, et, erret);
+        }
+        if (erret > 199.f) {
+          nSigma.fill(-999.f);
+        } else {
+          ResponseAllSpeciesEvTime::GetResponse(response, trk, et, erret, expSigma, nSigma, speciesMask);
+        }
+        makeTable(pidEl, tablePIDEl, PID::Electron);
+        makeTable(pidMu, tablePIDMu, PID::Muon);
+        makeTable(pidPi, tablePIDPi, PID::Pion);
+        makeTable(pidKa, tablePIDKa, PID::Kaon);
+        makeTable(pidPr, tablePIDPr, PID::Proton);
+        makeTable(pidDe, tablePIDDe, PID::Deuteron);
+        makeTable(pidTr, tablePIDTr, PID::Triton);
+        makeTable(pidHe, tablePIDHe, PID::Helium3);
+        makeTable(pidAl, tablePIDAl, PID::Alpha);
+      }
     }
   }
 
   PROCESS_SWITCH(tofPid, processEvTime, "Produce TOF response with TOF event time", false);
 
   using Trks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TOFSignal>;
-  template <o2::track::PID::ID pid>
-  using ResponseImplementation = o2::pid::tof::ExpTimes<Trks::iterator, pid>;
+  using ResponseAllSpecies = o2::pid::tof::ExpTimesAllSpecies<Trks::iterator>;
+  std::vector<ResponseAllSpecies::SpeciesArray> nSigmaBuffer; // responses of all the tracks in the multi-threaded mode
   void processNoEvTime(Trks const& tracks, aod::Collisions const&)
   {
-    constexpr auto responseEl = ResponseImplementation<PID::Electron>();
-    constexpr auto responseMu = ResponseImplementation<PID::Muon>();
-    constexpr auto responsePi = ResponseImplementation<PID::Pion>();
-    constexpr auto responseKa = ResponseImplementation<PID::Kaon>();
-    constexpr auto responsePr = ResponseImplementation<PID::Proton>();
-    constexpr auto responseDe = ResponseImplementation<PID::Deuteron>();
-    constexpr auto responseTr = ResponseImplementation<PID::Triton>();
-    constexpr auto responseHe = ResponseImplementation<PID::Helium3>();
-    constexpr auto responseAl = ResponseImplementation<PID::Alpha>();
-
-    // Check and fill enabled tables
-    auto makeTable = [&tracks](const Configurable<int>& flag, auto& table, const DetectorResponse& response, const auto& responsePID) {
+    uint32_t speciesMask = 0;
+    auto enableSpecies = [&speciesMask](const Configurable<int>& flag, const o2::track::PID::ID pid) {
       if (flag.value == 1) {
-        // Prepare memory for enabled tables
-        table.reserve(tracks.size());
-        for (auto const& trk : tracks) { // Loop on Tracks
-          aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(response, trk),
-                                                                table);
-        }
+        speciesMask |= 1u << pid;
+      }
+    };
+    enableSpecies(pidEl, PID::Electron);
+    enableSpecies(pidMu, PID::Muon);
+    enableSpecies(pidPi, PID::Pion);
+    enableSpecies(pidKa, PID::Kaon);
+    enableSpecies(pidPr, PID::Proton);
+    enableSpecies(pidDe, PID::Deuteron);
+    enableSpecies(pidTr, PID::Triton);
+    enableSpecies(pidHe, PID::Helium3);
+    enableSpecies(pidAl, PID::Alpha);
+    ResponseAllSpecies::SpeciesArray expSigma, nSigma;
+
+    auto reserveTable = [&tracks](const Configurable<int>& flag, auto& table) {
+      if (flag.value != 1) {
+        return;
       }
+      table.reserve(tracks.size());
     };
-    makeTable(pidEl, tablePIDEl, response, responseEl);
-    makeTable(pidMu, tablePIDMu, response, responseMu);
-    makeTable(pidPi, tablePIDPi, response, responsePi);
-    makeTable(pidKa, tablePIDKa, response, responseKa);
-    makeTable(pidPr, tablePIDPr, response, responsePr);
-    makeTable(pidDe, tablePIDDe, response, responseDe);
-    makeTable(pidTr, tablePIDTr, response, responseTr);
-    makeTable(pidHe, tablePIDHe, response, responseHe);
-    makeTable(pidAl, tablePIDAl, response, responseAl);
+
+    reserveTable(pidEl, tablePIDEl);
+    reserveTable(pidMu, tablePIDMu);
+    reserveTable(pidPi, tablePIDPi);
+    reserveTable(pidKa, tablePIDKa);
+    reserveTable(pidPr, tablePIDPr);
+    reserveTable(pidDe, tablePIDDe);
+    reserveTable(pidTr, tablePIDTr);
+    reserveTable(pidHe, tablePIDHe);
+    reserveTable(pidAl, tablePIDAl);
+
+    // Fill the enabled tables, in one pass over the tracks for all the species
+    auto makeTable = [](const Configurable<int>& flag, auto& table, const ResponseAllSpecies::SpeciesArray& nSigma, const o2::track::PID::ID pid) {
+      if (flag.value != 1) {
+        return;
+      }
+      aod::pidutils::packInTable<aod::pidtof_tiny::binning>(nSigma[pid], table);
+    };
+    auto makeTables = [&](const ResponseAllSpecies::SpeciesArray& nSigma) {
+      makeTable(pidEl, tablePIDEl, nSigma, PID::Electron);
+      makeTable(pidMu, tablePIDMu, nSigma, PID::Muon);
+      makeTable(pidPi, tablePIDPi, nSigma, PID::Pion);
+      makeTable(pidKa, tablePIDKa, nSigma, PID::Kaon);
+      makeTable(pidPr, tablePIDPr, nSigma, PID::Proton);
+      makeTable(pidDe, tablePIDDe, nSigma, PID::Deuteron);
+      makeTable(pidTr, tablePIDTr, nSigma, PID::Triton);
+      makeTable(pidHe, tablePIDHe, nSigma, PID::Helium3);
+      makeTable(pidAl, tablePIDAl, nSigma, PID::Alpha);
+    };
+    auto computeResponse = [&](const auto& trk, ResponseAllSpecies::SpeciesArray& expSigma, ResponseAllSpecies::SpeciesArray& nSigma) {
+      if (trk.has_collision()) {
+        const auto& collision = trk.collision();
+        ResponseAllSpecies::GetResponse(response, trk, collision.collisionTime() * 1000.f, collision.collisionTimeRes() * 1000.f, expSigma, nSigma, speciesMask);
+      } else {
+        nSigma.fill(o2::pid::tof::defaultReturnValue);
+      }
+    };
+
+    if (workerPool && speciesMask != 0) { // Responses computed in chunks on the worker pool, the tables are filled in the order of the tracks
+      nSigmaBuffer.resize(tracks.size());
+      workerPool->forEachChunk(nSigmaBuffer.size(), chunkSize.value, [&](const std::size_t begin, const std::size_t end) {
+        ResponseAllSpecies::SpeciesArray expSigmaChunk;
+        for (std::size_t i = begin; i < end; i++) {
+          computeResponse(tracks.rawIteratorAt(i), expSigmaChunk, nSigmaBuffer[i]);
+        }
+      });
+      for (const auto& nSigmaTrack : nSigmaBuffer) {
+        makeTables(nSigmaTrack);
+      }
+      return;
+    }
+
+    for (auto const& trk : tracks) { // Loop on Tracks
+      computeResponse(trk, expSigma, nSigma);
+      makeTables(nSigma);
+    }
   }
 
   PROCESS_SWITCH(tofPid, processNoEvTime, "Produce TOF response without TOF event time, standard for Run 2", true);
@@ -24,6 +24,7 @@
 #include <CCDB/BasicCCDBManager.h>
 #include "Common/Core/PID/PIDResponse.h"
 #include "Common/Core/PID/PIDTOF.h"
+#include "Common/Core/CCDBObjectCache.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "Common/DataModel/EventSelection.h"
 #include "TableHelper.h"
@@ -77,6 +78,7 @@ struct tofPidFull {
   Produces<o2::aod::pidTOFFullAl> tablePIDAl;
   // Detector response and input parameters
   DetectorResponse response;
+  o2::analysis::CCDBObjectCache<Parametrization> responseCache; // owns the parametrization loaded from the CCDB
   Service<o2::ccdb::BasicCCDBManager> ccdb;
   Configurable<std::string> paramfile{"param-file", "", "Path to the parametrization object, if emtpy the parametrization is not taken from file"};
   Configurable<std::string> sigmaname{"param-sigma", "TOFReso", "Name of the parametrization for the expected sigma, used in both file and CCDB mode"};
@@ -123,12 +125,15 @@ struct tofPidFull {
     enableFlag("Al", pidAl);
 
     // Getting the parametrization parameters
-    ccdb->setURL(url.value);
+    // Not later than now objects
+    const long createdNotAfter = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!o2::analysis::isLocalFileUrl(url.value)) {
+      ccdb->setURL(url.value);
+    }
     ccdb->setTimestamp(timestamp.value);
     ccdb->setCaching(true);
     ccdb->setLocalObjectValidityChecking();
-    // Not later than now objects
-    ccdb->setCreatedNotAfter(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    ccdb->setCreatedNotAfter(createdNotAfter);
     //
     const std::vector<float> p = {0.008, 0.008, 0.002, 40.0};
     response.SetParameters(DetectorResponse::kSigma, p);
@@ -139,24 +144,32 @@ struct tofPidFull {
     } else { // Loading it from CCDB
       std::string path = ccdbPath.value + "/" + sigmaname.value;
       LOG(info) << "Loading exp. sigma parametrization from CCDB, using path: " << path << " for timestamp " << timestamp.value;
-      response.LoadParam(DetectorResponse::kSigma, ccdb->getForTimeStamp<Parametrization>(path, timestamp.value));
+      responseCache.init(o2::analysis::getFetcher<Parametrization>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), path,
+                         [this](Parametrization* object) { response.LoadParam(DetectorResponse::kSigma, object); });
+      responseCache.update(timestamp.value);
     }
   }
 
   using TrksEvTime = soa::Join<aod::Tracks, aod::TracksExtra, aod::TOFSignal, aod::TrackSelection>;
-  template <o2::track::PID::ID pid>
-  using ResponseImplementationEvTime = o2::pid::tof::ExpTimes<TrksEvTime::iterator, pid>;
+  using ResponseAllSpeciesEvTime = o2::pid::tof::ExpTimesAllSpecies<TrksEvTime::iterator>;
   void processEvTime(TrksEvTime const& tracks, aod::Collisions const&)
   {
-    constexpr auto responseEl = ResponseImplementationEvTime<PID::Electron>();
-    constexpr auto responseMu = ResponseImplementationEvTime<PID::Muon>();
-    constexpr auto responsePi = ResponseImplementationEvTime<PID::Pion>();
-    constexpr auto responseKa = ResponseImplementationEvTime<PID::Kaon>();
-    constexpr auto responsePr = ResponseImplementationEvTime<PID::Proton>();
-    constexpr auto responseDe = ResponseImplementationEvTime<PID::Deuteron>();
-    constexpr auto responseTr = ResponseImplementationEvTime<PID::Triton>();
-    constexpr auto responseHe = ResponseImplementationEvTime<PID::Helium3>();
-    constexpr auto responseAl = ResponseImplementationEvTime<PID::Alpha>();
+    uint32_t speciesMask = 0;
+    auto enableSpecies = [&speciesMask](const Configurable<int>& flag, const o2::track::PID::ID pid) {
+      if (flag.value == 1) {
+        speciesMask |= 1u << pid;
+      }
+    };
+    enableSpecies(pidEl, PID::Electron);
+    enableSpecies(pidMu, PID::Muon);
+    enableSpecies(pidPi, PID::Pion);
+    enableSpecies(pidKa, PID::Kaon);
+    enableSpecies(pidPr, PID::Proton);
+    enableSpecies(pidDe, PID::Deuteron);
+    enableSpecies(pidTr, PID::Triton);
+    enableSpecies(pidHe, PID::Helium3);
+    enableSpecies(pidAl, PID::Alpha);
+    ResponseAllSpeciesEvTime::SpeciesArray expSigma, nSigma;
 
     tableEvTime.reserve(tracks.size());
 
@@ -211,6 +224,15 @@ struct tofPidFull {
       const auto evTime = evTimeMakerForTracks<TrksEvTime::iterator, filterForTOFEventTime, o2::pid::tof::ExpTimes>(tracksInCollision, response);
       static constexpr bool removebias = true;
       int ngoodtracks = 0;
+
+      // Fill the enabled tables, in one pass over the tracks for all the species
+      auto makeTable = [&expSigma, &nSigma](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
+        if (flag.value != 1) {
+          return;
+        }
+        table(expSigma[pid], nSigma[pid]);
+      };
+
       for (auto const& trk : tracksInCollision) { // Loop on Tracks
         float et = evTime.mEventTime;
         float erret = evTime.mEventTimeError;
@@ -218,82 +240,91 @@ struct tofPidFull {
           evTime.removeBias<TrksEvTime::iterator, filterForTOFEventTime>(trk, ngoodtracks, et, erret);
         }
         tableEvTime(et, erret, evTime.mEventTimeMultiplicity);
-      }
-
-      // Check and fill enabled tables
-      auto makeTable = [&tracksInCollision, &evTime, &ngoodtracks, this](const Configurable<int>& flag, auto& table, const auto& responsePID) {
-        if (flag.value == 1) {
-          ngoodtracks = 0;
-          // Prepare memory for enabled tables
-          table.reserve(tracksInCollision.size());
-          for (auto const& trk : tracksInCollision) { // Loop on Tracks
-
-            float et = evTime.mEventTime;
-            float erret = evTime.mEventTimeError;
-            if constexpr (removebias) {
-              evTime.removeBias<TrksEvTime::iterator, filterForTOFEventTime>(trk, ngoodtracks, et, erret);
-            }
-
-            if (erret > 199.f) {
-              table(erret, 999.f);
-              continue;
-            }
-
-            table(responsePID.GetExpectedSigma(response, trk, trk.tofSignal(), erret),
-                  responsePID.GetSeparation(response, trk, et, erret));
-          }
+        if (erret > 199.f) {
+          expSigma.fill(erret);
+          nSigma.fill(999.f);
+        } else {
+          ResponseAllSpeciesEvTime::GetResponse(response, trk, et, erret, expSigma, nSigma, speciesMask);
         }
-      };
-
-      makeTable(pidEl, tablePIDEl, responseEl);
-      makeTable(pidMu, tablePIDMu, responseMu);
-      makeTable(pidPi, tablePIDPi, responsePi);
-      makeTable(pidKa, tablePIDKa, responseKa);
-      makeTable(pidPr, tablePIDPr, responsePr);
-      makeTable(pidDe, tablePIDDe, responseDe);
-      makeTable(pidTr, tablePIDTr, responseTr);
-      makeTable(pidHe, tablePIDHe, responseHe);
-      makeTable(pidAl, tablePIDAl, responseAl);
+        makeTable(pidEl, tablePIDEl, PID::Electron);
+        makeTable(pidMu, tablePIDMu, PID::Muon);
+        makeTable(pidPi, tablePIDPi, PID::Pion);
+        makeTable(pidKa, tablePIDKa, PID::Kaon);
+        makeTable(pidPr, tablePIDPr, PID::Proton);
+        makeTable(pidDe, tablePIDDe, PID::Deuteron);
+        makeTable(pidTr, tablePIDTr, PID::Triton);
+        makeTable(pidHe, tablePIDHe, PID::Helium3);
+        makeTable(pidAl, tablePIDAl, PID::Alpha);
+      }
     }
   }
 
   PROCESS_SWITCH(tofPidFull, processEvTime, "Produce TOF response with TOF event time", false);
 
   using Trks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TOFSignal>;
-  template <o2::track::PID::ID pid>
-  using ResponseImplementation = o2::pid::tof::ExpTimes<Trks::iterator, pid>;
+  using ResponseAllSpecies = o2::pid::tof::ExpTimesAllSpecies<Trks::iterator>;
   void processNoEvTime(Trks const& tracks, aod::Collisions const&)
   {
-    constexpr auto responseEl = ResponseImplementation<PID::Electron>();
-    constexpr auto responseMu = ResponseImplementation<PID::Muon>();
-    constexpr auto responsePi = ResponseImplementation<PID::Pion>();
-    constexpr auto responseKa = ResponseImplementation<PID::Kaon>();
-    constexpr auto responsePr = ResponseImplementation<PID::Proton>();
-    constexpr auto responseDe = ResponseImplementation<PID::Deuteron>();
-    constexpr auto responseTr = ResponseImplementation<PID::Triton>();
-    constexpr auto responseHe = ResponseImplementation<PID::Helium3>();
-    constexpr auto responseAl = ResponseImplementation<PID::Alpha>();
-
-    // Check and fill enabled tables
-    auto makeTable = [&tracks](const Configurable<int>& flag, auto& table, const DetectorResponse& response, const auto& responsePID) {
+    uint32_t speciesMask = 0;
+    auto enableSpecies = [&speciesMask](const Configurable<int>& flag, const o2::track::PID::ID pid) {
       if (flag.value == 1) {
-        // Prepare memory for enabled tables
-        table.reserve(tracks.size());
-        for (auto const& trk : tracks) { // Loop on Tracks
-          table(responsePID.GetExpectedSigma(response, trk),
-                responsePID.GetSeparation(response, trk));
-        }
+        speciesMask |= 1u << pid;
       }
     };
-    makeTable(pidEl, tablePIDEl, response, responseEl);
-    makeTable(pidMu, tablePIDMu, response, responseMu);
-    makeTable(pidPi, tablePIDPi, response, responsePi);
-    makeTable(pidKa, tablePIDKa, response, responseKa);
-    makeTable(pidPr, tablePIDPr, response, responsePr);
-    makeTable(pidDe, tablePIDDe, response, responseDe);
-    makeTable(pidTr, tablePIDTr, response, responseTr);
-    makeTable(pidHe, tablePIDHe, response, responseHe);
-    makeTable(pidAl, tablePIDAl, response, responseAl);
+    enableSpecies(pidEl, PID::Electron);
+    enableSpecies(pidMu, PID::Muon);
+    enableSpecies(pidPi, PID::Pion);
+    enableSpecies(pidKa, PID::Kaon);
+    enableSpecies(pidPr, PID::Proton);
+    enableSpecies(pidDe, PID::Deuteron);
+    enableSpecies(pidTr, PID::Triton);
+    enableSpecies(pidHe, PID::Helium3);
+    enableSpecies(pidAl, PID::Alpha);
+    ResponseAllSpecies::SpeciesArray expSigma, nSigma;
+
+    auto reserveTable = [&tracks](const Configurable<int>& flag, auto& table) {
+      if (flag.value != 1) {
+        return;
+      }
+      table.reserve(tracks.size());
+    };
+
+    reserveTable(pidEl, tablePIDEl);
+    reserveTable(pidMu, tablePIDMu);
+    reserveTable(pidPi, tablePIDPi);
+    reserveTable(pidKa, tablePIDKa);
+    reserveTable(pidPr, tablePIDPr);
+    reserveTable(pidDe, tablePIDDe);
+    reserveTable(pidTr, tablePIDTr);
+    reserveTable(pidHe, tablePIDHe);
+    reserveTable(pidAl, tablePIDAl);
+
+    // Fill the enabled tables, in one pass over the tracks for all the species
+    auto makeTable = [&expSigma, &nSigma](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
+      if (flag.value != 1) {
+        return;
+      }
+      table(expSigma[pid], nSigma[pid]);
+    };
+
+    for (auto const& trk : tracks) { // Loop on Tracks
+      if (trk.has_collision()) {
+        const auto& collision = trk.collision();
+        ResponseAllSpecies::GetResponse(response, trk, collision.collisionTime() * 1000.f, collision.collisionTimeRes() * 1000.f, expSigma, nSigma, speciesMask);
+      } else {
+        expSigma.fill(o2::pid::tof::defaultReturnValue);
+        nSigma.fill(o2::pid::tof::defaultReturnValue);
+      }
+      makeTable(pidEl, tablePIDEl, PID::Electron);
+      makeTable(pidMu, tablePIDMu, PID::Muon);
+      makeTable(pidPi, tablePIDPi, PID::Pion);
+      makeTable(pidKa, tablePIDKa, PID::Kaon);
+      makeTable(pidPr, tablePIDPr, PID::Proton);
+      makeTable(pidDe, tablePIDDe, PID::Deuteron);
+      makeTable(pidTr, tablePIDTr, PID::Triton);
+      makeTable(pidHe, tablePIDHe, PID::Helium3);
+      makeTable(pidAl, tablePIDAl, PID::Alpha);
+    }
   }
 
   PROCESS_SWITCH(tofPidFull, processNoEvTime, "Produce TOF response without TOF event time, standard for Run 2", true);
@@ -27,6 +27,8 @@
 #include <CCDB/BasicCCDBManager.h>
 #include "Common/Core/PID/PIDResponse.h"
 #include "Common/Core/PID/TPCPIDResponse.h"
+#include "Common/Core/CCDBObjectCache.h"
+#include "Common/Core/WorkerPool.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "Framework/AnalysisDataModel.h"
 #include "Common/DataModel/Multiplicity.h"
@@ -65,12 +67,18 @@ struct tpcPid {
   // TPC PID Response
   o2::pid::tpc::Response response;
   o2::pid::tpc::Response* responseptr = nullptr;
+  o2::analysis::CCDBObjectCache<o2::pid::tpc::Response> responseCache; // configures the response only when the timestamp leaves the validity of the CCDB object
+  std::unique_ptr<WorkerPool> workerPool;                         // only used in the multi-threaded mode
+  std::vector<o2::pid::tpc::Response::SpeciesArray> nSigmaBuffer; // responses of all the tracks in the multi-threaded mode
   // Input parameters
   Service<o2::ccdb::BasicCCDBManager> ccdb;
   Configurable<std::string> paramfile{"param-file", "", "Path to the parametrization object, if emtpy the parametrization is not taken from file"};
   Configurable<std::string> url{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository"};
   Configurable<std::string> ccdbPath{"ccdbPath", "Analysis/PID/TPC/Response", "Path of the TPC parametrization on the CCDB"};
   Configurable<long> ccdbTimestamp{"ccdb-timestamp", 0, "timestamp of the object used to query in CCDB the detector response. Exceptions: -1 gets the latest object, 0 gets the run dependent timestamp"};
+  Configurable<float> betheBlochTableMaxRelError{"betheBlochTableMaxRelError", 0.f, "Maximum relative error of the tabulated Bethe-Bloch parametrization used instead of the analytic formula, 0 to use the analytic formula"};
+  Configurable<int> nThreads{"nThreads", 1, "Number of threads computing the responses, the tracks are processed in chunks on a worker pool if larger than 1"};
+  Configurable<int> chunkSize{"chunkSize", 1024, "Number of tracks per chunk in the multi-threaded mode"};
   // Configuration flags to include and exclude particle hypotheses
   Configurable<int> pidEl{"pid-el", -1, {"Produce PID information for the Electron mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
   Configurable<int> pidMu{"pid-mu", -1, {"Produce PID information for the Muon mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
@@ -112,6 +120,13 @@ struct tpcPid {
     enableFlag("He", pidHe);
     enableFlag("Al", pidAl);
 
+    if (nThreads.value > 1) {
+      LOGP(info, "Computing the TPC responses on {} threads in chunks of {} tracks", nThreads.value, chunkSize.value);
+      workerPool = std::make_unique<WorkerPool>(nThreads.value);
+    }
+
+    // The table is built when the parameters are loaded
+    response.SetBetheBlochTable(betheBlochTableMaxRelError.value);
     const TString fname = paramfile.value;
     if (fname != "") { // Loading the parametrization from file
       LOGP(info, "Loading TPC response from file {}", fname);
@@ -126,12 +141,17 @@ struct tpcPid {
       useCCDBParam = true;
       const std::string path = ccdbPath.value;
       const auto time = ccdbTimestamp.value;
-      ccdb->setURL(url.value);
+      const long createdNotAfter = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      if (!o2::analysis::isLocalFileUrl(url.value)) {
+        ccdb->setURL(url.value);
+      }
       ccdb->setTimestamp(time);
       ccdb->setCaching(true);
       ccdb->setLocalObjectValidityChecking();
-      ccdb->setCreatedNotAfter(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
-      response.SetParameters(ccdb->getForTimeStamp<o2::pid::tpc::Response>(path, time));
+      ccdb->setCreatedNotAfter(createdNotAfter);
+      responseCache.init(o2::analysis::getFetcher<o2::pid::tpc::Response>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), path,
+                         [this](o2::pid::tpc::Response* object) { response.SetParameters(object); });
+      responseCache.update(time);
       LOGP(info, "Loading TPC response from CCDB, using path: {} for ccdbTimestamp {}", path, time);
       response.PrintAll();
     }
@@ -156,31 +176,98 @@ struct tpcPid {
     reserveTable(pidTr, tablePIDTr);
     reserveTable(pidHe, tablePIDHe);
     reserveTable(pidAl, tablePIDAl);
+    // The response of all the enabled mass hypotheses is computed at once for each track
+    uint32_t speciesMask = 0;
+    auto enableSpecies = [&speciesMask](const Configurable<int>& flag, const o2::track::PID::ID pid) {
+      if (flag.value != 1) {
+        return;
+      }
+      speciesMask |= 1u << pid;
+    };
+    enableSpecies(pidEl, o2::track::PID::Electron);
+    enableSpecies(pidMu, o2::track::PID::Muon);
+    enableSpecies(pidPi, o2::track::PID::Pion);
+    enableSpecies(pidKa, o2::track::PID::Kaon);
+    enableSpecies(pidPr, o2::track::PID::Proton);
+    enableSpecies(pidDe, o2::track::PID::Deuteron);
+    enableSpecies(pidTr, o2::track::PID::Triton);
+    enableSpecies(pidHe, o2::track::PID::Helium3);
+    enableSpecies(pidAl, o2::track::PID::Alpha);
+    // Check and fill enabled tables
+    auto makeTable = [](const Configurable<int>& flag, auto& table, const o2::pid::tpc::Response::SpeciesArray& nSigma, const o2::track::PID::ID pid) {
+      if (flag.value != 1) {
+        return;
+      }
+
+      aod::pidutils::packInTable<aod::pidtpc_tiny::binning>(nSigma[pid], table);
+    };
+    auto makeTables = [&](const o2::pid::tpc::Response::SpeciesArray& nSigma) {
+      makeTable(pidEl, tablePIDEl, nSigma, o2::track::PID::Electron);
+      makeTable(pidMu, tablePIDMu, nSigma, o2::track::PID::Muon);
+      makeTable(pidPi, tablePIDPi, nSigma, o2::track::PID::Pion);
+      makeTable(pidKa, tablePIDKa, nSigma, o2::track::PID::Kaon);
+      makeTable(pidPr, tablePIDPr, nSigma, o2::track::PID::Proton);
+      makeTable(pidDe, tablePIDDe, nSigma, o2::track::PID::Deuteron);
+      makeTable(pidTr, tablePIDTr, nSigma, o2::track::PID::Triton);
+      makeTable(pidHe, tablePIDHe, nSigma, o2::track::PID::Helium3);
+      makeTable(pidAl, tablePIDAl, nSigma, o2::track::PID::Alpha);
+    };
+    if (workerPool && speciesMask != 0) {
+      processParallel(collisions, tracks, speciesMask, makeTables);
+      return;
+    }
+    o2::pid::tpc::Response::SpeciesArray expSignal, expSigma, nSigma;
     int lastCollisionId = -1;                                                                                        // Last collision ID analysed
     for (auto const& trk : tracks) {                                                                                 // Loop on Tracks
       if (useCCDBParam && ccdbTimestamp.value == 0 && trk.has_collision() && trk.collisionId() != lastCollisionId) { // Updating parametrization only if the initial timestamp is 0
         lastCollisionId = trk.collisionId();
         const auto& bc = collisions.iteratorAt(trk.collisionId()).bc_as<aod::BCsWithTimestamps>();
-        response.SetParameters(ccdb->getForTimeStamp<o2::pid::tpc::Response>(ccdbPath.value, bc.timestamp()));
+        responseCache.update(bc.timestamp());
       }
-      // Check and fill enabled tables
-      auto makeTable = [&trk, &collisions, this](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
-        if (flag.value != 1) {
-          return;
-        }
+      if (speciesMask == 0) {
+        continue;
+      }
+      response.GetResponseAllSpecies(collisions.iteratorAt(trk.collisionId()), trk, expSignal, expSigma, nSigma, speciesMask);
+      makeTables(nSigma);
+    }
+  }
 
-        aod::pidutils::packInTable<aod::pidtpc_tiny::binning>(response.GetNumberOfSigma(collisions.iteratorAt(trk.collisionId()), trk, pid),
-                                                              table);
-      };
-      makeTable(pidEl, tablePIDEl, o2::track::PID::Electron);
-      makeTable(pidMu, tablePIDMu, o2::track::PID::Muon);
-      makeTable(pidPi, tablePIDPi, o2::track::PID::Pion);
-      makeTable(pidKa, tablePIDKa, o2::track::PID::Kaon);
-      makeTable(pidPr, tablePIDPr, o2::track::PID::Proton);
-      makeTable(pidDe, tablePIDDe, o2::track::PID::Deuteron);
-      makeTable(pidTr, tablePIDTr, o2::track::PID::Triton);
-      makeTable(pidHe, tablePIDHe, o2::track::PID::Helium3);
-      makeTable(pidAl, tablePIDAl, o2::track::PID::Alpha);
+  /// Computes the responses of the tracks in chunks on the worker pool and fills the tables in the order of the tracks.
+  /// The tracks are split in segments with the same CCDB object, the response is only updated between two segments.
+  template <typename MakeTables>
+  void processParallel(Coll const& collisions, Trks const& tracks, const uint32_t speciesMask, MakeTables& makeTables)
+  {
+    nSigmaBuffer.resize(tracks.size());
+    auto computeResponses = [&](const std::size_t first, const std::size_t last) {
+      workerPool->forEachChunk(last - first, chunkSize.value, [&](const std::size_t begin, const std::size_t end) {
+        o2::pid::tpc::Response::SpeciesArray expSignal, expSigma;
+        for (std::size_t i = first + begin; i < first + end; i++) {
+          auto trk = tracks.rawIteratorAt(i);
+          response.GetResponseAllSpecies(collisions.iteratorAt(trk.collisionId()), trk, expSignal, expSigma, nSigmaBuffer[i], speciesMask);
+        }
+      });
+    };
+    std::size_t first = 0; // First track of the current segment
+    if (useCCDBParam && ccdbTimestamp.value == 0) {
+      int lastCollisionId = -1;
+      for (std::size_t i = 0; i < nSigmaBuffer.size(); i++) {
+        auto trk = tracks.rawIteratorAt(i);
+        if (!trk.has_collision() || trk.collisionId() == lastCollisionId) {
+          continue;
+        }
+        lastCollisionId = trk.collisionId();
+        const auto timestamp = collisions.iteratorAt(trk.collisionId()).bc_as<aod::BCsWithTimestamps>().timestamp();
+        if (responseCache.getValidity().contains(timestamp)) {
+          continue;
+        }
+        computeResponses(first, i);
+        first = i;
+        responseCache.update(timestamp);
+      }
+    }
+    computeResponses(first, nSigmaBuffer.size());
+    for (std::size_t i = 0; i < nSigmaBuffer.size(); i++) {
+      makeTables(nSigmaBuffer[i]);
     }
   }
 };
@@ -27,6 +27,7 @@
 #include <CCDB/BasicCCDBManager.h>
 #include "Common/Core/PID/PIDResponse.h"
 #include "Common/Core/PID/TPCPIDResponse.h"
+#include "Common/Core/CCDBObjectCache.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "Framework/AnalysisDataModel.h"
 #include "Common/DataModel/Multiplicity.h"
@@ -66,12 +67,14 @@ struct tpcPidFull {
   // TPC PID Response
   o2::pid::tpc::Response response;
   o2::pid::tpc::Response* responseptr = nullptr;
+  o2::analysis::CCDBObjectCache<o2::pid::tpc::Response> responseCache; // configures the response only when the timestamp leaves the validity of the CCDB object
   // Input parameters
   Service<o2::ccdb::BasicCCDBManager> ccdb;
   Configurable<std::string> paramfile{"param-file", "", "Path to the parametrization object, if emtpy the parametrization is not taken from file"};
   Configurable<std::string> url{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository"};
   Configurable<std::string> ccdbPath{"ccdbPath", "Analysis/PID/TPC/Response", "Path of the TPC parametrization on the CCDB"};
   Configurable<long> ccdbTimestamp{"ccdb-timestamp", 0, "timestamp of the object used to query in CCDB the detector response. Exceptions: -1 gets the latest object, 0 gets the run dependent timestamp"};
+  Configurable<float> betheBlochTableMaxRelError{"betheBlochTableMaxRelError", 0.f, "Maximum relative error of the tabulated Bethe-Bloch parametrization used instead of the analytic formula, 0 to use the analytic formula"};
   // Configuration flags to include and exclude particle hypotheses
   Configurable<int> pidEl{"pid-el", -1, {"Produce PID information for the Electron mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
   Configurable<int> pidMu{"pid-mu", -1, {"Produce PID information for the Muon mass hypothesis, overrides the automatic setup: the corresponding table can be set off (0) or on (1)"}};
@@ -113,6 +116,8 @@ struct tpcPidFull {
     enableFlag("He", pidHe);
     enableFlag("Al", pidAl);
 
+    // The table is built when the parameters are loaded
+    response.SetBetheBlochTable(betheBlochTableMaxRelError.value);
     const TString fname = paramfile.value;
     if (fname != "") { // Loading the parametrization from file
       LOGP(info, "Loading TPC response from file {}", fname);
@@ -127,12 +132,17 @@ struct tpcPidFull {
       useCCDBParam = true;
       const std::string path = ccdbPath.value;
       const auto time = ccdbTimestamp.value;
-      ccdb->setURL(url.value);
+      const long createdNotAfter = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      if (!o2::analysis::isLocalFileUrl(url.value)) {
+        ccdb->setURL(url.value);
+      }
       ccdb->setTimestamp(time);
       ccdb->setCaching(true);
       ccdb->setLocalObjectValidityChecking();
-      ccdb->setCreatedNotAfter(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
-      response.SetParameters(ccdb->getForTimeStamp<o2::pid::tpc::Response>(path, time));
+      ccdb->setCreatedNotAfter(createdNotAfter);
+      responseCache.init(o2::analysis::getFetcher<o2::pid::tpc::Response>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), path,
+                         [this](o2::pid::tpc::Response* object) { response.SetParameters(object); });
+      responseCache.update(time);
       LOGP(info, "Loading TPC response from CCDB, using path: {} for ccdbTimestamp {}", path, time);
       response.PrintAll();
     }
@@ -157,20 +167,41 @@ struct tpcPidFull {
     reserveTable(pidTr, tablePIDTr);
     reserveTable(pidHe, tablePIDHe);
     reserveTable(pidAl, tablePIDAl);
+    // The response of all the enabled mass hypotheses is computed at once for each track
+    uint32_t speciesMask = 0;
+    auto enableSpecies = [&speciesMask](const Configurable<int>& flag, const o2::track::PID::ID pid) {
+      if (flag.value != 1) {
+        return;
+      }
+      speciesMask |= 1u << pid;
+    };
+    enableSpecies(pidEl, o2::track::PID::Electron);
+    enableSpecies(pidMu, o2::track::PID::Muon);
+    enableSpecies(pidPi, o2::track::PID::Pion);
+    enableSpecies(pidKa, o2::track::PID::Kaon);
+    enableSpecies(pidPr, o2::track::PID::Proton);
+    enableSpecies(pidDe, o2::track::PID::Deuteron);
+    enableSpecies(pidTr, o2::track::PID::Triton);
+    enableSpecies(pidHe, o2::track::PID::Helium3);
+    enableSpecies(pidAl, o2::track::PID::Alpha);
+    o2::pid::tpc::Response::SpeciesArray expSignal, expSigma, nSigma;
     int lastCollisionId = -1;                                                                                        // Last collision ID analysed
     for (auto const& trk : tracks) {                                                                                 // Loop on Tracks
       if (useCCDBParam && ccdbTimestamp.value == 0 && trk.has_collision() && trk.collisionId() != lastCollisionId) { // Updating parametrization only if the initial timestamp is 0
         lastCollisionId = trk.collisionId();
         const auto& bc = collisions.iteratorAt(trk.collisionId()).bc_as<aod::BCsWithTimestamps>();
-        response.SetParameters(ccdb->getForTimeStamp<o2::pid::tpc::Response>(ccdbPath.value, bc.timestamp()));
+        responseCache.update(bc.timestamp());
+      }
+      if (speciesMask == 0) {
+        continue;
       }
+      response.GetResponseAllSpecies(collisions.iteratorAt(trk.collisionId()), trk, expSignal, expSigma, nSigma, speciesMask);
       // Check and fill enabled tables
-      auto makeTable = [&trk, &collisions, this](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
+      auto makeTable = [&expSigma, &nSigma](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
         if (flag.value != 1) {
           return;
         }
-        table(response.GetExpectedSigma(collisions.iteratorAt(trk.collisionId()), trk, pid),
-              response.GetNumberOfSigma(collisions.iteratorAt(trk.collisionId()), trk, pid));
+        table(expSigma[pid], nSigma[pid]);
       };
       // const o2::pid::tpc::Response& response;
       makeTable(pidEl, tablePIDEl, o2::track::PID::Electron);
@@ -18,6 +18,7 @@
 #include "Framework/RunningWorkflowInfo.h"
 #include "Common/DataModel/Multiplicity.h"
 #include "Common/DataModel/Centrality.h"
+#include "Common/Core/CCDBSnapshot.h"
 #include <CCDB/BasicCCDBManager.h>
 #include <TH1F.h>
 #include <TFormula.h>
@@ -32,13 +33,14 @@ struct CentralityTable {
   Produces<aod::CentRun2CL0s> centRun2CL0;
   Produces<aod::CentRun2CL1s> centRun2CL1;
   Service<o2::ccdb::BasicCCDBManager> ccdb;
+  CCDBSnapshot* snapshot = nullptr; /// Snapshot used instead of the CCDB if the URL is of the form snapshot://<file name>
 
   Configurable<int> estV0M{"estV0M", -1, {"Produces centrality percentiles using V0 multiplicity. -1: auto, 0: don't, 1: yes. Default: auto (-1)"}};
   Configurable<int> estRun2SPDTrklets{"estRun2SPDtks", -1, {"Produces Run2 centrality percentiles using SPD tracklets multiplicity. -1: auto, 0: don't, 1: yes. Default: auto (-1)"}};
   Configurable<int> estRun2SPDClusters{"estRun2SPDcls", -1, {"Produces Run2 centrality percentiles using SPD clusters multiplicity. -1: auto, 0: don't, 1: yes. Default: auto (-1)"}};
   Configurable<int> estRun2CL0{"estRun2CL0", -1, {"Produces Run2 centrality percentiles using CL0 multiplicity. -1: auto, 0: don't, 1: yes. Default: auto (-1)"}};
   Configurable<int> estRun2CL1{"estRun2CL1", -1, {"Produces Run2 centrality percentiles using CL1 multiplicity. -1: auto, 0: don't, 1: yes. Default: auto (-1)"}};
-  Configurable<std::string> ccdbUrl{"ccdburl", "http://alice-ccdb.cern.ch", "The CCDB endpoint url address"};
+  Configurable<std::string> ccdbUrl{"ccdburl", "http://alice-ccdb.cern.ch", "The CCDB endpoint url address, or snapshot://<file name> to use a snapshot written by ccdb-snapshot"};
   Configurable<std::string> ccdbPath{"ccdbpath", "Centrality/Estimators", "The CCDB path for centrality/multiplicity information"};
   Configurable<std::string> genName{"genname", "", "Genearator name: HIJING, PYTHIA8, ... Default: \"\""};
 
@@ -100,9 +102,12 @@ struct CentralityTable {
         enable("Run2CL1", estRun2CL1);
       }
     }
-    ccdb->setURL(ccdbUrl);
-    ccdb->setCaching(true);
-    ccdb->setLocalObjectValidityChecking();
+    snapshot = CCDBSnapshot::fromUrl(ccdbUrl);
+    if (!snapshot) {
+      ccdb->setURL(ccdbUrl);
+      ccdb->setCaching(true);
+      ccdb->setLocalObjectValidityChecking();
+    }
     mRunNumber = 0;
   }
 
@@ -114,7 +119,7 @@ struct CentralityTable {
     auto bc = collision.bc_as<BCsWithTimestampsAndRun2Infos>();
     if (bc.runNumber() != mRunNumber) {
       LOGF(debug, "timestamp=%llu", bc.timestamp());
-      TList* callst = ccdb->getForTimeStamp<TList>(ccdbPath, bc.timestamp());
+      TList* callst = CCDBSnapshot::getObject<TList>(snapshot, ccdb, ccdbPath, bc.timestamp());
 
       V0MInfo.mCalibrationStored = false;
       SPDTksInfo.mCalibrationStored = false;
@@ -19,8 +19,11 @@ using namespace o2::framework;
 #include "Common/DataModel/EventSelection.h"
 #include "Common/CCDB/EventSelectionParams.h"
 #include "Common/CCDB/TriggerAliases.h"
+#include "Common/Core/CCDBObjectCache.h"
 #include <CCDB/BasicCCDBManager.h>
 #include "CommonConstants/LHCConstants.h"
+#include <array>
+#include <chrono>
 
 using namespace evsel;
 
@@ -31,12 +34,27 @@ using BCsWithBcSels = soa::Join<aod::BCs, aod::Timestamps, aod::BcSels>;
 struct BcSelectionTask {
   Produces<aod::BcSels> bcsel;
   Service<o2::ccdb::BasicCCDBManager> ccdb;
+  Configurable<std::string> url{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository, or local://<file name> to read the objects from a local ROOT file standing in for the CCDB"};
+
+  // The CCDB objects are retrieved again only when the BC timestamp leaves their validity interval
+  o2::analysis::CCDBObjectCache<EventSelectionParams> parCache;
+  o2::analysis::CCDBObjectCache<TriggerAliases> aliasesCache;
+  EventSelectionParams* par = nullptr;                // owned by parCache
+  std::array<uint64_t, kNaliases> aliasTriggerMask{}; // trigger classes of each alias
+  std::array<uint64_t, kNaliases> aliasTriggerMaskNext50{};
 
   void init(InitContext&)
   {
-    ccdb->setURL("http://alice-ccdb.cern.ch");
+    if (!o2::analysis::isLocalFileUrl(url.value)) {
+      ccdb->setURL(url.value);
+    }
     ccdb->setCaching(true);
     ccdb->setLocalObjectValidityChecking();
+    const long createdNotAfter = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    parCache.init(o2::analysis::getFetcher<EventSelectionParams>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), "EventSelection/EventSelectionParams",
+                  [this](EventSelectionParams* object) { par = object; });
+    aliasesCache.init(o2::analysis::getFetcher<TriggerAliases>(ccdb->getCCDBAccessor(), url.value, createdNotAfter), "EventSelection/TriggerAliases",
+                      [this](TriggerAliases* object) { object->GetAliasTriggerMasks(aliasTriggerMask, aliasTriggerMaskNext50); });
   }
 
   void processRun2(
@@ -49,17 +67,14 @@ struct BcSelectionTask {
   {
 
     for (auto& bc : bcs) {
-      EventSelectionParams* par = ccdb->getForTimeStamp<EventSelectionParams>("EventSelection/EventSelectionParams", bc.timestamp());
-      TriggerAliases* aliases = ccdb->getForTimeStamp<TriggerAliases>("EventSelection/TriggerAliases", bc.timestamp());
+      parCache.update(bc.timestamp());
+      aliasesCache.update(bc.timestamp());
       // fill fired aliases
       int32_t alias[kNaliases] = {0};
       uint64_t triggerMask = bc.triggerMask();
-      for (auto& al : aliases->GetAliasToTriggerMaskMap()) {
-        alias[al.first] |= (triggerMask & al.second) > 0;
-      }
       uint64_t triggerMaskNext50 = bc.triggerMaskNext50();
-      for (auto& al : aliases->GetAliasToTriggerMaskNext50Map()) {
-        alias[al.first] |= (triggerMaskNext50 & al.second) > 0;
+      for (int i = 0; i < kNaliases; i++) {
+        alias[i] = (triggerMask & aliasTriggerMask[i]) > 0 || (triggerMaskNext50 & aliasTriggerMaskNext50[i]) > 0;
       }
       alias[kALL] = 1;
 
@@ -172,7 +187,7 @@ struct BcSelectionTask {
   {
 
     for (auto& bc : bcs) {
-      EventSelectionParams* par = ccdb->getForTimeStamp<EventSelectionParams>("EventSelection/EventSelectionParams", bc.timestamp());
+      parCache.update(bc.timestamp());
 
       // TODO: fill fired aliases for run3
       int32_t alias[kNaliases] = {0};
@@ -249,18 +264,23 @@ struct EventSelectionTask {
   Partition<aod::Tracks> tracklets = (aod::track::trackType == static_cast<uint8_t>(o2::aod::track::TrackTypeEnum::Run2Tracklet));
 
   Service<o2::ccdb::BasicCCDBManager> ccdb;
+  Configurable<std::string> url{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository, or snapshot://<file name> to use a snapshot written by ccdb-snapshot"};
+  CCDBSnapshot* snapshot = nullptr; /// Snapshot used instead of the CCDB if the URL is of the form snapshot://<file name>
 
   void init(InitContext&)
   {
-    ccdb->setURL("http://alice-ccdb.cern.ch");
-    ccdb->setCaching(true);
-    ccdb->setLocalObjectValidityChecking();
+    snapshot = CCDBSnapshot::fromUrl(url.value);
+    if (!snapshot) {
+      ccdb->setURL(url.value);
+      ccdb->setCaching(true);
+      ccdb->setLocalObjectValidityChecking();
+    }
   }
 
   void processRun2(aod::Collision const& col, BCsWithBcSels const& bcs, aod::Tracks const& tracks)
   {
     auto bc = col.bc_as<BCsWithBcSels>();
-    EventSelectionParams* par = ccdb->getForTimeStamp<EventSelectionParams>("EventSelection/EventSelectionParams", bc.timestamp());
+    EventSelectionParams* par = CCDBSnapshot::getObject<EventSelectionParams>(snapshot, ccdb, "EventSelection/EventSelectionParams", bc.timestamp());
     bool* applySelection = par->GetSelection(muonSelection);
     if (isMC) {
       applySelection[kIsBBZAC] = 0;
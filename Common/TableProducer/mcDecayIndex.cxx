@@ -0,0 +1,125 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file mcDecayIndex.cxx
+/// \brief Builds once per DF an index of the MC decay trees: depth, closest and most distant indexed ancestor
+///        and flattened list of final-state daughters of the indexed particles (see Common/DataModel/McDecayIndex.h).
+///        It is used by the MC matching of RecoDecayMcIndexed (see Common/Core/RecoDecayMcIndexed.h).
+
+#include <vector>
+
+#include "Framework/runDataProcessing.h"
+#include "Framework/AnalysisTask.h"
+#include "Framework/AnalysisDataModel.h"
+#include "Common/DataModel/McDecayIndex.h"
+
+using namespace o2;
+using namespace o2::framework;
+using namespace o2::aod::mcdecayindex;
+
+struct McDecayIndexProducer {
+  Produces<aod::McDecayIndices> decayIndices;
+  Produces<aod::McFinalDaughters> finalDaughters;
+
+  // flat copies of the decay tree links, so that the trees are walked without table iterators
+  std::vector<int> pdg;
+  std::vector<int> mother;
+  std::vector<int> daughterFirst;
+  std::vector<int> daughterLast;
+  // results
+  std::vector<int16_t> depth;
+  std::vector<int> ancestor;
+  std::vector<int> lastAncestor;
+  // work buffers
+  std::vector<int> path;
+  std::vector<int> stack;
+
+  void process(aod::McParticles const& particlesMC)
+  {
+    const int nParticles = particlesMC.size();
+    auto isValid = [nParticles](int index) { return index >= 0 && index < nParticles; };
+
+    pdg.resize(nParticles);
+    mother.resize(nParticles);
+    daughterFirst.resize(nParticles);
+    daughterLast.resize(nParticles);
+    int index = 0;
+    for (auto& particle : particlesMC) {
+      pdg[index] = particle.pdgCode();
+      mother[index] = particle.has_mothers() && isValid(particle.mothersIds().front()) ? particle.mothersIds().front() : -1;
+      daughterFirst[index] = -1;
+      daughterLast[index] = -1;
+      if (particle.has_daughters() && isValid(particle.daughtersIds().front()) && isValid(particle.daughtersIds().back())) {
+        daughterFirst[index] = particle.daughtersIds().front();
+        daughterLast[index] = particle.daughtersIds().back();
+      }
+      ++index;
+    }
+
+    // Depth and ancestors, following the first mother. Each particle is resolved once: the unresolved part of
+    // its mother chain is collected and then resolved from the top.
+    depth.assign(nParticles, -1);
+    ancestor.assign(nParticles, -1);
+    lastAncestor.assign(nParticles, -1);
+    for (int i = 0; i < nParticles; ++i) {
+      path.clear();
+      int j = i;
+      while (j >= 0 && depth[j] < 0 && (int)path.size() <= nParticles) { // the size limit protects against loops
+        path.push_back(j);
+        j = mother[j];
+      }
+      for (auto k = path.rbegin(); k != path.rend(); ++k) {
+        int m = mother[*k];
+        if (m < 0 || depth[m] < 0) {
+          depth[*k] = 0;
+          continue;
+        }
+        depth[*k] = depth[m] + 1;
+        ancestor[*k] = isIndexedAncestor(pdg[m]) ? m : ancestor[m];
+        lastAncestor[*k] = lastAncestor[m] >= 0 ? lastAncestor[m] : (isIndexedAncestor(pdg[m]) ? m : -1);
+      }
+    }
+
+    // Final-state daughters (particles without daughters) of the indexed particles, in decay tree order
+    int row = 0;
+    for (int i = 0; i < nParticles; ++i) {
+      int begin = -1;
+      int end = -1;
+      if (isIndexedAncestor(pdg[i]) && daughterFirst[i] >= 0) {
+        begin = row;
+        stack.clear();
+        for (int d = daughterLast[i]; d >= daughterFirst[i]; --d) {
+          stack.push_back(d);
+        }
+        int nSteps = 0;
+        while (!stack.empty() && nSteps++ < nParticles) { // the step limit protects against loops
+          int k = stack.back();
+          stack.pop_back();
+          if (daughterFirst[k] < 0) {
+            finalDaughters(k);
+            ++row;
+            continue;
+          }
+          for (int d = daughterLast[k]; d >= daughterFirst[k]; --d) {
+            stack.push_back(d);
+          }
+        }
+        end = row;
+      }
+      decayIndices(depth[i], ancestor[i], lastAncestor[i], begin, end);
+    }
+  }
+};
+
+WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
+{
+  return WorkflowSpec{adaptAnalysisTask<McDecayIndexProducer>(cfgc, TaskName{"mc-decay-index"})};
+}
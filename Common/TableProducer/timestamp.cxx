@@ -22,7 +22,11 @@
 #include <CCDB/BasicCCDBManager.h>
 #include "CommonDataFormat/InteractionRecord.h"
 #include "DetectorsRaw/HBFUtils.h"
+#include "Common/Core/CCDBSnapshot.h"
+#include "Common/Core/BCTimestamps.h"
 #include <map>
+#include <set>
+#include <vector>
 
 using namespace o2::framework;
 using namespace o2::header;
@@ -32,6 +36,7 @@ struct TimestampTask {
   Produces<aod::Timestamps> timestampTable;    /// Table with SOR timestamps produced by the task
   Service<o2::ccdb::BasicCCDBManager> ccdb;    /// Object manager in CCDB
   o2::ccdb::CcdbApi ccdb_api;                  /// API to access CCDB
+  CCDBSnapshot* snapshot = nullptr;            /// Snapshot used instead of the CCDB if the URL is of the form snapshot://<file name>
   std::map<int, int>* mapStartOrbit = nullptr; /// Map of the starting orbit for the run
   std::map<int, long> mapRunToTimestamp;       /// Cache of processed run numbers
   int lastRunNumber = 0;                       /// Last run number processed
@@ -39,20 +44,34 @@ struct TimestampTask {
   uint32_t initialOrbit = 0;                   /// Index of the first orbit of the run number, used in the process function to evaluate the offset with respect to the starting of the run
   static constexpr uint16_t initialBC = 0;     /// Index of the initial bc, exact bc number not relevant due to ms precision of timestamps
   InteractionRecord initialIR;                 /// Initial interaction record, used to compute the delta with respect to the start of the run
+  std::vector<uint64_t> globalBCs;             /// Buffer of the global BCs of the BC table, used in the table mode
+  std::vector<int> runNumbers;                 /// Buffer of the run numbers of the BC table, used in the table mode
+  std::vector<uint64_t> timestamps;            /// Buffer of the timestamps of the BC table, used in the table mode
 
   // Configurables
   Configurable<bool> verbose{"verbose", false, "verbose mode"};
   Configurable<std::string> rct_path{"rct-path", "RCT/RunInformation", "path to the ccdb RCT objects for the SOR timestamps"};
   Configurable<std::string> start_orbit_path{"start-orbit-path", "GRP/StartOrbit", "path to the ccdb SOR orbit objects"};
-  Configurable<std::string> url{"ccdb-url", "http://alice-ccdb.cern.ch", "URL of the CCDB database"};
+  Configurable<std::string> url{"ccdb-url", "http://alice-ccdb.cern.ch", "URL of the CCDB database, or snapshot://<file name> to use a snapshot written by ccdb-snapshot"};
   Configurable<bool> isRun2MC{"isRun2MC", false, "Running mode: enable only for Run 2 MC. The timestamp of the BC is computed from initialBC and initialOrbit and does not use the global BC."};
 
   void init(o2::framework::InitContext&)
   {
     LOGF(info, "Initializing TimestampTask");
+    if (doprocessBC && doprocessTable) {
+      LOGF(fatal, "Cannot enable processBC and processTable at the same time, they fill the same table");
+    }
+    snapshot = CCDBSnapshot::fromUrl(url.value);
+    if (snapshot) { // Network-free running from the snapshot
+      mapStartOrbit = snapshot->get<std::map<int, int>>(start_orbit_path.value);
+      if (!mapStartOrbit) {
+        LOGF(fatal, "Cannot find map of SOR orbits in CCDB snapshot %s in path %s", snapshot->getFileName().data(), start_orbit_path.value.data());
+      }
+      return;
+    }
     ccdb->setURL(url.value); // Setting URL of CCDB manager from configuration
     LOGF(debug, "Getting SOR orbit map from CCDB url '%s' path '%s'", url.value, start_orbit_path.value);
-    mapStartOrbit = ccdb->get<std::map<int, int>>(start_orbit_path.value);
+    mapStartOrbit = CCDBSnapshot::getObject<std::map<int, int>>(nullptr, ccdb, start_orbit_path.value);
     if (!mapStartOrbit) {
       LOGF(fatal, "Cannot find map of SOR orbits in CCDB in path %s", start_orbit_path.value.data());
     }
@@ -62,35 +81,39 @@ struct TimestampTask {
     }
   }
 
-  void makeInitialOrbit(aod::BC const& bunchCrossing)
+  void makeInitialOrbit(const int runNumber)
   {
-    if (!mapStartOrbit->count(bunchCrossing.runNumber())) {
-      LOGF(fatal, "Cannot find run %i in mapStartOrbit map", bunchCrossing.runNumber());
+    if (!mapStartOrbit->count(runNumber)) {
+      LOGF(fatal, "Cannot find run %i in mapStartOrbit map", runNumber);
     }
-    initialOrbit = mapStartOrbit->at(bunchCrossing.runNumber());
+    initialOrbit = mapStartOrbit->at(runNumber);
     initialIR.bc = initialBC;
     initialIR.orbit = initialOrbit;
     // Setting lastCall
-    LOGF(debug, "Setting the last call of the timestamp for run %i to %llu", bunchCrossing.runNumber(), runNumberTimeStamp);
-    lastRunNumber = bunchCrossing.runNumber(); // Setting latest run number information
+    LOGF(debug, "Setting the last call of the timestamp for run %i to %llu", runNumber, runNumberTimeStamp);
+    lastRunNumber = runNumber; // Setting latest run number information
   }
 
-  void process(aod::BC const& bc)
+  /// Sets the timestamp of the SOR and the initial orbit of a run
+  void setRunNumber(const int runNumber)
   {
     // First: we need to set the timestamp from the run number.
     // This is done with caching if the run number of the BC was already processed before
     // If not the timestamp of the run number from BC is queried from CCDB and added to the cache
-    if (bc.runNumber() == lastRunNumber) { // The run number coincides to the last run processed
+    if (runNumber == lastRunNumber) { // The run number coincides to the last run processed
       LOGF(debug, "Using timestamp from last call");
-    } else if (mapRunToTimestamp.count(bc.runNumber())) { // The run number was already requested before: getting it from cache!
+    } else if (mapRunToTimestamp.count(runNumber)) { // The run number was already requested before: getting it from cache!
       LOGF(debug, "Getting timestamp from cache");
-      runNumberTimeStamp = mapRunToTimestamp[bc.runNumber()];
-      makeInitialOrbit(bc);
+      runNumberTimeStamp = mapRunToTimestamp[runNumber];
+      makeInitialOrbit(runNumber);
     } else { // The run was not requested before: need to acccess CCDB!
       LOGF(debug, "Getting timestamp from CCDB");
       std::map<std::string, std::string> metadata, headers;
-      const std::string run_path = Form("%s/%i", rct_path.value.data(), bc.runNumber());
-      headers = ccdb_api.retrieveHeaders(run_path, metadata, -1);
+      const std::string run_path = Form("%s/%i", rct_path.value.data(), runNumber);
+      if (!snapshot) {
+        CCDBSnapshot::record(run_path, -1);
+      }
+      headers = snapshot ? snapshot->retrieveHeaders(run_path, metadata, -1) : ccdb_api.retrieveHeaders(run_path, metadata, -1);
       if (headers.count("SOR") == 0) {
         LOGF(fatal, "Cannot find run-number to timestamp in path '%s'.", run_path.data());
       }
@@ -98,22 +121,58 @@ struct TimestampTask {
 
       // Adding the timestamp to the cache map
       std::pair<std::map<int, long>::iterator, bool> check;
-      check = mapRunToTimestamp.insert(std::pair<int, long>(bc.runNumber(), runNumberTimeStamp));
+      check = mapRunToTimestamp.insert(std::pair<int, long>(runNumber, runNumberTimeStamp));
       if (!check.second) {
-        LOGF(fatal, "Run number %i already existed with a timestamp of %llu", bc.runNumber(), check.first->second);
+        LOGF(fatal, "Run number %i already existed with a timestamp of %llu", runNumber, check.first->second);
       }
-      makeInitialOrbit(bc);
-      LOGF(info, "Add new run number %i with timestamp %llu to cache", bc.runNumber(), runNumberTimeStamp);
+      makeInitialOrbit(runNumber);
+      LOGF(info, "Add new run number %i with timestamp %llu to cache", runNumber, runNumberTimeStamp);
     }
 
     if (verbose.value) {
-      LOGF(info, "Run-number to timestamp found! %i %llu ms", bc.runNumber(), runNumberTimeStamp);
+      LOGF(info, "Run-number to timestamp found! %i %llu ms", runNumber, runNumberTimeStamp);
+    }
+  }
+
+  /// Start of the run set with setRunNumber
+  o2::analysis::timestamp::RunStart getRunStart() const { return o2::analysis::timestamp::RunStart{runNumberTimeStamp, initialIR}; }
+
+  void processBC(aod::BC const& bc)
+  {
+    setRunNumber(bc.runNumber());
+    timestampTable(o2::analysis::timestamp::getTimestamp(getRunStart(), bc.globalBC(), isRun2MC));
+  }
+  PROCESS_SWITCH(TimestampTask, processBC, "Compute the timestamp BC by BC", true);
+
+  /// Same output as processBC, computed for the whole table: the runs of the DF are resolved upfront and
+  /// the timestamps of each contiguous block of BCs of the same run are computed in a single loop
+  void processTable(aod::BCs const& bcs)
+  {
+    const std::size_t nBCs = bcs.size();
+    globalBCs.resize(nBCs);
+    runNumbers.resize(nBCs);
+    timestamps.resize(nBCs);
+    std::size_t i = 0;
+    for (const auto& bc : bcs) {
+      globalBCs[i] = bc.globalBC();
+      runNumbers[i] = bc.runNumber();
+      i++;
+    }
+    // Prefetching the SOR timestamps and initial orbits of all the runs of the DF
+    for (const int runNumber : std::set<int>(runNumbers.begin(), runNumbers.end())) {
+      setRunNumber(runNumber);
+    }
+    auto getRunStartOf = [this](const int runNumber) {
+      setRunNumber(runNumber);
+      return getRunStart();
+    };
+    o2::analysis::timestamp::fillTimestamps(globalBCs, runNumbers, isRun2MC, getRunStartOf, timestamps);
+    timestampTable.reserve(nBCs);
+    for (const auto timestamp : timestamps) {
+      timestampTable(timestamp);
     }
-    const uint16_t currentBC = isRun2MC ? initialBC : (bc.globalBC() % o2::constants::lhc::LHCMaxBunches);
-    const uint32_t currentOrbit = isRun2MC ? initialOrbit : (bc.globalBC() / o2::constants::lhc::LHCMaxBunches);
-    const InteractionRecord currentIR(currentBC, currentOrbit);
-    timestampTable(runNumberTimeStamp + (currentIR - initialIR).bc2ns() * 1e-6);
   }
+  PROCESS_SWITCH(TimestampTask, processTable, "Compute the timestamps of the whole BC table at once", false);
 };
 
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
@@ -0,0 +1,98 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+//
+// Task to add a table of track parameters and covariances in the layout of the TrackParCov,
+// shared by the secondary vertexers instead of converting and propagating the tracks each
+//
+
+#include "Framework/AnalysisDataModel.h"
+#include "Framework/AnalysisTask.h"
+#include "Framework/runDataProcessing.h"
+#include "Common/DataModel/TrackPropagation.h"
+#include "Common/Core/trackUtilities.h"
+#include "Common/Core/TrackParCovCache.h"
+#include "Common/Core/CCDBSnapshot.h"
+#include "CCDB/BasicCCDBManager.h"
+#include "DataFormatsParameters/GRPObject.h"
+
+using namespace o2;
+using namespace o2::framework;
+
+struct TrackParCovCacheTask {
+  Produces<aod::TracksParCovCache> tracksParCovCache;
+
+  Service<o2::ccdb::BasicCCDBManager> ccdb;
+  CCDBSnapshot* snapshot = nullptr; /// Snapshot used instead of the CCDB if the URL is of the form snapshot://<file name>
+
+  Configurable<std::string> ccdburl{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository, or snapshot://<file name> to use a snapshot written by ccdb-snapshot"};
+  Configurable<std::string> grpPath{"grpPath", "GLO/GRP/GRP", "Path of the grp file"};
+  Configurable<float> refX{"refX", -1.f, "X to propagate the tracks to in the field, if not negative. Tracks already inside or failing the propagation are kept at their X"};
+
+  int runNumber = -1;
+  float bz = 0.f; // magnetic field in kG of the current run
+
+  void init(InitContext&)
+  {
+    snapshot = CCDBSnapshot::fromUrl(ccdburl);
+    if (!snapshot) {
+      ccdb->setURL(ccdburl);
+      ccdb->setCaching(true);
+      ccdb->setLocalObjectValidityChecking();
+    }
+  }
+
+  /// Takes the magnetic field from the GRP when the run changes
+  void updateMagneticField(aod::BCsWithTimestamps::iterator const& bc)
+  {
+    if (bc.runNumber() == runNumber) {
+      return;
+    }
+    auto grpo = CCDBSnapshot::getObject<o2::parameters::GRPObject>(snapshot, ccdb, grpPath, bc.timestamp());
+    if (grpo == nullptr) {
+      LOGF(fatal, "GRP object not found for timestamp %llu", bc.timestamp());
+      return;
+    }
+    runNumber = bc.runNumber();
+    bz = grpo->getNominalL3Field();
+    LOGF(info, "Retrieved GRP for run %d with magnetic field of %.1f kG", runNumber, bz);
+  }
+
+  void process(soa::Join<aod::Tracks, aod::TracksCov> const& tracks, aod::BCsWithTimestamps const& bcs)
+  {
+    if (tracks.size() == 0) {
+      return;
+    }
+    if (bcs.size() == 0) {
+      LOGF(fatal, "No BC to take the run of the tracks from");
+    }
+    // the tracks of a DF belong to a single run
+    updateMagneticField(bcs.begin());
+    tracksParCovCache.reserve(tracks.size());
+    for (const auto& track : tracks) {
+      auto trackParCov = getTrackParCov(track);
+      if (refX >= 0.f && trackParCov.getX() > refX) {
+        auto propagated = trackParCov;
+        if (propagated.propagateTo(refX, bz)) {
+          trackParCov = propagated;
+        }
+      }
+      float par[5], covpar[15];
+      fillTrackParCovCacheColumns(trackParCov, par, covpar);
+      tracksParCovCache(trackParCov.getX(), trackParCov.getAlpha(), par, covpar, bz);
+    }
+  }
+};
+
+WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
+{
+  return WorkflowSpec{adaptAnalysisTask<TrackParCovCacheTask>(cfgc, TaskName{"track-parcov-cache"})};
+}
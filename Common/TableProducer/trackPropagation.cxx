@@ -21,6 +21,7 @@
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "Common/DataModel/TrackPropagation.h"
 #include "Common/Core/trackUtilities.h"
+#include "Common/Core/CCDBSnapshot.h"
 #include "ReconstructionDataFormats/DCA.h"
 #include "DetectorsBase/Propagator.h"
 #include "DetectorsBase/GeometryManager.h"
@@ -57,6 +58,7 @@ struct TrackPropagation {
   Produces<aod::TracksExtended> tracksExtended;
 
   Service<o2::ccdb::BasicCCDBManager> ccdb;
+  CCDBSnapshot* snapshot = nullptr; /// Snapshot used instead of the CCDB if the URL is of the form snapshot://<file name>
 
   bool fillTracksPropagated = false;
   bool fillTracksParPropagated = false;
@@ -70,7 +72,7 @@ struct TrackPropagation {
   o2::base::MatLayerCylSet* lut = nullptr;
   ;
 
-  Configurable<std::string> ccdburl{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository"};
+  Configurable<std::string> ccdburl{"ccdb-url", "http://alice-ccdb.cern.ch", "url of the ccdb repository, or snapshot://<file name> to use a snapshot written by ccdb-snapshot"};
   Configurable<std::string> lutPath{"lutPath", "GLO/Param/MatLUT", "Path of the Lut parametrization"};
   Configurable<std::string> geoPath{"geoPath", "GLO/Config/GeometryAligned", "Path of the geometry file"};
   Configurable<std::string> grpPath{"grpPath", "GLO/GRP/GRP", "Path of the grp file"};
@@ -119,118 +121,98 @@ struct TrackPropagation {
       registry.add("heta", "track #eta; not propagated", {HistType::kTH1F, {{200, -2., 2.}}});
     }
 
-    ccdb->setURL(ccdburl);
-    ccdb->setCaching(true);
-    ccdb->setLocalObjectValidityChecking();
+    snapshot = CCDBSnapshot::fromUrl(ccdburl);
+    if (!snapshot) {
+      ccdb->setURL(ccdburl);
+      ccdb->setCaching(true);
+      ccdb->setLocalObjectValidityChecking();
+    }
 
-    lut = o2::base::MatLayerCylSet::rectifyPtrFromFile(ccdb->get<o2::base::MatLayerCylSet>(lutPath));
+    lut = o2::base::MatLayerCylSet::rectifyPtrFromFile(CCDBSnapshot::getObject<o2::base::MatLayerCylSet>(snapshot, ccdb, lutPath));
 
     matCorr = o2::base::Propagator::MatCorrType::USEMatCorrLUT;
 
     if (!o2::base::GeometryManager::isGeometryLoaded()) {
-      ccdb->get<TGeoManager>(geoPath);
-      grpo = ccdb->getForTimeStamp<o2::parameters::GRPObject>(grpPath, analysis::trackpropagation::run3grp_timestamp);
+      CCDBSnapshot::getObject<TGeoManager>(snapshot, ccdb, geoPath);
+      grpo = CCDBSnapshot::getObject<o2::parameters::GRPObject>(snapshot, ccdb, grpPath, analysis::trackpropagation::run3grp_timestamp);
       o2::base::Propagator::initFieldFromGRP(grpo);
       o2::base::Propagator::Instance()->setMatLUT(lut);
     }
-    mVtx = ccdb->get<o2::dataformats::MeanVertexObject>(mVtxPath);
+    mVtx = CCDBSnapshot::getObject<o2::dataformats::MeanVertexObject>(snapshot, ccdb, mVtxPath);
   }
 
-  void processStandard(aod::Tracks const& tracks, aod::Collisions const&, aod::BCsWithTimestamps const&)
+  /// Propagates the track parameters to the DCA to the collision of the track, or to the mean vertex if it has none
+  template <typename TTrack>
+  void propagate(const TTrack& track, o2::track::TrackPar& trackPar, gpu::gpustd::array<float, 2>& dcaInfo) const
   {
+    trackPar = getTrackPar(track);
+    if (track.has_collision()) {
+      auto const& collision = track.collision();
+      o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackPar, 2.f, matCorr, &dcaInfo);
+    } else {
+      o2::base::Propagator::Instance()->propagateToDCABxByBz({mVtx->getX(), mVtx->getY(), mVtx->getZ()}, trackPar, 2.f, matCorr, &dcaInfo);
+    }
+  }
 
-    gpu::gpustd::array<float, 2> dcaInfo;
+  /// Propagates the track parameters and covariance to the DCA to the collision of the track, or to the mean vertex if it has none
+  template <typename TTrack>
+  void propagate(const TTrack& track, o2::track::TrackParCov& trackParCov, o2::dataformats::DCA& dcaInfoCov) const
+  {
     o2::dataformats::VertexBase vtx;
+    trackParCov = getTrackParCov(track);
+    if (track.has_collision()) {
+      auto const& collision = track.collision();
+      vtx.setPos({collision.posX(), collision.posY(), collision.posZ()});
+      vtx.setCov(collision.covXX(), collision.covXY(), collision.covYY(), collision.covXZ(), collision.covYZ(), collision.covZZ());
+    } else {
+      vtx.setPos({mVtx->getX(), mVtx->getY(), mVtx->getZ()});
+      vtx.setCov(0.0, 0.0, 0.0, 0.0, 0.0, 0.0); //this doesnt exist for the meanvertexobject
+    }
+    o2::base::Propagator::Instance()->propagateToDCABxByBz(vtx, trackParCov, 2.f, matCorr, &dcaInfoCov);
+  }
 
-    for (auto& track : tracks) {
-      auto trackPar = getTrackPar(track);
-      if (track.has_collision()) {
-        auto const& collision = track.collision();
-        o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackPar, 2.f, matCorr, &dcaInfo);
-        if (fillTracksPropagated) {
-          tracksPropagated(track.collisionId(), track.trackType(), trackPar.getSign(), trackPar.getPt(), trackPar.getPhi(), trackPar.getEta());
-        }
-        if (fillTracksParPropagated) {
-          tracksParPropagated(trackPar.getX(), trackPar.getAlpha(), trackPar.getY(), trackPar.getZ(), trackPar.getSnp(), trackPar.getTgl(), trackPar.getQ2Pt());
-        }
-        if (fillTracksExtended) {
-          tracksExtended(dcaInfo[0], dcaInfo[1]);
-        }
-        if (fillQAHists) {
-          registry.fill(HIST("hpt"), track.pt());
-          registry.fill(HIST("hphi"), track.phi());
-          registry.fill(HIST("heta"), track.eta());
-        }
-      } else {
-        o2::base::Propagator::Instance()->propagateToDCABxByBz({mVtx->getX(), mVtx->getY(), mVtx->getZ()}, trackPar, 2.f, matCorr, &dcaInfo);
+  template <typename TTrack>
+  void fillTables(const TTrack& track, const o2::track::TrackPar& trackPar, const float dcaY, const float dcaZ)
+  {
+    if (fillTracksPropagated) {
+      tracksPropagated(track.collisionId(), track.trackType(), trackPar.getSign(), trackPar.getPt(), trackPar.getPhi(), trackPar.getEta());
+    }
+    if (fillTracksParPropagated) {
+      tracksParPropagated(trackPar.getX(), trackPar.getAlpha(), trackPar.getY(), trackPar.getZ(), trackPar.getSnp(), trackPar.getTgl(), trackPar.getQ2Pt());
+    }
+    if (fillTracksExtended) {
+      tracksExtended(dcaY, dcaZ);
+    }
+  }
 
-        if (fillTracksPropagated) {
-          tracksPropagated(track.collisionId(), track.trackType(), trackPar.getSign(), trackPar.getPt(), trackPar.getPhi(), trackPar.getEta());
-        }
-        if (fillTracksParPropagated) {
-          tracksParPropagated(trackPar.getX(), trackPar.getAlpha(), trackPar.getY(), trackPar.getZ(), trackPar.getSnp(), trackPar.getTgl(), trackPar.getQ2Pt());
-        }
-        if (fillTracksExtended) {
-          tracksExtended(dcaInfo[0], dcaInfo[1]);
-        }
-        if (fillQAHists) {
-          registry.fill(HIST("hpt"), track.pt());
-          registry.fill(HIST("hphi"), track.phi());
-          registry.fill(HIST("heta"), track.eta());
-        }
-      }
+  void fillQA(const float pt, const float phi, const float eta)
+  {
+    if (fillQAHists) {
+      registry.fill(HIST("hpt"), pt);
+      registry.fill(HIST("hphi"), phi);
+      registry.fill(HIST("heta"), eta);
+    }
+  }
+
+  void processStandard(aod::Tracks const& tracks, aod::Collisions const&, aod::BCsWithTimestamps const&)
+  {
+    gpu::gpustd::array<float, 2> dcaInfo;
+    o2::track::TrackPar trackPar;
+    for (auto& track : tracks) {
+      propagate(track, trackPar, dcaInfo);
+      fillTables(track, trackPar, dcaInfo[0], dcaInfo[1]);
+      fillQA(track.pt(), track.phi(), track.eta());
     }
   }
   PROCESS_SWITCH(TrackPropagation, processStandard, "Process without covariance", true);
   void processCovariance(soa::Join<aod::Tracks, aod::TracksCov> const& tracks, aod::Collisions const&, aod::BCsWithTimestamps const&)
   {
-
     o2::dataformats::DCA dcaInfoCov;
-    o2::dataformats::VertexBase vtx;
+    o2::track::TrackParCov trackParCov;
     for (auto& track : tracks) {
-
-      auto trackParCov = getTrackParCov(track);
-      if (track.has_collision()) {
-        auto const& collision = track.collision();
-        vtx.setPos({collision.posX(), collision.posY(), collision.posZ()});
-        vtx.setCov(collision.covXX(), collision.covXY(), collision.covYY(), collision.covXZ(), collision.covYZ(), collision.covZZ());
-        o2::base::Propagator::Instance()->propagateToDCABxByBz(vtx, trackParCov, 2.f, matCorr, &dcaInfoCov);
-
-        if (fillTracksPropagated) {
-          tracksPropagated(track.collisionId(), track.trackType(), trackParCov.getSign(), trackParCov.getPt(), trackParCov.getPhi(), trackParCov.getEta());
-        }
-        if (fillTracksParPropagated) {
-          tracksParPropagated(trackParCov.getX(), trackParCov.getAlpha(), trackParCov.getY(), trackParCov.getZ(), trackParCov.getSnp(), trackParCov.getTgl(), trackParCov.getQ2Pt());
-        }
-        if (fillTracksExtended) {
-          tracksExtended(dcaInfoCov.getY(), dcaInfoCov.getZ());
-        }
-        if (fillQAHists) {
-          registry.fill(HIST("hpt"), trackParCov.getPt());
-          registry.fill(HIST("hphi"), trackParCov.getPhi());
-          registry.fill(HIST("heta"), trackParCov.getEta());
-        }
-      } else {
-
-        vtx.setPos({mVtx->getX(), mVtx->getY(), mVtx->getZ()});
-        vtx.setCov(0.0, 0.0, 0.0, 0.0, 0.0, 0.0); //this doesnt exist for the meanvertexobject
-        o2::base::Propagator::Instance()->propagateToDCABxByBz(vtx, trackParCov, 2.f, matCorr, &dcaInfoCov);
-
-        if (fillTracksPropagated) {
-          tracksPropagated(track.collisionId(), track.trackType(), trackParCov.getSign(), trackParCov.getPt(), trackParCov.getPhi(), trackParCov.getEta());
-        }
-        if (fillTracksParPropagated) {
-          tracksParPropagated(trackParCov.getX(), trackParCov.getAlpha(), trackParCov.getY(), trackParCov.getZ(), trackParCov.getSnp(), trackParCov.getTgl(), trackParCov.getQ2Pt());
-        }
-        if (fillTracksExtended) {
-          tracksExtended(dcaInfoCov.getY(), dcaInfoCov.getZ());
-        }
-        if (fillQAHists) {
-          registry.fill(HIST("hpt"), trackParCov.getPt());
-          registry.fill(HIST("hphi"), trackParCov.getPhi());
-          registry.fill(HIST("heta"), trackParCov.getEta());
-        }
-      }
+      propagate(track, trackParCov, dcaInfoCov);
+      fillTables(track, trackParCov, dcaInfoCov.getY(), dcaInfoCov.getZ());
+      fillQA(trackParCov.getPt(), trackParCov.getPhi(), trackParCov.getEta());
     }
   }
   PROCESS_SWITCH(TrackPropagation, processCovariance, "Process with covariance", false);
@@ -18,6 +18,7 @@
 #include "Framework/runDataProcessing.h"
 #include "Common/Core/TrackSelection.h"
 #include "Common/Core/TrackSelectionDefaults.h"
+#include "Common/Core/TrackSelectionBatch.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "Common/Core/trackUtilities.h"
 
@@ -35,9 +36,11 @@ struct TrackSelectionTask {
   Configurable<bool> isRun3{"isRun3", false, "temp option to enable run3 mode"};
 
   Produces<aod::TrackSelection> filterTable;
+  Produces<aod::TrackSelectionFlags> flagsTable;
 
   TrackSelection globalTracks;
   TrackSelection globalTracksSDD;
+  TrackSelectionBatch selections; // evaluates all the selections in one pass, in the order of aod::track::trackcutflags
 
   void init(InitContext&)
   {
@@ -47,13 +50,18 @@ struct TrackSelectionTask {
     if (isRun3) {
       globalTracks.SetTrackType(o2::aod::track::TrackTypeEnum::Track);
     }
+
+    selections.Add(globalTracks);
+    selections.Add(globalTracksSDD);
   }
 
   void process(soa::Join<aod::FullTracks, aod::TracksExtended> const& tracks)
   {
     for (auto& track : tracks) {
-      filterTable((uint8_t)globalTracks.IsSelected(track),
-                  (uint8_t)globalTracksSDD.IsSelected(track));
+      auto flags = selections.GetFlags(track);
+      filterTable((uint8_t)TrackSelectionBatch::IsSelected(flags, aod::track::trackcutflags::GlobalTrack),
+                  (uint8_t)TrackSelectionBatch::IsSelected(flags, aod::track::trackcutflags::GlobalTrackSDD));
+      flagsTable(flags);
     }
   }
 };
@@ -0,0 +1,170 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   ccdbSnapshot.cxx
+/// \brief  exec for writing the CCDB objects used by a workflow into a snapshot file, see Common/Core/CCDBSnapshot.h.
+///         The objects are given as a list of "path timestamp" lines (as printed by the snapshot for missing objects,
+///         or recorded by running the workflow against the CCDB with O2_CCDB_SNAPSHOT_RECORD=<list file>)
+///         and/or as paths whose objects are all taken over the duration of a list of runs.
+///
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "Common/Core/CCDBSnapshot.h"
+#include "handleParamBase.h"
+#include "Algorithm/RangeTokenizer.h"
+
+bool initOptionsAndParse(bpo::options_description& options, int argc, char* argv[])
+{
+  options.add_options()(
+    "url,u", bpo::value<std::string>()->default_value("http://alice-ccdb.cern.ch"), "URL of the CCDB database e.g. http://ccdb-test.cern.ch:8080 or http://alice-ccdb.cern.ch")(
+    "output,o", bpo::value<std::string>()->default_value("ccdb_snapshot.bin"), "Snapshot file to write")(
+    "objects,i", bpo::value<std::string>()->default_value(""), "File with the objects to snapshot, one 'path timestamp' per line, a negative timestamp takes the latest object")(
+    "paths,p", bpo::value<std::string>()->default_value(""), "Comma separated CCDB paths whose objects are all snapshotted over the duration of the runs")(
+    "runs,R", bpo::value<std::string>()->default_value(""), "Comma separated run numbers, their RCT objects and the SOR orbit map are always snapshotted")(
+    "rct-path", bpo::value<std::string>()->default_value("RCT/RunInformation"), "path to the ccdb RCT objects for the SOR/EOR timestamps")(
+    "start-orbit-path", bpo::value<std::string>()->default_value("GRP/StartOrbit"), "path to the ccdb SOR orbit objects")(
+    "tmp-dir", bpo::value<std::string>()->default_value("/tmp/ccdb_snapshot"), "Directory for the temporary download of the objects")(
+    "help,h", "Produce help message.");
+  try {
+    bpo::store(parse_command_line(argc, argv, options), arguments);
+
+    // help
+    if (arguments.count("help")) {
+      LOG(info) << options;
+      return false;
+    }
+    bpo::notify(arguments);
+  } catch (const bpo::error& e) {
+    LOG(error) << e.what() << "\n";
+    LOG(error) << "Error parsing command line arguments; Available options:";
+    LOG(error) << options;
+    return false;
+  }
+  return true;
+
+} // initOptionsAndParse
+
+/// Adds the object valid at the timestamp to the snapshot
+/// \return the end of validity of the object, or -1 if it is not found
+long addObject(CCDBSnapshotWriter& writer, const std::string& path, const long timestamp)
+{
+  const std::map<std::string, std::string> metadata;
+  auto headers = api.retrieveHeaders(path, metadata, timestamp);
+  if (headers.count("Valid-From") == 0 || headers.count("Valid-Until") == 0) {
+    LOG(error) << "Object " << path << " not found for timestamp " << timestamp << " -> " << timeStampToHReadble(timestamp);
+    return -1;
+  }
+  const long from = std::stol(headers["Valid-From"]);
+  const long until = std::stol(headers["Valid-Until"]);
+  std::vector<char> blob;
+  const std::string tmpDir = arguments["tmp-dir"].as<std::string>();
+  const std::string blobFile = tmpDir + "/" + path + "/snapshot.root";
+  std::filesystem::remove(blobFile);
+  if (api.retrieveBlob(path, tmpDir, metadata, timestamp)) {
+    std::ifstream in(blobFile, std::ios::binary);
+    blob.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  if (blob.empty()) { // Headers are enough e.g. for the RCT objects
+    LOG(warning) << "No payload for " << path << " valid in [" << from << ", " << until << "), only the headers are stored";
+  }
+  if (writer.add(path, from, until, headers, std::move(blob))) {
+    LOG(info) << "Added " << path << " valid in [" << from << ", " << until << ") for timestamp " << timestamp << " -> " << timeStampToHReadble(timestamp);
+  }
+  return until;
+}
+
+int main(int argc, char* argv[])
+{
+  bpo::options_description options("Allowed options");
+  if (!initOptionsAndParse(options, argc, argv)) {
+    return 1;
+  }
+
+  api.init(arguments["url"].as<std::string>());
+  if (!api.isHostReachable()) {
+    LOG(error) << "CCDB host " << arguments["url"].as<std::string>() << " is not reacheable";
+    return 1;
+  }
+  CCDBSnapshotWriter writer;
+  int nMissing = 0;
+
+  // Objects at given timestamps
+  const auto objects = arguments["objects"].as<std::string>();
+  if (!objects.empty()) {
+    std::ifstream in(objects);
+    if (!in) {
+      LOG(error) << "Cannot open the object list " << objects;
+      return 1;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string path;
+      long timestamp = -1;
+      if (!(fields >> path) || path[0] == '#') {
+        continue;
+      }
+      fields >> timestamp;
+      nMissing += addObject(writer, path, timestamp) < 0;
+    }
+  }
+
+  // All objects over the duration of the runs
+  const auto runs = o2::RangeTokenizer::tokenize<int>(arguments["runs"].as<std::string>());
+  if (!runs.empty()) {
+    std::vector<std::string> paths;
+    std::istringstream pathList(arguments["paths"].as<std::string>());
+    for (std::string path; std::getline(pathList, path, ',');) {
+      if (!path.empty()) {
+        paths.push_back(path);
+      }
+    }
+    nMissing += addObject(writer, arguments["start-orbit-path"].as<std::string>(), -1) < 0;
+    for (const int run : runs) {
+      const std::string runPath = arguments["rct-path"].as<std::string>() + "/" + std::to_string(run);
+      std::map<std::string, std::string> metadata;
+      auto headers = api.retrieveHeaders(runPath, metadata, -1);
+      if (headers.count("SOR") == 0 || headers.count("EOR") == 0) {
+        LOG(error) << "Cannot find the SOR and EOR of run " << run << " in path " << runPath;
+        nMissing++;
+        continue;
+      }
+      addObject(writer, runPath, -1);
+      const long sor = std::stol(headers["SOR"]);
+      const long eor = std::stol(headers["EOR"]);
+      for (const auto& path : paths) {
+        // Objects are taken one after the other, each one starting at the end of validity of the previous
+        for (long timestamp = sor; timestamp <= eor;) {
+          const long until = addObject(writer, path, timestamp);
+          if (until <= timestamp) {
+            nMissing += until < 0;
+            break;
+          }
+          timestamp = until;
+        }
+      }
+    }
+  }
+
+  if (writer.size() == 0) {
+    LOG(error) << "No object to snapshot, give the objects and/or the paths and runs";
+    return 1;
+  }
+  const auto output = arguments["output"].as<std::string>();
+  if (!writer.write(output)) {
+    return 1;
+  }
+  LOG(info) << "Written " << writer.size() << " objects to " << output << (nMissing ? ", " + std::to_string(nMissing) + " requested objects not found" : "");
+  return nMissing ? 1 : 0;
+} // main
@@ -0,0 +1,63 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#ifndef O2_ANALYSIS_COLLISIONSLICES_H
+#define O2_ANALYSIS_COLLISIONSLICES_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "Framework/Logger.h"
+
+// Index of the tracks of each collision in a (filtered) track table sorted by collision,
+// used to find the tracks of the mixed collisions in constant time
+
+namespace o2::analysis
+{
+// Position and number of the tracks of a collision in a filtered track table sorted by collision
+struct TrackSlice {
+  int64_t offset = 0;
+  int64_t size = 0;
+};
+
+// Maps the collision index to the slice of its tracks. Built once per DF, so that the tracks
+// of the mixed collisions are found in constant time instead of scanning the slicer for each pair.
+// Tracks with a negative collision index are skipped.
+template <typename TTracks, typename TCollisionIndex>
+std::unordered_map<int64_t, TrackSlice> indexTrackSlices(TTracks const& tracks, TCollisionIndex collisionIndex)
+{
+  std::unordered_map<int64_t, TrackSlice> slices;
+  TrackSlice* slice = nullptr;
+  int64_t lastCollision = -1;
+  int64_t position = 0;
+  for (auto& track : tracks) {
+    const int64_t collision = collisionIndex(track);
+    if (collision != lastCollision) {
+      lastCollision = collision;
+      slice = nullptr;
+      if (collision >= 0) {
+        auto inserted = slices.emplace(collision, TrackSlice{position, 0});
+        if (!inserted.second) {
+          LOGF(fatal, "Tracks are not sorted by collision, collision %d found twice", collision);
+        }
+        slice = &inserted.first->second;
+      }
+    }
+    if (slice) {
+      slice->size++;
+    }
+    position++;
+  }
+  return slices;
+}
+} // namespace o2::analysis
+
+#endif
@@ -0,0 +1,121 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   benchCollisionSlices.cxx
+/// \brief  Checks the collision slices of PWGCF/Core/CollisionSlices.h against a linear scan of the grouped tracks
+///         (as done by the slicer before) on a simulated DF, and compares the time needed to find the tracks
+///         of both collisions of all mixed pairs.
+///         Returns a non-zero exit code if a slice differs.
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "PWGCF/Core/CollisionSlices.h"
+
+using namespace o2::analysis;
+
+namespace
+{
+struct Track {
+  int64_t collisionId;
+};
+
+/// Finds the slice of a collision by walking the groups of tracks from the start, as the slicer did
+TrackSlice findSliceLinear(const std::vector<Track>& tracks, int64_t collision)
+{
+  TrackSlice slice{0, 0};
+  std::size_t position = 0;
+  while (position < tracks.size()) {
+    auto begin = position;
+    auto current = tracks[position].collisionId;
+    while (position < tracks.size() && tracks[position].collisionId == current) {
+      ++position;
+    }
+    if (current == collision) {
+      return TrackSlice{static_cast<int64_t>(begin), static_cast<int64_t>(position - begin)};
+    }
+  }
+  return slice;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const int nCollisions = argc > 1 ? std::atoi(argv[1]) : 2000;
+  const int poolDepth = 5;
+  std::mt19937 generator(7);
+  std::poisson_distribution<int> multiplicity(30);
+
+  // tracks sorted by collision: unassigned tracks first, then some collisions without selected tracks
+  std::vector<Track> tracks(multiplicity(generator), Track{-1});
+  for (int collision = 0; collision < nCollisions; collision++) {
+    int n = collision % 11 == 3 ? 0 : multiplicity(generator);
+    tracks.insert(tracks.end(), n, Track{collision});
+  }
+  auto collisionIndex = [](const Track& track) { return track.collisionId; };
+
+  int nFailed = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto slices = indexTrackSlices(tracks, collisionIndex);
+  double timeIndex = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+  // every collision with tracks is found with the same slice as with the linear scan, the others are not found
+  for (int collision = 0; collision < nCollisions; collision++) {
+    auto expected = findSliceLinear(tracks, collision);
+    auto it = slices.find(collision);
+    bool isFound = it != slices.end();
+    if (isFound != (expected.size > 0) || (isFound && (it->second.offset != expected.offset || it->second.size != expected.size))) {
+      printf("FAILED: collision %d: expected (%ld, %ld), found %s (%ld, %ld)\n", collision, (long)expected.offset, (long)expected.size,
+             isFound ? "" : "none", isFound ? (long)it->second.offset : 0L, isFound ? (long)it->second.size : 0L);
+      ++nFailed;
+    }
+  }
+  if (slices.count(-1)) {
+    printf("FAILED: unassigned tracks are indexed\n");
+    ++nFailed;
+  }
+
+  // mixed pairs: each collision with the previous poolDepth ones
+  int64_t checksum = 0;
+  start = std::chrono::steady_clock::now();
+  for (int collision1 = 0; collision1 < nCollisions; collision1++) {
+    for (int collision2 = std::max(0, collision1 - poolDepth); collision2 < collision1; collision2++) {
+      checksum += findSliceLinear(tracks, collision1).size * findSliceLinear(tracks, collision2).size;
+    }
+  }
+  double timeLinear = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  int64_t checksumIndexed = 0;
+  start = std::chrono::steady_clock::now();
+  for (int collision1 = 0; collision1 < nCollisions; collision1++) {
+    for (int collision2 = std::max(0, collision1 - poolDepth); collision2 < collision1; collision2++) {
+      auto it1 = slices.find(collision1);
+      auto it2 = slices.find(collision2);
+      if (it1 != slices.end() && it2 != slices.end()) {
+        checksumIndexed += it1->second.size * it2->second.size;
+      }
+    }
+  }
+  double timeIndexed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  if (checksum != checksumIndexed) {
+    printf("FAILED: number of track pairs %ld (linear scan) vs %ld (index)\n", (long)checksum, (long)checksumIndexed);
+    ++nFailed;
+  }
+
+  printf("%d collisions, %zu tracks: index built in %.1f us; lookups of the mixed pairs: linear scan %.1f us, index %.1f us\n",
+         nCollisions, tracks.size(), timeIndex, timeLinear, timeIndexed);
+  printf("%s\n", nFailed ? "FAILED" : "OK");
+  return nFailed ? 1 : 0;
+}
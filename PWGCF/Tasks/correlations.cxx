@@ -13,7 +13,6 @@
 #include "Framework/AnalysisDataModel.h"
 #include "Framework/ASoAHelpers.h"
 #include <CCDB/BasicCCDBManager.h>
-#include "Framework/GroupSlicer.h"
 #include "Framework/StepTHn.h"
 #include "Framework/HistogramRegistry.h"
 #include "Framework/RunningWorkflowInfo.h"
@@ -25,10 +24,13 @@
 #include "PWGCF/DataModel/CorrelationsDerived.h"
 #include "PWGCF/Core/CorrelationContainer.h"
 #include "PWGCF/Core/PairCuts.h"
+#include "PWGCF/Core/CollisionSlices.h"
 #include "DataFormatsParameters/GRPObject.h"
 
 #include <TH1F.h>
 #include <cmath>
+#include <unordered_map>
+#include <unordered_set>
 #include <TDirectory.h>
 #include <THn.h>
 
@@ -74,6 +76,7 @@ struct CorrelationTask {
   O2_DEFINE_CONFIGURABLE(cfgEfficiencyAssociated, std::string, "", "CCDB path to efficiency object for associated particles")
 
   O2_DEFINE_CONFIGURABLE(cfgNoMixedEvents, int, 5, "Number of mixed events per event")
+  O2_DEFINE_CONFIGURABLE(cfgPoolDepth, int, 10, "Number of events kept per mixing bin in the event pools (processMixedPool*)")
 
   ConfigurableAxis axisVertex{"axisVertex", {7, -7, 7}, "vertex axis for histograms"};
   ConfigurableAxis axisDeltaPhi{"axisDeltaPhi", {72, -PIHalf, PIHalf * 3}, "delta phi axis for histograms"};
@@ -108,6 +111,46 @@ struct CorrelationTask {
     THn* mEfficiencyAssociated = nullptr;
   } cfg;
 
+  // Tracks of an event kept for the mixing, stored as compact arrays
+  struct PoolEvent {
+    std::vector<float> eta;
+    std::vector<float> phi;
+    std::vector<float> pt;
+    std::vector<int8_t> sign;
+    std::vector<float> efficiency; // 1 for the events in the pools, see fillCorrelationsPool
+
+    size_t size() const { return pt.size(); }
+    void clear()
+    {
+      eta.clear();
+      phi.clear();
+      pt.clear();
+      sign.clear();
+      efficiency.clear();
+    }
+  };
+
+  // Track interface to an entry of a PoolEvent, as needed by the pair cuts
+  struct PoolTrack {
+    const PoolEvent& event;
+    size_t i;
+
+    float eta() const { return event.eta[i]; }
+    float phi() const { return event.phi[i]; }
+    float pt() const { return event.pt[i]; }
+    int8_t sign() const { return event.sign[i]; }
+  };
+
+  // Ring buffer with the last cfgPoolDepth events of a mixing bin
+  struct EventPool {
+    std::vector<PoolEvent> events;
+    size_t next = 0;
+  };
+
+  std::unordered_map<int, EventPool> mEventPools; // event pools per mixing bin, persistent across DFs
+  PoolEvent mTriggerEvent;                         // trigger tracks of the current event, reused to avoid allocations
+  std::vector<float> mAssociatedEfficiency;        // efficiencies of the associated tracks of a pool event, reused to avoid allocations
+
   HistogramRegistry registry{"registry"};
   PairCuts mPairCuts;
 
@@ -121,6 +164,10 @@ struct CorrelationTask {
     const int maxMixBin = axisMultiplicity->size() * axisVertex->size();
     registry.add("eventcount", "bin", {HistType::kTH1F, {{maxMixBin + 2, -2.5, -0.5 + maxMixBin, "bin"}}});
 
+    if (cfgPoolDepth < 1) {
+      LOGF(fatal, "cfgPoolDepth must be at least 1, got %d", cfgPoolDepth.value);
+    }
+
     mPairCuts.SetHistogramRegistry(&registry);
 
     if (cfgPairCut->get("Photon") > 0 || cfgPairCut->get("K0") > 0 || cfgPairCut->get("Lambda") > 0 || cfgPairCut->get("Phi") > 0 || cfgPairCut->get("Rho") > 0) {
@@ -188,19 +235,30 @@ struct CorrelationTask {
   }
 
   template <typename TTarget, typename TCollision>
-  bool fillCollisionAOD(TTarget target, TCollision collision, float centrality)
+  bool fillCollisionAOD(TTarget target, TCollision collision, float centrality, bool fillHistograms = true)
   {
-    target->fillEvent(centrality, CorrelationContainer::kCFStepAll);
+    if (fillHistograms) {
+      target->fillEvent(centrality, CorrelationContainer::kCFStepAll);
+    }
 
     if (!collision.alias()[kINT7] || !collision.sel7()) {
       return false;
     }
 
-    target->fillEvent(centrality, CorrelationContainer::kCFStepReconstructed);
+    if (fillHistograms) {
+      target->fillEvent(centrality, CorrelationContainer::kCFStepReconstructed);
+    }
 
     return true;
   }
 
+  // Tracks of a slice, as a filtered table viewing its part of the rows selected in the full table
+  template <typename TTracks>
+  TTracks sliceTracks(TTracks const& tracks, o2::analysis::TrackSlice const& slice)
+  {
+    return TTracks{{tracks.asArrowTable()}, tracks.getSelectedRows().subspan(slice.offset, slice.size)};
+  }
+
   template <typename TTarget, typename TTracks>
   void fillCorrelations(TTarget target, TTracks tracks1, TTracks tracks2, float centrality, float posZ, int magField)
   {
@@ -328,8 +386,8 @@ struct CorrelationTask {
     // TODO loading of efficiency histogram missing here, because it will happen somehow in the CCDBConfigurable
 
     collisions.bindExternalIndices(&tracks);
-    auto tracksTuple = std::make_tuple(tracks);
-    GroupSlicer slicer(collisions, tracksTuple);
+    auto slices = o2::analysis::indexTrackSlices(tracks, [](auto const& track) { return track.collisionId(); });
+    std::unordered_set<int64_t> countedCollisions;
 
     // Strictly upper categorised collisions, for cfgNoMixedEvents combinations per bin, skipping those in entry -1
     for (auto& [collision1, collision2] : selfCombinations("fBin", cfgNoMixedEvents, -1, collisions, collisions)) {
@@ -337,30 +395,24 @@ struct CorrelationTask {
       LOGF(info, "processMixedAOD: Mixed collisions bin: %d pair: %d (%f), %d (%f)", collision1.bin(), collision1.index(), collision1.posZ(), collision2.index(), collision2.posZ());
 
       // TODO in principle these should be already checked on hash level, because in this way we don't check collision 2
-      // TODO not correct because event-level histograms on collision1 are filled for each pair (important :))
-      if (fillCollisionAOD(mixed, collision1, collision1.centV0M()) == false) {
+      // event-level histograms are filled only for the first pair of collision1
+      bool firstPair = countedCollisions.insert(collision1.index()).second;
+      if (fillCollisionAOD(mixed, collision1, collision1.centV0M(), firstPair) == false) {
         continue;
       }
-      registry.fill(HIST("eventcount"), collision1.bin());
-
-      auto it1 = slicer.begin();
-      auto it2 = slicer.begin();
-      for (auto& slice : slicer) {
-        if (slice.groupingElement().index() == collision1.index()) {
-          it1 = slice;
-          break;
-        }
+      if (firstPair) {
+        registry.fill(HIST("eventcount"), collision1.bin());
       }
-      for (auto& slice : slicer) {
-        if (slice.groupingElement().index() == collision2.index()) {
-          it2 = slice;
-          break;
-        }
+
+      auto it1 = slices.find(collision1.index());
+      auto it2 = slices.find(collision2.index());
+      if (it1 == slices.end() || it2 == slices.end()) {
+        continue;
       }
 
-      auto tracks1 = std::get<aodTracks>(it1.associatedTables());
+      auto tracks1 = sliceTracks(tracks, it1->second);
       tracks1.bindExternalIndices(&collisions);
-      auto tracks2 = std::get<aodTracks>(it2.associatedTables());
+      auto tracks2 = sliceTracks(tracks, it2->second);
       tracks2.bindExternalIndices(&collisions);
 
       auto bc = collision1.bc_as<aod::BCsWithTimestamps>();
@@ -378,35 +430,29 @@ struct CorrelationTask {
     // TODO loading of efficiency histogram missing here, because it will happen somehow in the CCDBConfigurable
 
     collisions.bindExternalIndices(&tracks);
-    auto tracksTuple = std::make_tuple(tracks);
-    GroupSlicer slicer(collisions, tracksTuple);
+    auto slices = o2::analysis::indexTrackSlices(tracks, [](auto const& track) { return track.cfCollisionId(); });
+    std::unordered_set<int64_t> countedCollisions;
 
     // Strictly upper categorised collisions, for cfgNoMixedEvents combinations per bin, skipping those in entry -1
     for (auto& [collision1, collision2] : selfCombinations("fBin", cfgNoMixedEvents, -1, collisions, collisions)) {
 
       LOGF(info, "processMixedDerived: Mixed collisions bin: %d pair: %d (%f), %d (%f)", collision1.bin(), collision1.index(), collision1.posZ(), collision2.index(), collision2.posZ());
 
-      registry.fill(HIST("eventcount"), collision1.bin());
-      mixed->fillEvent(collision1.centV0M(), CorrelationContainer::kCFStepReconstructed);
-
-      auto it1 = slicer.begin();
-      auto it2 = slicer.begin();
-      for (auto& slice : slicer) {
-        if (slice.groupingElement().index() == collision1.index()) {
-          it1 = slice;
-          break;
-        }
+      // event-level histograms are filled only for the first pair of collision1
+      if (countedCollisions.insert(collision1.index()).second) {
+        registry.fill(HIST("eventcount"), collision1.bin());
+        mixed->fillEvent(collision1.centV0M(), CorrelationContainer::kCFStepReconstructed);
       }
-      for (auto& slice : slicer) {
-        if (slice.groupingElement().index() == collision2.index()) {
-          it2 = slice;
-          break;
-        }
+
+      auto it1 = slices.find(collision1.index());
+      auto it2 = slices.find(collision2.index());
+      if (it1 == slices.end() || it2 == slices.end()) {
+        continue;
       }
 
-      auto tracks1 = std::get<derivedTracks>(it1.associatedTables());
+      auto tracks1 = sliceTracks(tracks, it1->second);
       tracks1.bindExternalIndices(&collisions);
-      auto tracks2 = std::get<derivedTracks>(it2.associatedTables());
+      auto tracks2 = sliceTracks(tracks, it2->second);
       tracks2.bindExternalIndices(&collisions);
 
       // LOGF(info, "Tracks: %d and %d entries", tracks1.size(), tracks2.size());
@@ -416,6 +462,137 @@ struct CorrelationTask {
   }
   PROCESS_SWITCH(CorrelationTask, processMixedDerived, "Process mixed events on derived data", false);
 
+  template <typename TTracks>
+  void fillPoolEvent(PoolEvent& event, TTracks const& tracks, THn* efficiency, float centrality, float posZ)
+  {
+    event.clear();
+    for (auto& track : tracks) {
+      event.eta.push_back(track.eta());
+      event.phi.push_back(track.phi());
+      event.pt.push_back(track.pt());
+      event.sign.push_back(track.sign());
+      event.efficiency.push_back(efficiency ? getEfficiency(efficiency, track.eta(), track.pt(), centrality, posZ) : 1.0f);
+    }
+  }
+
+  // Same as fillCorrelations, for trigger and associated tracks taken from PoolEvents
+  // As in fillCorrelations, the efficiencies of the associated tracks are evaluated with the centrality and
+  // z-vertex of the trigger event, therefore they are not stored with the events in the pools.
+  template <typename TTarget>
+  void fillCorrelationsPool(TTarget target, PoolEvent const& triggers, PoolEvent const& associated, float centrality, float posZ, int magField)
+  {
+    const float* associatedEfficiency = associated.efficiency.data();
+    if (cfg.mEfficiencyAssociated) {
+      mAssociatedEfficiency.resize(associated.size());
+      for (size_t j = 0; j < associated.size(); j++) {
+        mAssociatedEfficiency[j] = getEfficiency(cfg.mEfficiencyAssociated, associated.eta[j], associated.pt[j], centrality, posZ);
+      }
+      associatedEfficiency = mAssociatedEfficiency.data();
+    }
+
+    const int triggerCharge = cfgTriggerCharge;
+    const int associatedCharge = cfgAssociatedCharge;
+    const int pairCharge = cfgPairCharge;
+    const bool ptOrder = cfgPtOrder != 0;
+    const bool twoTrackCut = cfgTwoTrackCut > 0;
+
+    for (size_t i = 0; i < triggers.size(); i++) {
+      if (triggerCharge != 0 && triggerCharge * triggers.sign[i] < 0) {
+        continue;
+      }
+
+      const float triggerWeight = triggers.efficiency[i];
+      target->getTriggerHist()->Fill(CorrelationContainer::kCFStepReconstructed, triggers.pt[i], centrality, posZ, triggerWeight);
+
+      for (size_t j = 0; j < associated.size(); j++) {
+        if (ptOrder && associated.pt[j] >= triggers.pt[i]) {
+          continue;
+        }
+        if (associatedCharge != 0 && associatedCharge * associated.sign[j] < 0) {
+          continue;
+        }
+        if (pairCharge != 0 && pairCharge * triggers.sign[i] * associated.sign[j] < 0) {
+          continue;
+        }
+
+        if (cfg.mPairCuts && mPairCuts.conversionCuts(PoolTrack{triggers, i}, PoolTrack{associated, j})) {
+          continue;
+        }
+
+        if (twoTrackCut && mPairCuts.twoTrackCut(PoolTrack{triggers, i}, PoolTrack{associated, j}, magField)) {
+          continue;
+        }
+
+        float deltaPhi = triggers.phi[i] - associated.phi[j];
+        if (deltaPhi > 1.5f * PI) {
+          deltaPhi -= TwoPI;
+        }
+        if (deltaPhi < -PIHalf) {
+          deltaPhi += TwoPI;
+        }
+
+        target->getPairHist()->Fill(CorrelationContainer::kCFStepReconstructed,
+                                    triggers.eta[i] - associated.eta[j], associated.pt[j], triggers.pt[i], centrality, deltaPhi, posZ,
+                                    triggerWeight * associatedEfficiency[j]);
+      }
+    }
+  }
+
+  // Mixes the event with the events in its pool and then adds it to the pool, replacing the oldest one when the pool is full
+  template <typename TTracks>
+  void mixWithPool(EventPool& pool, int bin, TTracks const& tracks, float centrality, float posZ, int magField)
+  {
+    if (pool.events.empty() == false) {
+      registry.fill(HIST("eventcount"), bin);
+      fillPoolEvent(mTriggerEvent, tracks, cfg.mEfficiencyTrigger, centrality, posZ);
+      for (auto& event : pool.events) {
+        fillCorrelationsPool(mixed, mTriggerEvent, event, centrality, posZ, magField);
+      }
+    }
+
+    if (pool.events.size() < static_cast<size_t>(cfgPoolDepth)) {
+      pool.events.emplace_back();
+      fillPoolEvent(pool.events.back(), tracks, nullptr, centrality, posZ);
+    } else {
+      fillPoolEvent(pool.events[pool.next], tracks, nullptr, centrality, posZ);
+      pool.next = (pool.next + 1) % pool.events.size();
+    }
+  }
+
+  void processMixedPoolAOD(soa::Filtered<soa::Join<aod::Collisions, aod::Hashes, aod::EvSels, aod::CentV0Ms>>::iterator const& collision, aod::BCsWithTimestamps const&, aodTracks const& tracks)
+  {
+    if (collision.bin() < 0) {
+      return;
+    }
+    auto& pool = mEventPools[collision.bin()];
+
+    const auto centrality = collision.centV0M();
+    // event-level histograms are filled only for events which are mixed, i.e. if the pool is not empty
+    if (fillCollisionAOD(mixed, collision, centrality, pool.events.empty() == false) == false) {
+      return;
+    }
+
+    auto bc = collision.bc_as<aod::BCsWithTimestamps>();
+    mixWithPool(pool, collision.bin(), tracks, centrality, collision.posZ(), getMagneticField(bc.timestamp()));
+  }
+  PROCESS_SWITCH(CorrelationTask, processMixedPoolAOD, "Process mixed events on AOD with event pools persistent across DFs", false);
+
+  void processMixedPoolDerived(soa::Filtered<soa::Join<aod::CFCollisions, aod::Hashes>>::iterator const& collision, derivedTracks const& tracks)
+  {
+    if (collision.bin() < 0) {
+      return;
+    }
+    auto& pool = mEventPools[collision.bin()];
+
+    const auto centrality = collision.centV0M();
+    if (pool.events.empty() == false) {
+      mixed->fillEvent(centrality, CorrelationContainer::kCFStepReconstructed);
+    }
+
+    mixWithPool(pool, collision.bin(), tracks, centrality, collision.posZ(), getMagneticField(collision.timestamp()));
+  }
+  PROCESS_SWITCH(CorrelationTask, processMixedPoolDerived, "Process mixed events on derived data with event pools persistent across DFs", false);
+
   // Version with combinations
   void processWithCombinations(soa::Join<aod::Collisions, aod::CentV0Ms>::iterator const& collision, aod::BCsWithTimestamps const&, soa::Filtered<aod::Tracks> const& tracks)
   {
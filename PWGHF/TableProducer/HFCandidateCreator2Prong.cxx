@@ -19,6 +19,7 @@
 #include "DetectorsVertexing/DCAFitterN.h"
 #include "PWGHF/DataModel/HFSecondaryVertex.h"
 #include "Common/Core/trackUtilities.h"
+#include "Common/Core/RecoDecayMcIndexed.h"
 #include "ReconstructionDataFormats/DCA.h"
 
 using namespace o2;
@@ -46,8 +47,9 @@ struct HFCandidateCreator2Prong {
 
   double massPi = RecoDecay::getMassPDG(kPiPlus);
   double massK = RecoDecay::getMassPDG(kKPlus);
-  double massPiK{0.};
-  double massKPi{0.};
+  // prong momenta of the candidates of the DF (structure of arrays) for the batch calculation of the invariant masses
+  array<std::vector<float>, 2> pxProngs, pyProngs, pzProngs;
+  std::vector<double> massesPiK, massesKPi;
 
   void process(aod::Collisions const& collisions,
                aod::Hf2Prong const& rowsTrackIndexProng2,
@@ -63,6 +65,12 @@ struct HFCandidateCreator2Prong {
     df.setMinRelChi2Change(d_minrelchi2change);
     df.setUseAbsDCA(true);
 
+    for (auto* components : {&pxProngs, &pyProngs, &pzProngs}) {
+      for (auto& values : *components) {
+        values.clear();
+      }
+    }
+
     // loop over pairs of track indices
     for (const auto& rowTrackIndexProng2 : rowsTrackIndexProng2) {
       auto track0 = rowTrackIndexProng2.index0_as<aod::BigTracks>();
@@ -117,14 +125,31 @@ struct HFCandidateCreator2Prong {
                        rowTrackIndexProng2.index0Id(), rowTrackIndexProng2.index1Id(),
                        rowTrackIndexProng2.hfflag());
 
-      // fill histograms
+      // store the prong momenta for the histograms
       if (b_dovalplots) {
-        // calculate invariant masses
-        auto arrayMomenta = array{pvec0, pvec1};
-        massPiK = RecoDecay::M(arrayMomenta, array{massPi, massK});
-        massKPi = RecoDecay::M(arrayMomenta, array{massK, massPi});
-        hmass2->Fill(massPiK);
-        hmass2->Fill(massKPi);
+        for (auto iProng = 0; iProng < 2; ++iProng) {
+          const auto& pvec = iProng == 0 ? pvec0 : pvec1;
+          pxProngs[iProng].push_back(pvec[0]);
+          pyProngs[iProng].push_back(pvec[1]);
+          pzProngs[iProng].push_back(pvec[2]);
+        }
+      }
+    }
+
+    // fill histograms
+    if (b_dovalplots) {
+      // calculate invariant masses of all candidates at once
+      auto nCandidates = pxProngs[0].size();
+      massesPiK.resize(nCandidates);
+      massesKPi.resize(nCandidates);
+      auto px = array{gsl::span<const float>(pxProngs[0]), gsl::span<const float>(pxProngs[1])};
+      auto py = array{gsl::span<const float>(pyProngs[0]), gsl::span<const float>(pyProngs[1])};
+      auto pz = array{gsl::span<const float>(pzProngs[0]), gsl::span<const float>(pzProngs[1])};
+      RecoDecay::MBatch(px, py, pz, array{massPi, massK}, gsl::span<double>(massesPiK));
+      RecoDecay::MBatch(px, py, pz, array{massK, massPi}, gsl::span<double>(massesKPi));
+      for (std::size_t iCand = 0; iCand < nCandidates; ++iCand) {
+        hmass2->Fill(massesPiK[iCand]);
+        hmass2->Fill(massesKPi[iCand]);
       }
     }
   }
@@ -136,17 +161,41 @@ struct HFCandidateCreator2ProngExpressions {
   Produces<aod::HfCandProng2MCGen> rowMCMatchGen;
 
   Spawns<aod::HfCandProng2Ext> rowCandidateProng2;
-  void init(InitContext const&) {}
+  void init(InitContext const&)
+  {
+    if (doprocessMC && doprocessMCIndexed) {
+      LOGF(fatal, "processMC and processMCIndexed fill the same tables, enable only one of them.");
+    }
+  }
 
   /// Performs MC matching.
-  void processMC(aod::BigTracksMC const& tracks,
-                 aod::McParticles const& particlesMC)
+  /// \tparam useDecayIndex  use the decay tree index of the mc-decay-index workflow (RecoDecayMcIndexed)
+  /// \param finalDaughters  table aod::McFinalDaughters if useDecayIndex, ignored otherwise
+  template <bool useDecayIndex, typename TParticles, typename TFinalDaughters>
+  void runMCMatching(aod::BigTracksMC const& tracks,
+                     TParticles const& particlesMC,
+                     TFinalDaughters const& finalDaughters)
   {
     int indexRec = -1;
     int8_t sign = 0;
     int8_t flag = 0;
     int8_t origin = 0;
 
+    auto getMatchedMCRec = [&](const auto& arrayDaughters, int PDGMother, auto arrPDGDaughters, int8_t* sgn) {
+      if constexpr (useDecayIndex) {
+        return RecoDecayMcIndexed::getMatchedMCRec(particlesMC, finalDaughters, arrayDaughters, PDGMother, arrPDGDaughters, true, sgn);
+      } else {
+        return RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, PDGMother, arrPDGDaughters, true, sgn);
+      }
+    };
+    auto isMatchedMCGen = [&](const auto& particle, int PDGParticle, auto arrPDGDaughters, int8_t* sgn) {
+      if constexpr (useDecayIndex) {
+        return RecoDecayMcIndexed::isMatchedMCGen(particlesMC, finalDaughters, particle, PDGParticle, arrPDGDaughters, true, sgn);
+      } else {
+        return RecoDecay::isMatchedMCGen(particlesMC, particle, PDGParticle, arrPDGDaughters, true, sgn);
+      }
+    };
+
     rowCandidateProng2->bindExternalIndices(&tracks);
 
     // Match reconstructed candidates.
@@ -159,7 +208,7 @@ struct HFCandidateCreator2ProngExpressions {
 
       // D0(bar) → π± K∓
       // Printf("Checking D0(bar) → π± K∓");
-      indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, true, &sign);
+      indexRec = getMatchedMCRec(arrayDaughters, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, &sign);
       if (indexRec > -1) {
         flag = sign * (1 << DecayType::D0ToPiK);
       }
@@ -167,7 +216,7 @@ struct HFCandidateCreator2ProngExpressions {
       // J/ψ → e+ e−
       if (flag == 0) {
         // Printf("Checking J/ψ → e+ e−");
-        indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kJpsi, array{+kElectron, -kElectron}, true);
+        indexRec = getMatchedMCRec(arrayDaughters, pdg::Code::kJpsi, array{+kElectron, -kElectron}, nullptr);
         if (indexRec > -1) {
           flag = 1 << DecayType::JpsiToEE;
         }
@@ -176,7 +225,7 @@ struct HFCandidateCreator2ProngExpressions {
       // J/ψ → μ+ μ−
       if (flag == 0) {
         // Printf("Checking J/ψ → μ+ μ−");
-        indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kJpsi, array{+kMuonPlus, -kMuonPlus}, true);
+        indexRec = getMatchedMCRec(arrayDaughters, pdg::Code::kJpsi, array{+kMuonPlus, -kMuonPlus}, nullptr);
         if (indexRec > -1) {
           flag = 1 << DecayType::JpsiToMuMu;
         }
@@ -199,14 +248,14 @@ struct HFCandidateCreator2ProngExpressions {
 
       // D0(bar) → π± K∓
       // Printf("Checking D0(bar) → π± K∓");
-      if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, true, &sign)) {
+      if (isMatchedMCGen(particle, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, &sign)) {
         flag = sign * (1 << DecayType::D0ToPiK);
       }
 
       // J/ψ → e+ e−
       if (flag == 0) {
         // Printf("Checking J/ψ → e+ e−");
-        if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kJpsi, array{+kElectron, -kElectron}, true)) {
+        if (isMatchedMCGen(particle, pdg::Code::kJpsi, array{+kElectron, -kElectron}, nullptr)) {
           flag = 1 << DecayType::JpsiToEE;
         }
       }
@@ -214,7 +263,7 @@ struct HFCandidateCreator2ProngExpressions {
       // J/ψ → μ+ μ−
       if (flag == 0) {
         // Printf("Checking J/ψ → μ+ μ−");
-        if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kJpsi, array{+kMuonPlus, -kMuonPlus}, true)) {
+        if (isMatchedMCGen(particle, pdg::Code::kJpsi, array{+kMuonPlus, -kMuonPlus}, nullptr)) {
           flag = 1 << DecayType::JpsiToMuMu;
         }
       }
@@ -228,7 +277,23 @@ struct HFCandidateCreator2ProngExpressions {
     }
   }
 
+  void processMC(aod::BigTracksMC const& tracks,
+                 aod::McParticles const& particlesMC)
+  {
+    runMCMatching<false>(tracks, particlesMC, particlesMC);
+  }
+
   PROCESS_SWITCH(HFCandidateCreator2ProngExpressions, processMC, "Process MC", false);
+
+  /// Performs MC matching with the decay tree index (same results as processMC).
+  void processMCIndexed(aod::BigTracksMC const& tracks,
+                        soa::Join<aod::McParticles, aod::McDecayIndices> const& particlesMC,
+                        aod::McFinalDaughters const& finalDaughters)
+  {
+    runMCMatching<true>(tracks, particlesMC, finalDaughters);
+  }
+
+  PROCESS_SWITCH(HFCandidateCreator2ProngExpressions, processMCIndexed, "Process MC with the decay tree index (requires o2-analysis-mc-decay-index)", false);
 };
 
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
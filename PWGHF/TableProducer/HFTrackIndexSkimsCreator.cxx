@@ -21,6 +21,8 @@
 #include "DetectorsVertexing/DCAFitterN.h"
 #include "PWGHF/DataModel/HFSecondaryVertex.h"
 #include "Common/Core/trackUtilities.h"
+#include "Common/Core/TrackParCovCache.h"
+#include "Common/DataModel/TrackPropagation.h"
 #include "Common/DataModel/EventSelection.h"
 //#include "Common/DataModel/Centrality.h"
 #include "Common/DataModel/StrangenessTables.h"
@@ -898,6 +900,9 @@ struct HfTrackIndexSkimsCreator {
 
   using SelectedCollisions = soa::Filtered<soa::Join<aod::Collisions, aod::HFSelCollision>>;
   using SelectedTracks = soa::Filtered<soa::Join<aod::BigTracks, aod::TracksExtended, aod::HFSelTrack>>;
+  using SelectedTracksWithCache = soa::Filtered<soa::Join<aod::BigTracks, aod::TracksExtended, aod::HFSelTrack, aod::TracksParCovCache>>;
+
+  TrackParCovCache trackParCovCache; // tracks of the collision converted once, instead of for each combination
 
   // FIXME
   //Partition<SelectedTracks> tracksPos = aod::track::signed1Pt > 0.f;
@@ -905,10 +910,9 @@ struct HfTrackIndexSkimsCreator {
 
   // int nColls{0}; //can be added to run over limited collisions per file - for tesing purposes
 
-  void process( //soa::Join<aod::Collisions, aod::CentV0Ms>::iterator const& collision, //FIXME add centrality when option for variations to the process function appears
-    SelectedCollisions::iterator const& collision,
-    aod::BCs const& bcs,
-    SelectedTracks const& tracks)
+  /// Builds the 2- and 3-prong candidates of a collision, the track parameters are taken from trackParCovCache
+  template <typename TTracks>
+  void createSkims(SelectedCollisions::iterator const& collision, TTracks const& tracks)
   {
 
     //can be added to run over limited collisions per file - for tesing purposes
@@ -976,7 +980,7 @@ struct HfTrackIndexSkimsCreator {
         continue;
       }
 
-      auto trackParVarPos1 = getTrackParCov(trackPos1);
+      const auto& trackParVarPos1 = trackParCovCache.get(trackPos1.globalIndex());
 
       // first loop over negative tracks
       //for (auto trackNeg1 = tracksNeg.begin(); trackNeg1 != tracksNeg.end(); ++trackNeg1) {
@@ -990,7 +994,7 @@ struct HfTrackIndexSkimsCreator {
           continue;
         }
 
-        auto trackParVarNeg1 = getTrackParCov(trackNeg1);
+        const auto& trackParVarNeg1 = trackParCovCache.get(trackNeg1.globalIndex());
 
         int isSelected2ProngCand = n2ProngBit; //bitmap for checking status of two-prong candidates (1 is true, 0 is rejected)
 
@@ -1110,7 +1114,7 @@ struct HfTrackIndexSkimsCreator {
             }
 
             // reconstruct the 3-prong secondary vertex
-            auto trackParVarPos2 = getTrackParCov(trackPos2);
+            const auto& trackParVarPos2 = trackParCovCache.get(trackPos2.globalIndex());
             if (df3.process(trackParVarPos1, trackParVarNeg1, trackParVarPos2) == 0) {
               continue;
             }
@@ -1220,7 +1224,7 @@ struct HfTrackIndexSkimsCreator {
             }
 
             // reconstruct the 3-prong secondary vertex
-            auto trackParVarNeg2 = getTrackParCov(trackNeg2);
+            const auto& trackParVarNeg2 = trackParCovCache.get(trackNeg2.globalIndex());
             if (df3.process(trackParVarNeg1, trackParVarPos1, trackParVarNeg2) == 0) {
               continue;
             }
@@ -1318,6 +1322,29 @@ struct HfTrackIndexSkimsCreator {
     registry.fill(HIST("hNCand2ProngVsNTracks"), nTracks, nCand2);
     registry.fill(HIST("hNCand3ProngVsNTracks"), nTracks, nCand3);
   }
+
+  void processNoCache( //soa::Join<aod::Collisions, aod::CentV0Ms>::iterator const& collision, //FIXME add centrality when option for variations to the process function appears
+    SelectedCollisions::iterator const& collision,
+    aod::BCs const& bcs,
+    SelectedTracks const& tracks)
+  {
+    trackParCovCache.fill(tracks);
+    createSkims(collision, tracks);
+  }
+  PROCESS_SWITCH(HfTrackIndexSkimsCreator, processNoCache, "Convert the tracks of each collision", true);
+
+  void processCache(
+    SelectedCollisions::iterator const& collision,
+    aod::BCs const& bcs,
+    SelectedTracksWithCache const& tracks)
+  {
+    trackParCovCache.fillFromCache(tracks);
+    if (tracks.size() > 0 && std::abs(trackParCovCache.getBz() - bz) > 0.001) {
+      LOGF(fatal, "The tracks were cached with a magnetic field of %.3f kG instead of %.3f kG", trackParCovCache.getBz(), bz.value);
+    }
+    createSkims(collision, tracks);
+  }
+  PROCESS_SWITCH(HfTrackIndexSkimsCreator, processCache, "Take the track parameters from the TracksParCovCache table of track-parcov-cache", false);
 };
 
 //________________________________________________________________________________________________________________________
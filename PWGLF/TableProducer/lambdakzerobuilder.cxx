@@ -42,6 +42,7 @@
 #include "Common/DataModel/StrangenessTables.h"
 #include "Common/Core/TrackSelection.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "Common/Core/CCDBSnapshot.h"
 #include "DetectorsBase/Propagator.h"
 #include "DetectorsBase/GeometryManager.h"
 #include "DataFormatsParameters/GRPObject.h"
@@ -99,6 +100,7 @@ struct lambdakzeroBuilder {
   Produces<aod::StoredV0Datas> v0data;
   Produces<aod::V0DataLink> v0dataLink;
   Service<o2::ccdb::BasicCCDBManager> ccdb;
+  CCDBSnapshot* snapshot = nullptr; /// Snapshot used instead of the CCDB if the URL is of the form snapshot://<file name>
 
   HistogramRegistry registry{
     "registry",
@@ -111,6 +113,7 @@ struct lambdakzeroBuilder {
 
   // Configurables
   Configurable<double> d_bz{"d_bz", -5.0, "bz field"};
+  Configurable<std::string> ccdburl{"ccdb-url", "https://alice-ccdb.cern.ch", "url of the ccdb repository, or snapshot://<file name> to use a snapshot written by ccdb-snapshot"};
   // Configurable<int> d_UseAbsDCA{"d_UseAbsDCA", 1, "Use Abs DCAs"}; uncomment this once we want to use the weighted DCA
 
   // Selection criteria
@@ -130,19 +133,22 @@ struct lambdakzeroBuilder {
   {
     // using namespace analysis::lambdakzerobuilder;
 
-    ccdb->setURL("https://alice-ccdb.cern.ch");
-    ccdb->setCaching(true);
-    ccdb->setLocalObjectValidityChecking();
+    snapshot = CCDBSnapshot::fromUrl(ccdburl);
+    if (!snapshot) {
+      ccdb->setURL(ccdburl);
+      ccdb->setCaching(true);
+      ccdb->setLocalObjectValidityChecking();
+    }
 
-    auto lut = o2::base::MatLayerCylSet::rectifyPtrFromFile(ccdb->get<o2::base::MatLayerCylSet>("GLO/Param/MatLUT"));
+    auto lut = o2::base::MatLayerCylSet::rectifyPtrFromFile(CCDBSnapshot::getObject<o2::base::MatLayerCylSet>(snapshot, ccdb, "GLO/Param/MatLUT"));
 
     if (!o2::base::GeometryManager::isGeometryLoaded()) {
-      ccdb->get<TGeoManager>("GLO/Config/Geometry");
+      CCDBSnapshot::getObject<TGeoManager>(snapshot, ccdb, "GLO/Config/Geometry");
       /* it seems this is needed at this level for the material LUT to work properly */
       /* but what happens if the run changes while doing the processing?             */
       constexpr long run3grp_timestamp = (1619781650000 + 1619781529000) / 2;
 
-      o2::parameters::GRPObject* grpo = ccdb->getForTimeStamp<o2::parameters::GRPObject>("GLO/GRP/GRP", run3grp_timestamp);
+      o2::parameters::GRPObject* grpo = CCDBSnapshot::getObject<o2::parameters::GRPObject>(snapshot, ccdb, "GLO/GRP/GRP", run3grp_timestamp);
       o2::base::Propagator::initFieldFromGRP(grpo);
       o2::base::Propagator::Instance()->setMatLUT(lut);
     }